@@ -2511,10 +2511,12 @@ void ClientThink_real( gentity_t *ent ) {
 			if (ent->health > 0 && ent->client->ps.stats[STAT_HEALTH] > 0)
 			{
 				trap->SendServerCommand( -1, va("cp \"%s %s %s!\n\"", ent->client->pers.netname, G_GetStringEdString("MP_SVGAME", "PLDUELWINNER"), duelAgainst->client->pers.netname) );
+				G_LogEvent( LOGEVENT_DUEL_END, ent->s.number, duelAgainst->s.number, DUELRESULT_WIN, NULL );
 			}
 			else
 			{ //it was a draw, because we both managed to die in the same frame
 				trap->SendServerCommand( -1, va("cp \"%s\n\"", G_GetStringEdString("MP_SVGAME", "PLDUELTIE")) );
+				G_LogEvent( LOGEVENT_DUEL_END, ent->s.number, duelAgainst->s.number, DUELRESULT_TIE, NULL );
 			}
 		}
 		else
@@ -2534,6 +2536,7 @@ void ClientThink_real( gentity_t *ent ) {
 				G_AddEvent(duelAgainst, EV_PRIVATE_DUEL, 0);
 
 				trap->SendServerCommand( -1, va("print \"%s\n\"", G_GetStringEdString("MP_SVGAME", "PLDUELSTOP")) );
+				G_LogEvent( LOGEVENT_DUEL_END, ent->s.number, duelAgainst->s.number, DUELRESULT_STOPPED, NULL );
 			}
 		}
 	}
@@ -1592,11 +1592,13 @@ void G_Say( gentity_t *ent, gentity_t *target, int mode, const char *chatText )
 	default:
 	case SAY_ALL:
 		G_LogPrintf( "say: %s: %s\n", ent->client->pers.netname, text );
+		G_LogEvent( LOGEVENT_CHAT, ent->s.number, -1, SAY_ALL, text );
 		Com_sprintf (name, sizeof(name), "%s%c%c"EC": ", ent->client->pers.netname, Q_COLOR_ESCAPE, COLOR_WHITE );
 		color = COLOR_GREEN;
 		break;
 	case SAY_TEAM:
 		G_LogPrintf( "sayteam: %s: %s\n", ent->client->pers.netname, text );
+		G_LogEvent( LOGEVENT_CHAT, ent->s.number, -1, SAY_TEAM, text );
 		if (Team_GetLocationMsg(ent, location, sizeof(location)))
 		{
 			Com_sprintf (name, sizeof(name), EC"(%s%c%c"EC")"EC": ",
@@ -1721,6 +1723,7 @@ static void Cmd_Tell_f( gentity_t *ent ) {
 	}
 
 	G_LogPrintf( "tell: %s to %s: %s\n", ent->client->pers.netname, target->client->pers.netname, p );
+	G_LogEvent( LOGEVENT_CHAT, ent->s.number, targetNum, SAY_TELL, p );
 	G_Say( ent, target, SAY_TELL, p );
 	// don't tell to the player self if it was already directed to this player
 	// also don't send the chat back to a bot
@@ -1830,6 +1833,7 @@ void Cmd_GameCommand_f( gentity_t *ent ) {
 		return;
 
 	G_LogPrintf( "tell: %s to %s: %s\n", ent->client->pers.netname, target->client->pers.netname, gc_orders[order] );
+	G_LogEvent( LOGEVENT_CHAT, ent->s.number, targetNum, SAY_TELL, gc_orders[order] );
 	G_Say( ent, target, SAY_TELL, gc_orders[order] );
 	// don't tell to the player self if it was already directed to this player
 	// also don't send the chat back to a bot
@@ -3083,6 +3087,8 @@ void Cmd_EngageDuel_f(gentity_t *ent)
 			ent->client->ps.duelInProgress = qtrue;
 			challenged->client->ps.duelInProgress = qtrue;
 
+			G_LogEvent( LOGEVENT_DUEL_START, ent->s.number, challenged->s.number, 0, NULL );
+
 			ent->client->ps.duelTime = level.time + 2000;
 			challenged->client->ps.duelTime = level.time + 2000;
 
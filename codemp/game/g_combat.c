@@ -2469,6 +2469,7 @@ extern void RunEmplacedWeapon( gentity_t *ent, usercmd_t **ucmd );
 	else
 		Q_strcat( buf, sizeof( buf ), va( "%s by %s\n", self->client->pers.netname, obit ) );
 	G_LogPrintf( "%s", buf );
+	G_LogEvent( LOGEVENT_KILL, killer, self->s.number, meansOfDeath, NULL );
 
 	if ( g_austrian.integer
 		&& level.gametype == GT_DUEL
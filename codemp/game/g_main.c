@@ -1526,6 +1526,32 @@ void QDECL G_LogPrintf( const char *fmt, ... ) {
 
 	trap->FS_Write( string, strlen( string ), level.logFile );
 }
+
+/*
+=================
+G_LogEvent
+
+Send a structured event to the remote log, alongside the G_LogPrintf line
+=================
+*/
+void G_LogEvent( logEventType_t type, int client, int target, int value, const char *text ) {
+	logEvent_t ev;
+
+	// appended to gameImport_t without an API bump, older engines leave it unset
+	if ( !trap->LogEvent )
+		return;
+
+	memset( &ev, 0, sizeof( ev ) );
+	ev.type = type;
+	ev.client = client;
+	ev.target = target;
+	ev.value = value;
+	if ( text )
+		Q_strncpyz( ev.text, text, sizeof( ev.text ) );
+
+	trap->LogEvent( &ev );
+}
+
 /*
 =================
 G_SecurityLogPrintf
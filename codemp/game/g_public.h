@@ -375,6 +375,35 @@ typedef struct T_G_ICARUS_GETSETIDFORSTRING_s {
 	char string[2048];
 } T_G_ICARUS_GETSETIDFORSTRING;
 
+//===============================================================
+
+// structured events for the remote log, so log readers don't have to parse G_LogPrintf lines.
+// connect, disconnect and userinfo are sent by the engine, the rest by the game through LogEvent
+typedef enum logEventType_e {
+	LOGEVENT_CONNECT,
+	LOGEVENT_DISCONNECT,
+	LOGEVENT_USERINFO,
+	LOGEVENT_KILL,			// client = killer (ENTITYNUM_WORLD if none), target = victim, value = meansOfDeath
+	LOGEVENT_CHAT,			// client = talker, target = recipient of a tell, value = SAY_ALL/SAY_TEAM/SAY_TELL
+	LOGEVENT_DUEL_START,	// client and target are the duelists
+	LOGEVENT_DUEL_END,		// client = winner, target = loser, value = duelResult_t
+	LOGEVENT_MAX
+} logEventType_t;
+
+typedef enum duelResult_e {
+	DUELRESULT_WIN,
+	DUELRESULT_TIE,			// both died in the same frame
+	DUELRESULT_STOPPED		// ran away from each other
+} duelResult_t;
+
+typedef struct logEvent_s {
+	int		type;			// logEventType_t
+	int		client;
+	int		target;			// -1 if unused
+	int		value;
+	char	text[MAX_SAY_TEXT];
+} logEvent_t;
+
 typedef enum gameImportLegacy_e {
 	G_PRINT,
 	G_ERROR,
@@ -711,7 +740,8 @@ typedef enum gameImportLegacy_e {
 	G_CM_REGISTER_TERRAIN,
 	G_RMG_INIT,
 	G_BOT_UPDATEWAYPOINTS,
-	G_BOT_CALCULATEPATHS
+	G_BOT_CALCULATEPATHS,
+	G_LOG_EVENT
 } gameImportLegacy_t;
 
 typedef enum gameExportLegacy_e {
@@ -1093,6 +1123,9 @@ typedef struct gameImport_s {
 	void		(*G2API_CleanEntAttachments)			( void );
 	qboolean	(*G2API_OverrideServer)					( void *serverInstance );
 	void		(*G2API_GetSurfaceName)					( void *ghoul2, int surfNumber, int modelIndex, char *fillBuf );
+
+	// remote log
+	void		(*LogEvent)								( const logEvent_t *ev );
 } gameImport_t;
 
 typedef struct gameExport_s {
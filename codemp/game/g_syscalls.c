@@ -993,6 +993,9 @@ void trap_Bot_UpdateWaypoints(int wpnum, wpobject_t **wps) {
 void trap_Bot_CalculatePaths(int rmg) {
 	Q_syscall(G_BOT_CALCULATEPATHS, rmg);
 }
+void trap_LogEvent( const logEvent_t *ev ) {
+	Q_syscall( G_LOG_EVENT, ev );
+}
 
 
 // Translate import table funcptrs to syscalls
@@ -1354,4 +1357,5 @@ static void TranslateSyscalls( void ) {
 	trap->G2API_CleanEntAttachments			= trap_G2API_CleanEntAttachments;
 	trap->G2API_OverrideServer				= trap_G2API_OverrideServer;
 	trap->G2API_GetSurfaceName				= trap_G2API_GetSurfaceName;
+	trap->LogEvent							= trap_LogEvent;
 }
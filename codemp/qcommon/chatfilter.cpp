@@ -0,0 +1,234 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// chatfilter.cpp -- com_logChat policy for the console and game logs
+//
+// All chat patterns are compiled into a single case insensitive Aho-Corasick
+// automaton, so classifying a line is one pass over it no matter how many
+// patterns there are. Bytes are first mapped to a class (every character used
+// by a pattern gets one, everything else shares class 0) to keep the
+// transition table small.
+//
+// Operators can add patterns for mod specific chat with com_logChatPublic and
+// com_logChatPrivate, several patterns are separated by '|'.
+
+#include "qcommon/qcommon.h"
+
+#define CF_PUBLIC			1		// hidden by com_logChat 0
+#define CF_PRIVATE			2		// hidden by com_logChat 0 and 1
+#define CF_ECHO				4		// chat going out to clients, hidden by com_logChat 0 and 1
+
+#define CF_MAX_STATES		1024
+#define CF_MAX_CLASSES		64
+
+typedef struct chatPattern_s {
+	const char	*text;
+	int			flags;
+} chatPattern_t;
+
+static const chatPattern_t builtinPatterns[] = {
+	{ "say: ",		CF_PUBLIC },
+	{ "sayteam: ",	CF_PUBLIC },
+	{ "say_clan: ",	CF_PUBLIC },
+	{ "say_admin: ",CF_PUBLIC },
+	{ "tell: ",		CF_PRIVATE },
+	{ "^7\x19: ",	CF_ECHO },
+};
+
+typedef struct chatFilter_s {
+	byte	byteClass[256];
+	int		numClasses;
+	int		numStates;
+	short	next[CF_MAX_STATES][CF_MAX_CLASSES];
+	byte	output[CF_MAX_STATES];		// CF_ flags of every pattern ending in this state
+	qboolean	overflowed;
+} chatFilter_t;
+
+static chatFilter_t	cf;
+static cvar_t		*com_logChatPublic;
+static cvar_t		*com_logChatPrivate;
+
+/*
+==================
+ChatFilter_AddPattern
+
+Adds a pattern to the trie, the failure transitions are filled in later
+by ChatFilter_Link.
+==================
+*/
+static void ChatFilter_AddPattern( const char *text, int len, int flags ) {
+	int state = 0;
+	int i;
+
+	if ( len <= 0 ) {
+		return;
+	}
+
+	for ( i = 0; i < len; i++ ) {
+		const int c = tolower( (byte)text[i] );
+
+		if ( !cf.byteClass[c] ) {
+			if ( cf.numClasses == CF_MAX_CLASSES ) {
+				cf.overflowed = qtrue;
+				return;
+			}
+			cf.byteClass[c] = cf.byteClass[toupper( c )] = cf.numClasses++;
+		}
+	}
+
+	for ( i = 0; i < len; i++ ) {
+		const int c = cf.byteClass[(byte)text[i]];
+
+		if ( !cf.next[state][c] ) {
+			if ( cf.numStates == CF_MAX_STATES ) {
+				cf.overflowed = qtrue;
+				return;
+			}
+			cf.next[state][c] = cf.numStates++;
+		}
+		state = cf.next[state][c];
+	}
+
+	cf.output[state] |= flags;
+}
+
+static void ChatFilter_AddPatternList( const char *list, int flags ) {
+	while ( *list ) {
+		const char *end = strchr( list, '|' );
+
+		if ( !end ) {
+			end = list + strlen( list );
+		}
+		ChatFilter_AddPattern( list, end - list, flags );
+		list = *end ? end + 1 : end;
+	}
+}
+
+/*
+==================
+ChatFilter_Link
+
+Turns the trie into a complete automaton. Missing transitions take the one
+of the failure state, which is always closer to the root and so already done
+in breadth first order. Outputs are inherited the same way.
+==================
+*/
+static void ChatFilter_Link( void ) {
+	static short	fail[CF_MAX_STATES];
+	static short	queue[CF_MAX_STATES];
+	int				head = 0, tail = 0;
+	int				c;
+
+	for ( c = 0; c < cf.numClasses; c++ ) {
+		if ( cf.next[0][c] ) {
+			fail[cf.next[0][c]] = 0;
+			queue[tail++] = cf.next[0][c];
+		}
+	}
+
+	while ( head < tail ) {
+		const int state = queue[head++];
+
+		cf.output[state] |= cf.output[fail[state]];
+
+		for ( c = 0; c < cf.numClasses; c++ ) {
+			const int child = cf.next[state][c];
+
+			if ( child ) {
+				fail[child] = cf.next[fail[state]][c];
+				queue[tail++] = child;
+			} else {
+				cf.next[state][c] = cf.next[fail[state]][c];
+			}
+		}
+	}
+}
+
+/*
+==================
+ChatFilter_Build
+==================
+*/
+static void ChatFilter_Build( void ) {
+	size_t i;
+
+	memset( &cf, 0, sizeof( cf ) );
+	cf.numClasses = 1;	// class 0 is every byte no pattern uses
+	cf.numStates = 1;
+
+	for ( i = 0; i < ARRAY_LEN( builtinPatterns ); i++ ) {
+		ChatFilter_AddPattern( builtinPatterns[i].text, strlen( builtinPatterns[i].text ), builtinPatterns[i].flags );
+	}
+	ChatFilter_AddPatternList( com_logChatPublic->string, CF_PUBLIC );
+	ChatFilter_AddPatternList( com_logChatPrivate->string, CF_PRIVATE );
+
+	ChatFilter_Link();
+
+	com_logChatPublic->modified = qfalse;
+	com_logChatPrivate->modified = qfalse;
+
+	if ( cf.overflowed ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: too many chat log patterns, some are ignored\n" );
+	}
+}
+
+/*
+==================
+ChatFilter_Hide
+
+Returns qtrue if com_logChat says the line must not be logged. Stops at len
+or the first NUL, whichever comes first.
+==================
+*/
+qboolean ChatFilter_Hide( const char *msg, int len ) {
+	const byte *s = (const byte *)msg;
+	const byte *end = s + len;
+	int mask, state;
+
+	if ( !com_logChat || !com_logChatPublic || com_logChat->integer >= 2 ) {
+		return qfalse;
+	}
+
+	if ( com_logChatPublic->modified || com_logChatPrivate->modified ) {
+		ChatFilter_Build();
+	}
+
+	mask = com_logChat->integer ? (CF_PRIVATE | CF_ECHO) : (CF_PUBLIC | CF_PRIVATE | CF_ECHO);
+
+	for ( state = 0; s < end && *s; s++ ) {
+		state = cf.next[state][cf.byteClass[*s]];
+		if ( cf.output[state] & mask ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+/*
+==================
+ChatFilter_Init
+==================
+*/
+void ChatFilter_Init( void ) {
+	com_logChatPublic = Cvar_Get( "com_logChatPublic", "", CVAR_ARCHIVE_ND, "Extra public chat patterns for com_logChat, separated by |" );
+	com_logChatPrivate = Cvar_Get( "com_logChatPrivate", "", CVAR_ARCHIVE_ND, "Extra private chat patterns for com_logChat, separated by |" );
+	ChatFilter_Build();
+}
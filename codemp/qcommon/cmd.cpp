@@ -342,6 +342,7 @@ static void Cmd_Echo_f (void)
 typedef struct cmd_function_s
 {
 	struct cmd_function_s	*next;
+	struct cmd_function_s	*hashNext;
 	char					*name;
 	char					*description;
 	xcommand_t				function;
@@ -357,6 +358,29 @@ static	char		cmd_cmd[BIG_INFO_STRING]; // the original command we received (no t
 
 static	cmd_function_t	*cmd_functions;		// possible commands to execute
 
+// the list above is only walked for completion and listing, lookups by
+// name go through the hash
+#define CMD_HASH_SIZE		512
+static	cmd_function_t	*cmd_hashTable[CMD_HASH_SIZE];
+
+/*
+============
+Cmd_HashValue
+
+Case insensitive, like the name compares
+============
+*/
+static int Cmd_HashValue( const char *name ) {
+	int		i;
+	long	hash;
+
+	hash = 0;
+	for ( i = 0 ; name[i] ; i++ ) {
+		hash += (long)tolower( (unsigned char)name[i] ) * ( i + 119 );
+	}
+	return hash & ( CMD_HASH_SIZE - 1 );
+}
+
 
 /*
 ============
@@ -640,7 +664,7 @@ Cmd_FindCommand
 cmd_function_t *Cmd_FindCommand( const char *cmd_name )
 {
 	cmd_function_t *cmd;
-	for( cmd = cmd_functions; cmd; cmd = cmd->next )
+	for( cmd = cmd_hashTable[Cmd_HashValue( cmd_name )]; cmd; cmd = cmd->hashNext )
 		if( !Q_stricmp( cmd_name, cmd->name ) )
 			return cmd;
 	return NULL;
@@ -653,6 +677,7 @@ Cmd_AddCommand
 */
 void	Cmd_AddCommand( const char *cmd_name, xcommand_t function, const char *cmd_desc ) {
 	cmd_function_t	*cmd;
+	int				hash;
 
 	// fail if the command already exists
 	if( Cmd_FindCommand( cmd_name ) )
@@ -675,6 +700,10 @@ void	Cmd_AddCommand( const char *cmd_name, xcommand_t function, const char *cmd_
 	cmd->complete = NULL;
 	cmd->next = cmd_functions;
 	cmd_functions = cmd;
+
+	hash = Cmd_HashValue( cmd_name );
+	cmd->hashNext = cmd_hashTable[hash];
+	cmd_hashTable[hash] = cmd;
 }
 
 void Cmd_AddCommandList( const cmdList_t *cmdList )
@@ -701,10 +730,10 @@ Cmd_SetCommandCompletionFunc
 ============
 */
 void Cmd_SetCommandCompletionFunc( const char *command, completionFunc_t complete ) {
-	for ( cmd_function_t *cmd=cmd_functions; cmd; cmd=cmd->next ) {
-		if ( !Q_stricmp( command, cmd->name ) )
-			cmd->complete = complete;
-	}
+	cmd_function_t *cmd = Cmd_FindCommand( command );
+
+	if ( cmd )
+		cmd->complete = complete;
 }
 
 /*
@@ -715,6 +744,21 @@ Cmd_RemoveCommand
 void	Cmd_RemoveCommand( const char *cmd_name ) {
 	cmd_function_t	*cmd, **back;
 
+	// unlink it from its hash chain first
+	back = &cmd_hashTable[Cmd_HashValue( cmd_name )];
+	while( 1 ) {
+		cmd = *back;
+		if ( !cmd ) {
+			// command wasn't active
+			return;
+		}
+		if ( !strcmp( cmd_name, cmd->name ) ) {
+			*back = cmd->hashNext;
+			break;
+		}
+		back = &cmd->hashNext;
+	}
+
 	back = &cmd_functions;
 	while( 1 ) {
 		cmd = *back;
@@ -806,10 +850,10 @@ Cmd_CompleteArgument
 ============
 */
 void Cmd_CompleteArgument( const char *command, char *args, int argNum ) {
-	for ( cmd_function_t *cmd=cmd_functions; cmd; cmd=cmd->next ) {
-		if ( !Q_stricmp( command, cmd->name ) && cmd->complete )
-			cmd->complete( args, argNum );
-	}
+	const cmd_function_t *cmd = Cmd_FindCommand( command );
+
+	if ( cmd && cmd->complete )
+		cmd->complete( args, argNum );
 }
 
 /*
@@ -820,7 +864,7 @@ A complete command line has been parsed, so try to execute it
 ============
 */
 void	Cmd_ExecuteString( const char *text ) {
-	cmd_function_t	*cmd, **prev;
+	cmd_function_t	*cmd;
 
 	// execute the command line
 	Cmd_TokenizeString( text );
@@ -829,25 +873,13 @@ void	Cmd_ExecuteString( const char *text ) {
 	}
 
 	// check registered command functions
-	for ( prev = &cmd_functions ; *prev ; prev = &cmd->next ) {
-		cmd = *prev;
-		if ( !Q_stricmp( Cmd_Argv(0), cmd->name ) ) {
-			// rearrange the links so that the command will be
-			// near the head of the list next time it is used
-			*prev = cmd->next;
-			cmd->next = cmd_functions;
-			cmd_functions = cmd;
-
-			// perform the action
-			if ( !cmd->function ) {
-				// let the cgame or game handle it
-				break;
-			} else {
-				cmd->function ();
-			}
-			return;
-		}
+	cmd = Cmd_FindCommand( Cmd_Argv(0) );
+	if ( cmd && cmd->function ) {
+		// perform the action
+		cmd->function ();
+		return;
 	}
+	// with no function, let the cgame or game handle it
 
 	// check cvars
 	if ( Cvar_Command() ) {
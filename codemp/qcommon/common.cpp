@@ -81,6 +81,11 @@ cvar_t	*com_printAllMessages;
 int		time_game;
 int		time_frontend;		// renderer frontend time
 int		time_backend;		// renderer backend time
+int		time_netRecv;		// usec spent in recvmmsg
+int		c_netBatches;
+int		c_netPackets;
+int		c_netSendCalls;		// sendto and sendmmsg calls
+int		c_netSendPackets;
 
 int			com_frameTime;
 int			com_frameNumber;
@@ -88,9 +93,6 @@ int			com_frameNumber;
 qboolean	com_errorEntered = qfalse;
 qboolean	com_fullyInitialized = qfalse;
 
-netadr_t logremote_addr;
-qboolean logremote_rdy = qfalse;
-
 char	com_errorMessage[MAXPRINTMSG] = {0};
 
 void Com_WriteConfig_f( void );
@@ -164,12 +166,9 @@ void QDECL Com_Printf( const char *fmt, ... ) {
 		//but it also shows the "chat" command as it goes out, so we'll just filter all of those out
 		//TODO: determine what type of message it is based on the contents of the chat cmd, so we don't filter out chat messages from mods/custom entities
 		//well, doesn't that change depending on what mod is running? i think mb2 adds sender and receiver to PMs...
-		if (Q_stristr(msg, "^7\x19: "))
-			logThis = qfalse;
-		if (!com_logChat->integer && (Q_stristr(msg, "say: ") || Q_stristr(msg, "sayteam: ") || Q_stristr(msg, "say_clan: ") || Q_stristr(msg, "say_admin: ") || Q_stristr(msg, "tell: "))) //0 - log nothing
+		//mods can be covered with com_logChatPublic / com_logChatPrivate
+		if (ChatFilter_Hide(msg, sizeof(msg)))
 			logThis = qfalse;
-		if (com_logChat->integer == 1 && Q_stristr(msg, "tell: ")) //1 - only log public/team chat
-			logThis = qfalse; //return len so it thinks the write was successful
 
 		if (!logThis && !com_printAllMessages->integer)
 			return;
@@ -182,14 +181,7 @@ void QDECL Com_Printf( const char *fmt, ... ) {
 	Sys_Print( msg );
 
 	// remote
-	if ( logremote_rdy ) {
-		if (Sys_SendPacket_Status(strlen(msg) + 1, msg, logremote_addr) == -1) {
-			logremote_rdy = qfalse;
-			Com_Printf("\n^1=== logremote ===\n");
-			Com_Printf("^1Tried to log remote but was unable\n");
-			Com_Printf("^1=================\n\n");
-		}
-	}
+	RemoteLog_Print( msg );
 
 	// logfile
 	if ( com_logfile && com_logfile->integer ) {
@@ -207,12 +199,13 @@ void QDECL Com_Printf( const char *fmt, ... ) {
 			logfile = FS_FOpenFileWrite( "qconsole.log" );
 
 			if ( logfile ) {
-				Com_Printf( "logfile opened on %s\n", asctime( newtime ) );
 				if ( com_logfile->integer > 1 ) {
 					// force it to not buffer so we get valid
 					// data even if we are crashing
 					FS_ForceFlush(logfile);
 				}
+				FS_WriteInBackground(logfile);
+				Com_Printf( "logfile opened on %s\n", asctime( newtime ) );
 			}
 			else {
 				Com_Printf( "Opening qconsole.log failed!\n" );
@@ -325,6 +318,9 @@ void NORETURN QDECL Com_Error( int code, const char *fmt, ... ) {
 	Q_vsnprintf (com_errorMessage,sizeof(com_errorMessage), fmt,argptr);
 	va_end (argptr);
 
+	// whatever led up to the error should be on disk
+	LogWriter_Flush();
+
 	if ( code != ERR_DISCONNECT && code != ERR_NEED_CD ) {
 		Cvar_Get("com_errorMessage", "", CVAR_ROM);	//give com_errorMessage a default so it won't come back to life after a resetDefaults
 		Cvar_Set("com_errorMessage", com_errorMessage);
@@ -557,7 +553,7 @@ void Com_SetRemoteLogAddr( char* newAddr ) {
 		return;
 	}
 
-	logremote_rdy = NET_StringToAdr(newAddr, &logremote_addr);
+	RemoteLog_SetAddress(newAddr);
 }
 
 /*
@@ -1279,6 +1275,7 @@ void Com_Init( char *commandLine ) {
 		com_showtrace = Cvar_Get ("com_showtrace", "0", CVAR_CHEAT);
 
 		com_speeds = Cvar_Get ("com_speeds", "0", 0);
+		Profile_Init();
 		com_timedemo = Cvar_Get ("timedemo", "0", 0);
 		com_cameraMode = Cvar_Get ("com_cameraMode", "0", CVAR_CHEAT);
 
@@ -1303,10 +1300,14 @@ void Com_Init( char *commandLine ) {
 #ifdef DEDICATED
 		com_logChat = Cvar_Get( "com_logChat", "0", CVAR_NONE ); //0 - log nothing, 1 - log all but pm/tell messages, 2 - log all chat (baseJKA)
 		com_printAllMessages = Cvar_Get( "com_printAllMessages", "0", CVAR_TEMP|CVAR_INTERNAL ); //hidden cvar for debugging
+		ChatFilter_Init();
 #endif
 
 		com_bootlogo = Cvar_Get( "com_bootlogo", "1", CVAR_ARCHIVE_ND, "Show intro movies" );
 
+		LogWriter_Init();
+		RemoteLog_Init();
+
 		s = va("%s %s %s", JK_VERSION_OLD, PLATFORM_STRING, SOURCE_DATE );
 		com_version = Cvar_Get ("version", s, CVAR_ROM | CVAR_SERVERINFO );
 
@@ -1592,7 +1593,10 @@ void Com_Frame( void ) {
 		IN_Frame();
 
 		lastTime = com_frameTime;
-		com_frameTime = Com_EventLoop();
+		{
+			PROFILE_SCOPE( PROF_EVENTLOOP );
+			com_frameTime = Com_EventLoop();
+		}
 
 		msec = com_frameTime - lastTime;
 
@@ -1608,7 +1612,12 @@ void Com_Frame( void ) {
 			timeBeforeServer = Sys_Milliseconds ();
 		}
 
-		SV_Frame( msec );
+		{
+			PROFILE_SCOPE( PROF_SERVERFRAME );
+			SV_Frame( msec );
+		}
+
+		RemoteLog_Frame();
 
 		// if "dedicated" has been modified, start up
 		// or shut down the client system.
@@ -1637,7 +1646,10 @@ void Com_Frame( void ) {
 			if ( com_speeds->integer ) {
 				timeBeforeEvents = Sys_Milliseconds ();
 			}
-			Com_EventLoop();
+			{
+				PROFILE_SCOPE( PROF_EVENTLOOP );
+				Com_EventLoop();
+			}
 			Cbuf_Execute ();
 
 
@@ -1677,8 +1689,17 @@ void Com_Frame( void ) {
 
 			Com_Printf ("frame:%i all:%3i sv:%3i ev:%3i cl:%3i gm:%3i rf:%3i bk:%3i\n",
 						 com_frameNumber, all, sv, ev, cl, time_game, time_frontend, time_backend );
+
+			if ( c_netBatches || c_netSendCalls ) {
+				Com_Printf( "net: in %i packets, %i batches, %i usec in recvmmsg; out %i packets, %i syscalls\n",
+							c_netPackets, c_netBatches, time_netRecv, c_netSendPackets, c_netSendCalls );
+			}
 		}
 
+		// counted whether or not they are shown, so never let them build up
+		c_netBatches = c_netPackets = time_netRecv = 0;
+		c_netSendCalls = c_netSendPackets = 0;
+
 		//
 		// trace optimization tracking
 		//
@@ -1701,6 +1722,8 @@ void Com_Frame( void ) {
 			Sys_SetProcessorAffinity();
 		}
 
+		Profile_EndFrame();
+
 		com_frameNumber++;
 	}
 	catch (int code) {
@@ -1731,12 +1754,16 @@ void Com_Shutdown (void)
 {
 	CM_ClearMap();
 
+	RemoteLog_Shutdown();
+
 	if (logfile) {
 		FS_FCloseFile (logfile);
 		logfile = 0;
 		com_logfile->integer = 0;//don't open up the log file again!!
 	}
 
+	LogWriter_Shutdown();
+
 	if ( com_journalFile ) {
 		FS_FCloseFile( com_journalFile );
 		com_journalFile = 0;
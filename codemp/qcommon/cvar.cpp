@@ -29,6 +29,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 cvar_t		*cvar_vars = NULL;
 cvar_t		*cvar_cheats;
 uint32_t	cvar_modifiedFlags;
+int			cvar_modifiedCount;
 
 #define	MAX_CVARS	8192
 cvar_t		cvar_indexes[MAX_CVARS];
@@ -38,6 +39,9 @@ int			cvar_numIndexes;
 static	cvar_t*		hashTable[FILE_HASH_SIZE];
 static	qboolean cvar_sort = qfalse;
 
+static void Cvar_InfoChanged( uint32_t flags );
+static void Cvar_InfoValueChanged( cvar_t *var );
+
 static char *lastMemPool = NULL;
 static int memPoolSize;
 
@@ -357,6 +361,8 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, uint32_t flags, c
 
 	var = Cvar_FindVar (var_name);
 	if ( var ) {
+		uint32_t oldFlags = var->flags;
+
 		var_value = Cvar_Validate(var, var_value, qfalse);
 
 		// Make sure the game code cannot mark engine-added variables as gamecode vars
@@ -434,6 +440,10 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, uint32_t flags, c
 		// ZOID--needs to be set so that cvars the game sets as
 		// SERVERINFO get sent to clients
 		cvar_modifiedFlags |= flags;
+		cvar_modifiedCount++;
+		if ( var->flags != oldFlags ) {
+			Cvar_InfoChanged( var->flags | oldFlags );
+		}
 
 		return var;
 	}
@@ -486,6 +496,8 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, uint32_t flags, c
 	var->flags = flags;
 	// note what types of cvars have been modified (userinfo, archive, serverinfo, systeminfo)
 	cvar_modifiedFlags |= var->flags;
+	cvar_modifiedCount++;
+	Cvar_InfoChanged( var->flags );
 
 	hash = generateHashValue(var_name);
 	var->hashIndex = hash;
@@ -554,6 +566,9 @@ static void Cvar_Sort( void )
 	
 	cvar_vars = NULL;
 
+	// the info strings are in list order
+	Cvar_InfoChanged( 0xFFFFFFFFu );
+
 	// relink cvars
 	for ( i = 0; i < count; i++ ) {
 		var = list[ i ];
@@ -644,6 +659,7 @@ cvar_t *Cvar_Set2( const char *var_name, const char *value, uint32_t defaultFlag
 
 	// note what types of cvars have been modified (userinfo, archive, serverinfo, systeminfo)
 	cvar_modifiedFlags |= var->flags;
+	cvar_modifiedCount++;
 
 	if (!force)
 	{
@@ -713,6 +729,8 @@ cvar_t *Cvar_Set2( const char *var_name, const char *value, uint32_t defaultFlag
 	var->value = atof (var->string);
 	var->integer = atoi (var->string);
 
+	Cvar_InfoValueChanged( var );
+
 	return var;
 }
 
@@ -1070,18 +1088,24 @@ void Cvar_Set_f( void ) {
 			if( !( v->flags & CVAR_ARCHIVE ) ) {
 				v->flags |= CVAR_ARCHIVE;
 				cvar_modifiedFlags |= CVAR_ARCHIVE;
+				cvar_modifiedCount++;
+				Cvar_InfoChanged( CVAR_ARCHIVE );
 			}
 			break;
 		case 'u':
 			if( !( v->flags & CVAR_USERINFO ) ) {
 				v->flags |= CVAR_USERINFO;
 				cvar_modifiedFlags |= CVAR_USERINFO;
+				cvar_modifiedCount++;
+				Cvar_InfoChanged( CVAR_USERINFO );
 			}
 			break;
 		case 's':
 			if( !( v->flags & CVAR_SERVERINFO ) ) {
 				v->flags |= CVAR_SERVERINFO;
 				cvar_modifiedFlags |= CVAR_SERVERINFO;
+				cvar_modifiedCount++;
+				Cvar_InfoChanged( CVAR_SERVERINFO );
 			}
 			break;
 	}
@@ -1295,6 +1319,8 @@ cvar_t *Cvar_Unset(cvar_t *cv)
 
 	// note what types of cvars have been modified (userinfo, archive, serverinfo, systeminfo)
 	cvar_modifiedFlags |= cv->flags;
+	cvar_modifiedCount++;
+	Cvar_InfoChanged( cv->flags );
 
 	if(cv->name)
 		Cvar_FreeString(cv->name);
@@ -1424,6 +1450,108 @@ void Cvar_Restart_f( void ) {
 	Cvar_Restart(qfalse);
 }
 
+/*
+==============================================================================
+
+INFO STRINGS
+
+The info strings that are asked for all the time are kept between calls.
+A cvar that only changes its value gets it patched into them, anything else
+that changes about the cvars that go into a string makes it again on the
+next call.
+
+==============================================================================
+*/
+
+typedef struct cvarInfoString_s {
+	int				bit;
+	infoCache_t		cache;
+} cvarInfoString_t;
+
+static cvarInfoString_t cvar_infoStrings[] = {
+	{ CVAR_SERVERINFO,	{ qfalse } },
+	{ CVAR_SYSTEMINFO,	{ qtrue } },
+	{ CVAR_USERINFO,	{ qfalse } },
+};
+static const size_t cvar_numInfoStrings = ARRAY_LEN( cvar_infoStrings );
+
+/*
+=====================
+Cvar_InfoChanged
+
+Cvars with the given flags were added, removed or changed their flags
+=====================
+*/
+static void Cvar_InfoChanged( uint32_t flags ) {
+	for ( size_t i = 0 ; i < cvar_numInfoStrings ; i++ ) {
+		if ( flags & (cvar_infoStrings[i].bit | CVAR_INTERNAL) ) {
+			cvar_infoStrings[i].cache.valid = qfalse;
+		}
+	}
+}
+
+/*
+=====================
+Cvar_InfoValueChanged
+=====================
+*/
+static void Cvar_InfoValueChanged( cvar_t *var ) {
+	if ( var->flags & CVAR_INTERNAL ) {
+		return;
+	}
+
+	for ( size_t i = 0 ; i < cvar_numInfoStrings ; i++ ) {
+		if ( var->flags & cvar_infoStrings[i].bit ) {
+			InfoCache_SetValue( &cvar_infoStrings[i].cache, var, var->string );
+		}
+	}
+}
+
+/*
+=====================
+Cvar_InfoCache
+
+Returns the kept info string for the bit, made again if it has to be, or
+NULL if it isn't kept or Info_SetValueForKey would complain about it.
+=====================
+*/
+static const char *Cvar_InfoCache( int bit, qboolean big ) {
+	static const char	*keys[MAX_CVARS], *values[MAX_CVARS];
+	static const void	*owners[MAX_CVARS];
+	cvarInfoString_t	*infoString = NULL;
+	cvar_t				*var;
+	int					count;
+
+	for ( size_t i = 0 ; i < cvar_numInfoStrings ; i++ ) {
+		if ( cvar_infoStrings[i].bit == bit && cvar_infoStrings[i].cache.big == big ) {
+			infoString = &cvar_infoStrings[i];
+			break;
+		}
+	}
+	if ( !infoString ) {
+		return NULL;
+	}
+
+	if ( !infoString->cache.valid ) {
+		count = 0;
+		for ( var = cvar_vars ; var ; var = var->next ) {
+			if ( !(var->flags & CVAR_INTERNAL) && var->name &&
+				(var->flags & bit) )
+			{
+				keys[count] = var->name;
+				values[count] = var->string;
+				owners[count] = var;
+				count++;
+			}
+		}
+		if ( !InfoCache_Build( &infoString->cache, count, keys, values, owners ) ) {
+			return NULL;
+		}
+	}
+
+	return infoString->cache.info;
+}
+
 /*
 =====================
 Cvar_InfoString
@@ -1431,8 +1559,15 @@ Cvar_InfoString
 */
 char	*Cvar_InfoString( int bit ) {
 	static char	info[MAX_INFO_STRING];
+	const char	*cached;
 	cvar_t	*var;
 
+	cached = Cvar_InfoCache( bit, qfalse );
+	if ( cached ) {
+		Q_strncpyz( info, cached, sizeof( info ) );
+		return info;
+	}
+
 	info[0] = 0;
 
 	for (var = cvar_vars ; var ; var = var->next)
@@ -1456,8 +1591,15 @@ Cvar_InfoString_Big
 */
 char	*Cvar_InfoString_Big( int bit ) {
 	static char	info[BIG_INFO_STRING];
+	const char	*cached;
 	cvar_t	*var;
 
+	cached = Cvar_InfoCache( bit, qtrue );
+	if ( cached ) {
+		Q_strncpyz( info, cached, sizeof( info ) );
+		return info;
+	}
+
 	info[0] = 0;
 
 	for (var = cvar_vars ; var ; var = var->next)
@@ -50,6 +50,9 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 	#include <unistd.h>
 #endif
 
+// for FS_FolderSize
+#include <sys/stat.h>
+
 /*
 =============================================================================
 
@@ -264,6 +267,7 @@ typedef struct qfile_us {
 typedef struct fileHandleData_s {
 	qfile_ut	handleFiles;
 	qboolean	handleSync;
+	qboolean	handleAsync;	// written by the log writer thread
 	int			fileSize;
 	int			zipFilePos;
 	int			zipFileLen;
@@ -410,6 +414,19 @@ void	FS_ForceFlush( fileHandle_t f ) {
 	setvbuf( file, NULL, _IONBF, 0 );
 }
 
+/*
+================
+FS_WriteInBackground
+
+Hands writes to this file to the log writer thread, see logwriter.cpp.
+Only meant for files that are never read back while open.
+================
+*/
+void	FS_WriteInBackground( fileHandle_t f ) {
+	FS_FileForHandle(f);
+	fsh[f].handleAsync = qtrue;
+}
+
 /*
 ================
 FS_fplength
@@ -672,6 +689,59 @@ void FS_HomeRemove( const char *homePath ) {
 			fs_gamedir, homePath ) );
 }
 
+/*
+===========
+FS_FolderSize
+
+Adds up the size of all files under a directory
+===========
+*/
+static int64_t FS_FolderSize( const char *osPath ) {
+	int64_t size = 0;
+	int numfiles;
+	int i;
+
+	char **files = Sys_ListFiles( osPath, "", NULL, &numfiles, qfalse );
+	for ( i = 0; i < numfiles; i++ ) {
+		char fileOsPath[MAX_OSPATH];
+		Com_sprintf( fileOsPath, sizeof( fileOsPath ), "%s/%s", osPath, files[i] );
+#if defined(_WIN32)
+		struct _stat64 st;
+		if ( _stat64( fileOsPath, &st ) == 0 ) {
+#else
+		struct stat st;
+		if ( stat( fileOsPath, &st ) == 0 ) {
+#endif
+			size += st.st_size;
+		}
+	}
+	FS_FreeFileList( files );
+
+	char **directories = Sys_ListFiles( osPath, "/", NULL, &numfiles, qfalse );
+	for ( i = 0; i < numfiles; i++ ) {
+		if ( !Q_stricmp( directories[i], "." ) || !Q_stricmp( directories[i], ".." ) ) {
+			continue;
+		}
+		char directoryOsPath[MAX_OSPATH];
+		Com_sprintf( directoryOsPath, sizeof( directoryOsPath ), "%s/%s", osPath, directories[i] );
+		size += FS_FolderSize( directoryOsPath );
+	}
+	FS_FreeFileList( directories );
+
+	return size;
+}
+
+/*
+===========
+FS_HomeFolderSize
+
+Size in bytes of everything under a directory in the homepath
+===========
+*/
+int64_t FS_HomeFolderSize( const char *homePath ) {
+	return FS_FolderSize( FS_BuildOSPath( fs_homepath->string, fs_gamedir, homePath ) );
+}
+
 /*
 ===========
 FS_Rmdir
@@ -1035,6 +1105,9 @@ void FS_FCloseFile( fileHandle_t f ) {
 	}
 
 	// we didn't find it as a pak, so close it as a unique file
+	if (fsh[f].handleAsync) {
+		LogWriter_Flush();
+	}
 	if (fsh[f].handleFiles.file.o) {
 		fclose (fsh[f].handleFiles.file.o);
 	}
@@ -1084,6 +1157,35 @@ fileHandle_t FS_FOpenFileWrite( const char *filename, qboolean safe ) {
 	return f;
 }
 
+/*
+===========
+FS_FOpenFileWriteRaw
+
+Like FS_FOpenFileWrite, but returns the FILE itself instead of a handle. It
+doesn't take up one of the handles and may be written and closed by another
+thread, fclose it when done.
+===========
+*/
+FILE *FS_FOpenFileWriteRaw( const char *filename ) {
+	char			*ospath;
+
+	FS_AssertInitialised();
+
+	ospath = FS_BuildOSPath( fs_homepath->string, fs_gamedir, filename );
+
+	if ( fs_debug->integer ) {
+		Com_Printf( "FS_FOpenFileWriteRaw: %s\n", ospath );
+	}
+
+	FS_CheckFilenameIsMutable( ospath, __func__ );
+
+	if( FS_CreatePath( ospath ) ) {
+		return NULL;
+	}
+
+	return fopen( ospath, "wb" );
+}
+
 /*
 ===========
 FS_FOpenFileAppend
@@ -1719,6 +1821,10 @@ int FS_Write( const void *buffer, int len, fileHandle_t h ) {
 	f = FS_FileForHandle(h);
 	buf = (byte *)buffer;
 
+	if ( fsh[h].handleAsync && LogWriter_Write( h, f, fsh[h].handleSync, buffer, len ) ) {
+		return len;
+	}
+
 	remaining = len;
 	tries = 0;
 	while (remaining) {
@@ -4005,6 +4111,9 @@ int		FS_FOpenFileByMode( const char *qpath, fileHandle_t *f, fsMode_t mode ) {
 
 int		FS_FTell( fileHandle_t f ) {
 	int pos;
+	if (fsh[f].handleAsync) {
+		LogWriter_Flush();
+	}
 	if (fsh[f].zipFile == qtrue) {
 		pos = unztell(fsh[f].handleFiles.file.z);
 	} else {
@@ -4014,6 +4123,9 @@ int		FS_FTell( fileHandle_t f ) {
 }
 
 void	FS_Flush( fileHandle_t f ) {
+	if (fsh[f].handleAsync) {
+		LogWriter_Flush();
+	}
 	fflush(fsh[f].handleFiles.file.o);
 }
 
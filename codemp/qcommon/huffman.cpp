@@ -444,3 +444,146 @@ void Huff_Init(huffman_t *huff) {
 	huff->compressor.loc[NYT] = huff->compressor.tree;
 }
 
+
+/* Fill in the codes and lookup entries below node, code holds the depth bits
+ * that lead to it */
+static qboolean build_tables(huffTables_t *tables, node_t *node, uint32_t code, int depth) {
+	int i;
+
+	if (!node) {
+		return qtrue;
+	}
+
+	if (node->symbol == INTERNAL_NODE) {
+		if (depth == HUFF_LOOKUP_BITS) {
+			tables->lookupNode[code] = node;
+		}
+		if (depth == HUFF_MAX_CODE_LEN) {
+			return qfalse;
+		}
+		return (qboolean)(build_tables(tables, node->left, code, depth + 1)
+			&& build_tables(tables, node->right, code | (1u << depth), depth + 1));
+	}
+
+	if (node->symbol < HMAX) {
+		tables->code[node->symbol] = code;
+		tables->length[node->symbol] = depth;
+	}
+
+	if (depth <= HUFF_LOOKUP_BITS) {
+		/* every lookup index that starts with this code */
+		for (i = 0; i < 1 << (HUFF_LOOKUP_BITS - depth); i++) {
+			tables->lookupSymbol[code | (i << depth)] = node->symbol;
+			tables->lookupLength[code | (i << depth)] = depth;
+		}
+	}
+	return qtrue;
+}
+
+/* Returns qfalse if a code is longer than HUFF_MAX_CODE_LEN, the tables can't
+ * be used then */
+qboolean Huff_BuildTables( huffTables_t *tables, node_t *tree ) {
+	Com_Memset(tables, 0, sizeof(*tables));
+	tables->tree = tree;
+	return build_tables(tables, tree, 0, 0);
+}
+
+/* Write len bits the way add_bit does: a byte is cleared when its first bit
+ * is written, bits are or'ed in after that */
+static void write_bits(byte *fout, int offset, int maxoffset, uint32_t bits, int len) {
+	byte		*p = fout + (offset >> 3);
+	const int	shift = offset & 7;
+	const int	bytes = (shift + len + 7) >> 3;
+	uint64_t	v = (uint64_t)bits << shift;
+	int			i;
+
+#ifdef Q3_LITTLE_ENDIAN
+	if ((offset >> 3) + 8 <= (maxoffset >> 3)) {
+		/* one 64 bit store, the bytes past the code stay as they are */
+		uint64_t old, keep;
+
+		memcpy(&old, p, 8);
+		keep = ~0ULL << (bytes * 8);
+		if (shift) {
+			keep |= 0xff;
+		}
+		old = (old & keep) | v;
+		memcpy(p, &old, 8);
+		return;
+	}
+#endif
+
+	p[0] = (shift ? p[0] : 0) | (byte)v;
+	for (i = 1; i < bytes; i++) {
+		p[i] = (byte)(v >> (i * 8));
+	}
+}
+
+void Huff_tableTransmit( const huffTables_t *tables, int ch, byte *fout, int *offset, int maxoffset ) {
+	const int	len = tables->length[ch];
+	uint32_t	code = tables->code[ch];
+	int			pos = *offset;
+
+	if (pos + len > maxoffset) {
+		/* send whatever fits like send() does and flag the overflow */
+		for ( ; pos < maxoffset; pos++, code >>= 1) {
+			if ((pos&7) == 0) {
+				fout[(pos>>3)] = 0;
+			}
+			fout[(pos>>3)] |= (code & 1) << (pos&7);
+		}
+		*offset = maxoffset + 1;
+		return;
+	}
+
+	write_bits(fout, pos, maxoffset, code, len);
+	*offset = pos + len;
+}
+
+/* Huff_offsetReceive without the shared bit position */
+static void walk_tree(node_t *node, int *ch, byte *fin, int *offset, int pos, int maxoffset) {
+	while (node && node->symbol == INTERNAL_NODE) {
+		if (pos >= maxoffset) {
+			*ch = 0;
+			*offset = maxoffset + 1;
+			return;
+		}
+		if ((fin[(pos>>3)] >> (pos&7)) & 1) {
+			node = node->right;
+		} else {
+			node = node->left;
+		}
+		pos++;
+	}
+	if (!node) {
+		*ch = 0;
+		return;
+	}
+	*ch = node->symbol;
+	*offset = pos;
+}
+
+void Huff_tableReceive( const huffTables_t *tables, int *ch, byte *fin, int *offset, int maxoffset ) {
+	const byte	*p;
+	const int	pos = *offset;
+	int			index, len;
+
+	/* the lookup reads three bytes ahead, the last few bits go through the tree */
+	if (pos + 24 > maxoffset) {
+		walk_tree(tables->tree, ch, fin, offset, pos, maxoffset);
+		return;
+	}
+
+	p = fin + (pos >> 3);
+	index = ((p[0] | (p[1] << 8) | (p[2] << 16)) >> (pos & 7)) & ((1 << HUFF_LOOKUP_BITS) - 1);
+	len = tables->lookupLength[index];
+
+	if (len) {
+		*ch = tables->lookupSymbol[index];
+		*offset = pos + len;
+		return;
+	}
+
+	/* a long code, walk on from where the lookup ends */
+	walk_tree(tables->lookupNode[index], ch, fin, offset, pos + HUFF_LOOKUP_BITS, maxoffset);
+}
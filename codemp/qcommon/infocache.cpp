@@ -0,0 +1,166 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// infocache.cpp -- info strings that are patched instead of rebuilt
+
+#include "qcommon/qcommon.h"
+
+/*
+
+Info_SetValueForKey puts every new pair in front of the string and
+Info_SetValueForKey_Big puts it at the end, the big one also keeps pairs
+with empty values.  Both remove the key first, rescanning the whole string
+on every call, which is what makes building an info string from many
+values quadratic.  As long as the keys are unique and none of the pairs is
+refused, the result is simply the pairs one after another, which is what
+the cache keeps along with where each pair starts.
+
+*/
+
+/*
+===============
+InfoCache_Size
+===============
+*/
+static int InfoCache_Size( const infoCache_t *cache ) {
+	return cache->big ? BIG_INFO_STRING : MAX_INFO_STRING;
+}
+
+/*
+===============
+InfoCache_ValidString
+
+Info_SetValueForKey refuses these with a warning
+===============
+*/
+static qboolean InfoCache_ValidString( const char *s ) {
+	return (qboolean)( !strchr( s, '\\' ) && !strchr( s, ';' ) && !strchr( s, '"' ) );
+}
+
+/*
+===============
+InfoCache_Build
+===============
+*/
+qboolean InfoCache_Build( infoCache_t *cache, int numPairs, const char **keys, const char **values, const void **owners ) {
+	int				size = InfoCache_Size( cache );
+	int				i, n, length, keyLength, valueLength;
+	char			*out;
+	infoCachePair_t	*pair;
+
+	cache->valid = qfalse;
+	cache->numPairs = 0;
+
+	// see that every pair would have gone in
+	length = 0;
+	n = 0;
+	for ( i = 0 ; i < numPairs ; i++ ) {
+		if ( !InfoCache_ValidString( keys[i] ) || !InfoCache_ValidString( values[i] ) ) {
+			return qfalse;
+		}
+		if ( !cache->big && !values[i][0] ) {
+			continue;
+		}
+		length += strlen( keys[i] ) + strlen( values[i] ) + 2;
+		// the last pair added is the longest string checked
+		if ( length >= size || n == MAX_INFO_CACHE_PAIRS ) {
+			return qfalse;
+		}
+		n++;
+	}
+
+	// big strings append and small ones prepend
+	out = cache->info;
+	for ( n = 0 ; n < numPairs ; n++ ) {
+		i = cache->big ? n : numPairs - 1 - n;
+		if ( !cache->big && !values[i][0] ) {
+			continue;
+		}
+		keyLength = strlen( keys[i] );
+		valueLength = strlen( values[i] );
+
+		pair = &cache->pairs[cache->numPairs++];
+		pair->owner = owners[i];
+		pair->offset = out - cache->info;
+		pair->keyLength = keyLength;
+		pair->length = keyLength + valueLength + 2;
+
+		*out++ = '\\';
+		memcpy( out, keys[i], keyLength );
+		out += keyLength;
+		*out++ = '\\';
+		memcpy( out, values[i], valueLength );
+		out += valueLength;
+	}
+	*out = 0;
+
+	cache->length = length;
+	cache->valid = qtrue;
+	return qtrue;
+}
+
+/*
+===============
+InfoCache_SetValue
+===============
+*/
+qboolean InfoCache_SetValue( infoCache_t *cache, const void *owner, const char *value ) {
+	infoCachePair_t	*pair;
+	int				i, valueLength, oldLength, delta;
+	char			*start;
+
+	if ( !cache->valid ) {
+		return qfalse;
+	}
+
+	for ( i = 0, pair = cache->pairs ; i < cache->numPairs ; i++, pair++ ) {
+		if ( pair->owner == owner ) {
+			break;
+		}
+	}
+
+	valueLength = strlen( value );
+
+	// a pair that appears or goes away, a refused value or one that
+	// doesn't fit anymore all need the whole string made again
+	if ( i == cache->numPairs || ( !cache->big && !valueLength ) || !InfoCache_ValidString( value ) ) {
+		cache->valid = qfalse;
+		return qfalse;
+	}
+
+	oldLength = pair->length - pair->keyLength - 2;
+	delta = valueLength - oldLength;
+	if ( cache->length + delta >= InfoCache_Size( cache ) ) {
+		cache->valid = qfalse;
+		return qfalse;
+	}
+
+	start = cache->info + pair->offset + pair->keyLength + 2;
+	memmove( start + valueLength, start + oldLength, cache->length - ( start + oldLength - cache->info ) + 1 );
+	memcpy( start, value, valueLength );
+
+	cache->length += delta;
+	pair->length += delta;
+	for ( i++, pair++ ; i < cache->numPairs ; i++, pair++ ) {
+		pair->offset += delta;
+	}
+
+	return qtrue;
+}
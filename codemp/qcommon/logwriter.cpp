@@ -0,0 +1,295 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// logwriter.cpp -- writes log files from a background thread
+//
+// Only files handed over with FS_WriteInBackground are deferred: qconsole.log
+// and the game log, the file named by g_log (see GVM_FS_Open). Any other file,
+// including ones a mod opens for appending, is still written directly.
+//
+// FS_Write on a deferred file only queues the data. A writer thread wakes up
+// every com_logFlushMsec, writes everything queued for a file with a single
+// fwrite and flushes the files that asked for it (logfile 2, g_logSync) once
+// per batch, so a slow disk no longer stalls the frame.
+//
+// com_logFlushMsec is the most a line can be held back. The queue is written
+// out synchronously by LogWriter_Flush, which runs when a deferred file is
+// closed, flushed or FTell'd, on fatal errors and at exit. If the queue ever
+// fills up the caller catches up on the spot rather than losing lines.
+
+#include "qcommon/qcommon.h"
+#include "qcommon/ringbuffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define LW_QUEUE_SIZE		(512 * 1024)
+#define LW_BATCH_SIZE		(64 * 1024)
+#define LW_EXIT_WAIT_MSEC	1000
+
+typedef struct logWriterFile_s {
+	FILE		*file;
+	qboolean	sync;
+	qboolean	dirty;		// written since the last flush, only used by the writer
+} logWriterFile_t;
+
+static cvar_t			*com_logFlushMsec;
+
+static byteRing_t		lw_ring;			// tagged with the file handle
+static byte				lw_queue[LW_QUEUE_SIZE];
+static byte				lw_batch[LW_BATCH_SIZE];
+static logWriterFile_t	lw_files[MAX_FILE_HANDLES];
+
+static std::thread				*lw_thread;
+static std::mutex				lw_writeLock;	// held while the queue is written out
+static std::mutex				lw_wakeLock;
+static std::condition_variable	lw_wake;
+static std::atomic<bool>		lw_running( false );
+static std::atomic<int>			lw_flushMsec( 50 );
+
+/*
+=============================================================================
+
+WRITER
+
+Runs on the writer thread or, through LogWriter_Flush, on the main thread.
+Either way lw_writeLock is held. Nothing in here may call Com_Printf.
+
+=============================================================================
+*/
+
+static void LogWriter_WriteOut( int handle, const byte *data, size_t len ) {
+	logWriterFile_t *lf = &lw_files[handle];
+
+	while ( len ) {
+		const size_t written = fwrite( data, 1, len, lf->file );
+
+		if ( !written ) {
+			break;
+		}
+		data += written;
+		len -= written;
+	}
+	lf->dirty = qtrue;
+}
+
+/*
+==================
+LogWriter_Drain
+
+Writes out everything queued. Consecutive records for the same file are
+collected into one batch so each file gets a single write.
+==================
+*/
+static void LogWriter_Drain( void ) {
+	const byte *data;
+	uint32_t len;
+	int tag, batchTag = 0;
+	size_t batchLen = 0;
+	int i;
+
+	while ( (data = Ring_Peek( &lw_ring, &len, &tag )) != NULL ) {
+		if ( batchLen && (tag != batchTag || batchLen + len > LW_BATCH_SIZE) ) {
+			LogWriter_WriteOut( batchTag, lw_batch, batchLen );
+			batchLen = 0;
+		}
+
+		if ( len > LW_BATCH_SIZE ) {
+			LogWriter_WriteOut( tag, data, len );
+		} else {
+			memcpy( lw_batch + batchLen, data, len );
+			batchLen += len;
+			batchTag = tag;
+		}
+		Ring_Consume( &lw_ring, len );
+	}
+
+	if ( batchLen ) {
+		LogWriter_WriteOut( batchTag, lw_batch, batchLen );
+	}
+
+	for ( i = 0; i < MAX_FILE_HANDLES; i++ ) {
+		if ( lw_files[i].dirty ) {
+			if ( lw_files[i].sync ) {
+				fflush( lw_files[i].file );
+			}
+			lw_files[i].dirty = qfalse;
+		}
+	}
+}
+
+static void LogWriter_ThreadMain( void ) {
+	while ( lw_running ) {
+		{
+			std::unique_lock<std::mutex> lock( lw_wakeLock );
+			// nothing gets queued while com_logFlushMsec is 0
+			lw_wake.wait_for( lock, std::chrono::milliseconds( lw_flushMsec ? lw_flushMsec.load() : 1000 ) );
+		}
+
+		std::lock_guard<std::mutex> lock( lw_writeLock );
+		LogWriter_Drain();
+	}
+}
+
+/*
+=============================================================================
+
+MAIN THREAD INTERFACE
+
+=============================================================================
+*/
+
+/*
+==================
+LogWriter_Flush
+
+Writes out everything still queued before returning.
+==================
+*/
+void LogWriter_Flush( void ) {
+	std::lock_guard<std::mutex> lock( lw_writeLock );
+	LogWriter_Drain();
+}
+
+/*
+==================
+LogWriter_Write
+
+Called by FS_Write. Returns qfalse if the caller has to write the data
+itself, either because background writing is off or it doesn't fit the
+queue. Anything queued before is written first so lines stay in order.
+==================
+*/
+qboolean LogWriter_Write( fileHandle_t handle, FILE *file, qboolean sync, const void *data, int len ) {
+	logWriterFile_t *lf = &lw_files[handle];
+
+	if ( !lw_thread ) {
+		return qfalse;
+	}
+
+	if ( com_logFlushMsec->modified ) {
+		// cleared first, Cvar_CheckRange may print and end up back here
+		com_logFlushMsec->modified = qfalse;
+		Cvar_CheckRange( com_logFlushMsec, 0, 1000, qtrue );
+		lw_flushMsec = com_logFlushMsec->integer;
+	}
+
+	if ( !com_logFlushMsec->integer ) {
+		if ( Ring_Used( &lw_ring ) ) {
+			LogWriter_Flush();
+		}
+		return qfalse;
+	}
+
+	// only changes after the handle was closed, which flushes the queue first
+	if ( lf->file != file || lf->sync != sync ) {
+		std::lock_guard<std::mutex> lock( lw_writeLock );
+		LogWriter_Drain();
+		lf->file = file;
+		lf->sync = sync;
+	}
+
+	if ( !Ring_Write( &lw_ring, data, len, handle ) ) {
+		// the writer can't keep up, catch up here rather than drop lines
+		LogWriter_Flush();
+		if ( !Ring_Write( &lw_ring, data, len, handle ) ) {
+			return qfalse;
+		}
+	}
+
+	if ( Ring_Used( &lw_ring ) > LW_QUEUE_SIZE / 2 ) {
+		lw_wake.notify_one();
+	}
+	return qtrue;
+}
+
+/*
+==================
+LogWriter_AtExit
+
+Sys_Error and the signal handlers exit without closing the log files, make
+sure whatever is queued still reaches them. The writer thread may be stuck
+on a dying disk, so don't wait for it forever.
+==================
+*/
+static void LogWriter_AtExit( void ) {
+	for ( int i = 0; i < LW_EXIT_WAIT_MSEC; i++ ) {
+		if ( lw_writeLock.try_lock() ) {
+			lw_running = false;
+			LogWriter_Drain();
+			lw_writeLock.unlock();
+			return;
+		}
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+}
+
+/*
+==================
+LogWriter_Init
+==================
+*/
+void LogWriter_Init( void ) {
+	static qboolean registered = qfalse;
+
+	com_logFlushMsec = Cvar_Get( "com_logFlushMsec", "50", CVAR_ARCHIVE_ND, "Max time in msec log files are written behind, 0 writes them immediately" );
+	Cvar_CheckRange( com_logFlushMsec, 0, 1000, qtrue );
+	lw_flushMsec = com_logFlushMsec->integer;
+	com_logFlushMsec->modified = qfalse;
+
+	if ( lw_thread ) {
+		return;
+	}
+
+	Ring_Init( &lw_ring, lw_queue, LW_QUEUE_SIZE );
+	lw_running = true;
+	lw_thread = new std::thread( LogWriter_ThreadMain );
+
+	if ( !registered ) {
+		atexit( LogWriter_AtExit );
+		registered = qtrue;
+	}
+}
+
+/*
+==================
+LogWriter_Shutdown
+
+Writes out the queue and stops the writer, FS_Write is synchronous again
+afterwards.
+==================
+*/
+void LogWriter_Shutdown( void ) {
+	if ( !lw_thread ) {
+		return;
+	}
+
+	lw_running = false;
+	lw_wake.notify_one();
+	lw_thread->join();
+	delete lw_thread;
+	lw_thread = NULL;
+
+	LogWriter_Flush();
+	memset( lw_files, 0, sizeof( lw_files ) );
+}
@@ -26,10 +26,17 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/qcommon.h"
 #include "server/server.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MSG_SSE2
+	#include <emmintrin.h>
+#endif
+
 //#define _NEWHUFFTABLE_		// Build "c:\\netchan.bin"
 //#define _USINGNEWHUFFTABLE_		// Build a new frequency table to cut and paste.
 
 static huffman_t		msgHuff;
+static huffTables_t		msgHuffTables;		// the same tree as msgHuff, decoded up front
+static qboolean			msgHuffTablesValid = qfalse;
 
 static qboolean			msgInit = qfalse;
 #ifdef _NEWHUFFTABLE_
@@ -215,7 +222,11 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 #ifdef _NEWHUFFTABLE_
 				fwrite(&value, 1, 1, fp);
 #endif // _NEWHUFFTABLE_
-				Huff_offsetTransmit (&msgHuff.compressor, (value&0xff), msg->data, &msg->bit, msg->maxsize << 3);
+				if ( msgHuffTablesValid ) {
+					Huff_tableTransmit (&msgHuffTables, (value&0xff), msg->data, &msg->bit, msg->maxsize << 3);
+				} else {
+					Huff_offsetTransmit (&msgHuff.compressor, (value&0xff), msg->data, &msg->bit, msg->maxsize << 3);
+				}
 				value = (value>>8);
 
 				if ( msg->bit > msg->maxsize << 3 ) {
@@ -228,6 +239,54 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 	}
 }
 
+/*
+==================
+MSG_WriteBitString
+
+Appends numBits bits written to another message from bit 0 on, as if they
+were written here. The netchan Huffman tree never changes, so the encoded
+bits don't depend on where they start. The bits past numBits in the last
+byte of data have to be 0, as MSG_WriteBits leaves them.
+==================
+*/
+void MSG_WriteBitString( msg_t *msg, const byte *data, int numBits ) {
+	byte		*p;
+	int			shift, bytes, i;
+
+	if ( msg->oob ) {
+		Com_Error( ERR_DROP, "MSG_WriteBitString: not a bitstream" );
+	}
+	if ( msg->overflowed || numBits <= 0 ) {
+		return;
+	}
+	// callers that have to overflow exactly where MSG_WriteBits would check
+	// the room themselves
+	if ( msg->bit + numBits > msg->maxsize << 3 ) {
+		msg->overflowed = qtrue;
+		return;
+	}
+
+	p = msg->data + ( msg->bit >> 3 );
+	shift = msg->bit & 7;
+	bytes = ( numBits + 7 ) >> 3;
+
+	if ( !shift ) {
+		Com_Memcpy( p, data, bytes );
+	} else {
+		// the first byte keeps what is already in it, like Huff_putBit
+		p[0] |= data[0] << shift;
+		for ( i = 1; i < bytes; i++ ) {
+			p[i] = ( data[i - 1] >> ( 8 - shift ) ) | ( data[i] << shift );
+		}
+		if ( shift + numBits > bytes << 3 ) {
+			p[bytes] = data[bytes - 1] >> ( 8 - shift );
+		}
+	}
+
+	msg->bit += numBits;
+	msg->cursize = ( msg->bit >> 3 ) + 1;
+}
+
 int MSG_ReadBits( msg_t *msg, int bits ) {
 	int			value;
 	int			get;
@@ -286,7 +345,11 @@ int MSG_ReadBits( msg_t *msg, int bits ) {
 		}
 		if (bits) {
 			for(i=0;i<bits;i+=8) {
-				Huff_offsetReceive (msgHuff.decompressor.tree, &get, msg->data, &msg->bit, msg->cursize<<3);
+				if ( msgHuffTablesValid ) {
+					Huff_tableReceive (&msgHuffTables, &get, msg->data, &msg->bit, msg->cursize<<3);
+				} else {
+					Huff_offsetReceive (msgHuff.decompressor.tree, &get, msg->data, &msg->bit, msg->cursize<<3);
+				}
 #ifdef _NEWHUFFTABLE_
 				fwrite(&get, 1, 1, fp);
 #endif // _NEWHUFFTABLE_
@@ -1026,6 +1089,152 @@ netField_t	entityStateFields[] =
 #define	FLOAT_INT_BITS	13
 #define	FLOAT_INT_BIAS	(1<<(FLOAT_INT_BITS-1))
 
+/*
+==============================================================================
+
+Change detection
+
+Every networked field is a whole 32 bit word, so instead of going through
+the field table twice the delta writers compare the from and to structs a
+word at a time up front. A field map per table turns the changed words
+into a changed bit per field, in the order the fields are sent.
+
+==============================================================================
+*/
+
+// playerState_t is the bigger one
+#define	MAX_DELTA_WORDS		( sizeof( playerState_t ) / 4 )
+#define	DELTA_MASK_WORDS	( ( MAX_DELTA_WORDS + 31 ) / 32 )
+
+typedef struct netFieldMap_s {
+	qboolean	built;
+	qboolean	valid;		// every field is its own aligned word
+	int			numWords;
+	short		field[MAX_DELTA_WORDS];	// sent as this field, -1 if not sent
+} netFieldMap_t;
+
+static void MSG_BuildFieldMap( netFieldMap_t *map, const netField_t *fields, int numFields, size_t structSize ) {
+	int i, word;
+
+	map->built = qtrue;
+	map->valid = qfalse;
+	map->numWords = (int)( structSize / 4 );
+
+	if ( numFields > (int)MAX_DELTA_WORDS ) {
+		return;
+	}
+	for ( i = 0; i < map->numWords; i++ ) {
+		map->field[i] = -1;
+	}
+	for ( i = 0; i < numFields; i++ ) {
+		word = (int)( fields[i].offset / 4 );
+		if ( ( fields[i].offset & 3 ) || word >= map->numWords || map->field[word] != -1 ) {
+			return;
+		}
+		map->field[word] = i;
+	}
+	map->valid = qtrue;
+}
+
+// sets bit i of diff if word i differs
+static void MSG_CompareWords( const int *from, const int *to, int numWords, uint32_t *diff ) {
+	int i = 0;
+
+	Com_Memset( diff, 0, ( ( numWords + 31 ) / 32 ) * sizeof( *diff ) );
+
+#ifdef MSG_SSE2
+	for ( ; i + 16 <= numWords; i += 16 ) {
+		const __m128i eq0 = _mm_cmpeq_epi32( _mm_loadu_si128( (const __m128i *)( from + i ) ), _mm_loadu_si128( (const __m128i *)( to + i ) ) );
+		const __m128i eq1 = _mm_cmpeq_epi32( _mm_loadu_si128( (const __m128i *)( from + i + 4 ) ), _mm_loadu_si128( (const __m128i *)( to + i + 4 ) ) );
+		const __m128i eq2 = _mm_cmpeq_epi32( _mm_loadu_si128( (const __m128i *)( from + i + 8 ) ), _mm_loadu_si128( (const __m128i *)( to + i + 8 ) ) );
+		const __m128i eq3 = _mm_cmpeq_epi32( _mm_loadu_si128( (const __m128i *)( from + i + 12 ) ), _mm_loadu_si128( (const __m128i *)( to + i + 12 ) ) );
+		// one bit per word out of the sign of each compare
+		const uint32_t same = _mm_movemask_ps( _mm_castsi128_ps( eq0 ) )
+			| ( _mm_movemask_ps( _mm_castsi128_ps( eq1 ) ) << 4 )
+			| ( _mm_movemask_ps( _mm_castsi128_ps( eq2 ) ) << 8 )
+			| ( _mm_movemask_ps( _mm_castsi128_ps( eq3 ) ) << 12 );
+
+		diff[i >> 5] |= ( ~same & 0xffff ) << ( i & 31 );
+	}
+#endif
+
+	for ( ; i < numWords; i++ ) {
+		if ( from[i] != to[i] ) {
+			diff[i >> 5] |= 1u << ( i & 31 );
+		}
+	}
+}
+
+// the count bits of diff from bit first on, count is at most 32
+static uint32_t MSG_DiffBits( const uint32_t *diff, int first, int count ) {
+	uint64_t bits = diff[first >> 5];
+
+	if ( ( first & 31 ) + count > 32 ) {
+		bits |= (uint64_t)diff[( first >> 5 ) + 1] << 32;
+	}
+	bits >>= first & 31;
+	return (uint32_t)( bits & ( ( (uint64_t)1 << count ) - 1 ) );
+}
+
+/*
+==================
+MSG_DeltaFields
+
+Sets bit i of changed if field i differs between from and to and returns
+the number of fields up to the last changed one. diff gets the changed
+words of the whole struct.
+==================
+*/
+static int MSG_DeltaFields( netFieldMap_t *map, netField_t *fields, int numFields, size_t structSize,
+						   const void *from, const void *to, uint32_t *diff, uint32_t *changed ) {
+	netField_t	*field;
+	uint32_t	bits;
+	int			i, j, f, lc;
+
+	if ( !map->built ) {
+		MSG_BuildFieldMap( map, fields, numFields, structSize );
+	}
+
+	MSG_CompareWords( (const int *)from, (const int *)to, (int)( structSize / 4 ), diff );
+	Com_Memset( changed, 0, DELTA_MASK_WORDS * sizeof( *changed ) );
+	lc = 0;
+
+	if ( !map->valid ) {
+		// some field isn't a word of its own, go through the table
+		for ( i = 0, field = fields ; i < numFields ; i++, field++ ) {
+			const int *fromF = (const int *)( (const byte *)from + field->offset );
+			const int *toF = (const int *)( (const byte *)to + field->offset );
+			if ( *fromF != *toF ) {
+				changed[i >> 5] |= 1u << ( i & 31 );
+				lc = i+1;
+#ifndef FINAL_BUILD
+				field->mCount++;
+#endif
+			}
+		}
+		return lc;
+	}
+
+	for ( i = 0; i < map->numWords; i += 32 ) {
+		for ( bits = diff[i >> 5], j = i; bits; bits >>= 1, j++ ) {
+			if ( !( bits & 1 ) || ( f = map->field[j] ) < 0 ) {
+				continue;
+			}
+			changed[f >> 5] |= 1u << ( f & 31 );
+			if ( f >= lc ) {
+				lc = f+1;
+			}
+#ifndef FINAL_BUILD
+			fields[f].mCount++;
+#endif
+		}
+	}
+
+	return lc;
+}
+
+#define	FIELD_CHANGED( changed, i )	( ( changed )[( i ) >> 5] & ( 1u << ( ( i ) & 31 ) ) )
+
 /*
 ==================
 MSG_WriteDeltaEntity
@@ -1044,7 +1253,10 @@ void MSG_WriteDeltaEntity( msg_t *msg, struct entityState_s *from, struct entity
 	netField_t	*field;
 	int			trunc;
 	float		fullFloat;
-	int			*fromF, *toF;
+	int			*toF;
+	uint32_t	diff[DELTA_MASK_WORDS];
+	uint32_t	changed[DELTA_MASK_WORDS];
+	static netFieldMap_t	entityStateMap;
 
 	numFields = (int)ARRAY_LEN( entityStateFields );
 
@@ -1068,18 +1280,7 @@ void MSG_WriteDeltaEntity( msg_t *msg, struct entityState_s *from, struct entity
 		Com_Error (ERR_FATAL, "MSG_WriteDeltaEntity: Bad entity number: %i", to->number );
 	}
 
-	lc = 0;
-	// build the change vector as bytes so it is endian independent
-	for ( i = 0, field = entityStateFields ; i < numFields ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
-		toF = (int *)( (byte *)to + field->offset );
-		if ( *fromF != *toF ) {
-			lc = i+1;
-#ifndef FINAL_BUILD
-			field->mCount++;
-#endif
-		}
-	}
+	lc = MSG_DeltaFields( &entityStateMap, entityStateFields, numFields, sizeof( *from ), from, to, diff, changed );
 
 	if ( lc == 0 ) {
 		// nothing at all changed
@@ -1102,14 +1303,13 @@ void MSG_WriteDeltaEntity( msg_t *msg, struct entityState_s *from, struct entity
 	oldsize += numFields;
 
 	for ( i = 0, field = entityStateFields ; i < lc ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
-		toF = (int *)( (byte *)to + field->offset );
-
-		if ( *fromF == *toF ) {
+		if ( !FIELD_CHANGED( changed, i ) ) {
 			MSG_WriteBits( msg, 0, 1 );	// no change
 			continue;
 		}
 
+		toF = (int *)( (byte *)to + field->offset );
+
 		MSG_WriteBits( msg, 1, 1 );	// changed
 
 		if ( field->bits == 0 ) {
@@ -2104,9 +2304,17 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 	int				numFields;
 	netField_t		*field;
 	netField_t		*PSFields = playerStateFields;
-	int				*fromF, *toF;
+	int				*toF;
 	float			fullFloat;
 	int				trunc, lc;
+	uint32_t		diff[DELTA_MASK_WORDS];
+	uint32_t		changed[DELTA_MASK_WORDS];
+	static netFieldMap_t	playerStateMap;
+#ifdef _OPTIMIZED_VEHICLE_NETWORKING
+	static netFieldMap_t	pilotPlayerStateMap;
+	static netFieldMap_t	vehPlayerStateMap;
+#endif
+	netFieldMap_t	*map = &playerStateMap;
 #ifdef _ONEBIT_COMBO
 	int				bitComboMask = 0;
 	int				numBitsInMask = 0;
@@ -2123,6 +2331,7 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 	{//a vehicle playerstate
 		numFields = (int)ARRAY_LEN( vehPlayerStateFields );
 		PSFields = vehPlayerStateFields;
+		map = &vehPlayerStateMap;
 	}
 	else
 	{//regular client playerstate
@@ -2132,6 +2341,7 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 			MSG_WriteBits( msg, 1, 1 );	// Pilot player state
 			numFields = (int)ARRAY_LEN( pilotPlayerStateFields );
 			PSFields = pilotPlayerStateFields;
+			map = &pilotPlayerStateMap;
 		}
 		else
 		{//normal client
@@ -2144,17 +2354,7 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 	numFields = (int)ARRAY_LEN( playerStateFields );
 #endif// _OPTIMIZED_VEHICLE_NETWORKING
 
-	lc = 0;
-	for ( i = 0, field = PSFields ; i < numFields ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
-		toF = (int *)( (byte *)to + field->offset );
-		if ( *fromF != *toF ) {
-			lc = i+1;
-#ifndef FINAL_BUILD
-			field->mCount++;
-#endif
-		}
-	}
+	lc = MSG_DeltaFields( map, PSFields, numFields, sizeof( *from ), from, to, diff, changed );
 
 	MSG_WriteByte( msg, lc );	// # of changes
 
@@ -2165,7 +2365,6 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 	oldsize += numFields - lc;
 
 	for ( i = 0, field = PSFields ; i < lc ; i++, field++ ) {
-		fromF = (int *)( (byte *)from + field->offset );
 		toF = (int *)( (byte *)to + field->offset );
 
 #ifdef _ONEBIT_COMBO
@@ -2178,7 +2377,7 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 		}
 #endif
 
-		if ( *fromF == *toF ) {
+		if ( !FIELD_CHANGED( changed, i ) ) {
 			MSG_WriteBits( msg, 0, 1 );	// no change
 			continue;
 		}
@@ -2210,30 +2409,11 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct p
 	//
 	// send the arrays
 	//
-	statsbits = 0;
-	for (i=0 ; i<MAX_STATS ; i++) {
-		if (to->stats[i] != from->stats[i]) {
-			statsbits |= 1<<i;
-		}
-	}
-	persistantbits = 0;
-	for (i=0 ; i<MAX_PERSISTANT ; i++) {
-		if (to->persistant[i] != from->persistant[i]) {
-			persistantbits |= 1<<i;
-		}
-	}
-	ammobits = 0;
-	for (i=0 ; i<MAX_AMMO_TRANSMIT ; i++) {
-		if (to->ammo[i] != from->ammo[i]) {
-			ammobits |= 1<<i;
-		}
-	}
-	powerupbits = 0;
-	for (i=0 ; i<MAX_POWERUPS ; i++) {
-		if (to->powerups[i] != from->powerups[i]) {
-			powerupbits |= 1<<i;
-		}
-	}
+	// the arrays come straight out of the compare of the whole struct
+	statsbits = MSG_DiffBits( diff, offsetof( playerState_t, stats ) / 4, MAX_STATS );
+	persistantbits = MSG_DiffBits( diff, offsetof( playerState_t, persistant ) / 4, MAX_PERSISTANT );
+	ammobits = MSG_DiffBits( diff, offsetof( playerState_t, ammo ) / 4, MAX_AMMO_TRANSMIT );
+	powerupbits = MSG_DiffBits( diff, offsetof( playerState_t, powerups ) / 4, MAX_POWERUPS );
 
 	if (!statsbits && !persistantbits && !ammobits && !powerupbits) {
 		MSG_WriteBits( msg, 0, 1 );	// no change
@@ -3074,6 +3254,8 @@ void MSG_initHuffman() {
 			Huff_addRef(&msgHuff.decompressor,	(byte)i);			// Do update
 		}
 	}
+	// both trees saw the same updates, so one set of tables does for both
+	msgHuffTablesValid = Huff_BuildTables(&msgHuffTables, msgHuff.decompressor.tree);
 }
 
 #else
@@ -3109,6 +3291,7 @@ void MSG_initHuffman() {
 	}
 	Com_Printf("};\n");
 	FS_FreeFile( data );
+	msgHuffTablesValid = Huff_BuildTables(&msgHuffTables, msgHuff.decompressor.tree);
 	Cbuf_AddText( "condump dump.txt\n" );
 }
 
@@ -71,6 +71,15 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include <sys/filio.h>
 #endif
 
+#ifdef __linux__
+// receive with epoll and recvmmsg, net_recvBatch 0 goes back to select
+#define NET_BATCHED_RECV
+// the server frame sends with sendmmsg, net_sendBatch 0 sends right away
+#define NET_BATCHED_SEND
+#include <sys/epoll.h>
+#include <time.h>
+#endif
+
 typedef int SOCKET;
 #define INVALID_SOCKET                -1
 #define SOCKET_ERROR                        -1
@@ -97,6 +106,35 @@ static cvar_t	*net_port;
 
 static cvar_t	*net_dropsim;
 
+#ifdef NET_BATCHED_RECV
+#define	NET_MAX_RECV_BATCH	64
+
+static cvar_t	*net_recvBatch;
+
+static int				epoll_fd = -1;
+
+// the packets of one batch, the iovecs point into the slots for good
+static byte					recvSlots[NET_MAX_RECV_BATCH][MAX_MSGLEN + 1];
+static struct iovec			recvVecs[NET_MAX_RECV_BATCH];
+static struct sockaddr_in	recvAddrs[NET_MAX_RECV_BATCH];
+static struct mmsghdr		recvHeaders[NET_MAX_RECV_BATCH];
+#endif
+
+#ifdef NET_BATCHED_SEND
+#define	NET_MAX_SEND_BATCH	128
+#define	NET_SEND_SLOT		1536	// anything bigger than a full fragment is sent on its own
+
+static cvar_t	*net_sendBatch;
+
+static qboolean				sendBatching;
+static int					sendCount;
+static byte					sendSlots[NET_MAX_SEND_BATCH][NET_SEND_SLOT];
+static struct iovec			sendVecs[NET_MAX_SEND_BATCH];
+static struct sockaddr_in	sendAddrs[NET_MAX_SEND_BATCH];
+static struct mmsghdr		sendHeaders[NET_MAX_SEND_BATCH];
+static netadrtype_t			sendTypes[NET_MAX_SEND_BATCH];
+#endif
+
 static struct sockaddr_in	socksRelayAddr;
 
 static SOCKET	ip_socket = INVALID_SOCKET;
@@ -247,6 +285,43 @@ Receive one packet
 int	recvfromCount;
 #endif
 
+/*
+==================
+NET_ReceivedPacket
+
+Strips the socks header and fills in the sender, ret is what the socket
+returned for the packet.
+==================
+*/
+static qboolean NET_ReceivedPacket( struct sockaddr_in *from, socklen_t fromlen, int ret, netadr_t *net_from, msg_t *net_message ) {
+	memset( from->sin_zero, 0, 8 );
+
+	if ( usingSocks && memcmp( from, &socksRelayAddr, fromlen ) == 0 ) {
+		if ( ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 || net_message->data[2] != 0 || net_message->data[3] != 1 ) {
+			return qfalse;
+		}
+		net_from->type = NA_IP;
+		net_from->ip[0] = net_message->data[4];
+		net_from->ip[1] = net_message->data[5];
+		net_from->ip[2] = net_message->data[6];
+		net_from->ip[3] = net_message->data[7];
+		memcpy( &net_from->port, &net_message->data[8], 2 );
+		net_message->readcount = 10;
+	}
+	else {
+		SockadrToNetadr( from, net_from );
+		net_message->readcount = 0;
+	}
+
+	if( ret >= net_message->maxsize ) {
+		Com_Printf( "Oversize packet from %s\n", NET_AdrToString (*net_from) );
+		return qfalse;
+	}
+
+	net_message->cursize = ret;
+	return qtrue;
+}
+
 qboolean NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
 	int ret, err;
 	socklen_t fromlen;
@@ -272,37 +347,139 @@ qboolean NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
 		return qfalse;
 	}
 
-	memset( from.sin_zero, 0, 8 );
+	return NET_ReceivedPacket( &from, fromlen, ret, net_from, net_message );
+}
 
-	if ( usingSocks && memcmp( &from, &socksRelayAddr, fromlen ) == 0 ) {
-		if ( ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 || net_message->data[2] != 0 || net_message->data[3] != 1 ) {
-			return qfalse;
-		}
-		net_from->type = NA_IP;
-		net_from->ip[0] = net_message->data[4];
-		net_from->ip[1] = net_message->data[5];
-		net_from->ip[2] = net_message->data[6];
-		net_from->ip[3] = net_message->data[7];
-		memcpy( &net_from->port, &net_message->data[8], 2 );
-		net_message->readcount = 10;
+//=============================================================================
+
+static char socksBuf[4096];
+
+/*
+==================
+NET_SendError
+==================
+*/
+static void NET_SendError( netadrtype_t type ) {
+	int err = socketError;
+
+	// wouldblock is silent
+	if( err == EAGAIN ) {
+		return;
 	}
-	else {
-		SockadrToNetadr( &from, net_from );
-		net_message->readcount = 0;
+
+	// some PPP links do not allow broadcasts and return an error
+	if( err == EADDRNOTAVAIL && type == NA_BROADCAST ) {
+		return;
 	}
 
-	if( ret >= net_message->maxsize ) {
-		Com_Printf( "Oversize packet from %s\n", NET_AdrToString (*net_from) );
+	Com_Printf( "NET_SendPacket: %s\n", NET_ErrorString() );
+}
+
+#ifdef NET_BATCHED_SEND
+/*
+==================
+NET_BeginSendBatch
+
+Packets sent until NET_FlushSendBatch are queued up and go out with as few
+sendmmsg calls as possible. They keep their order.
+==================
+*/
+void NET_BeginSendBatch( void ) {
+	NET_FlushSendBatch();
+
+	if ( net_sendBatch && net_sendBatch->integer && ip_socket != INVALID_SOCKET ) {
+		sendBatching = qtrue;
+	}
+}
+
+/*
+==================
+NET_FlushSendBatch
+==================
+*/
+void NET_FlushSendBatch( void ) {
+	int sent = 0;
+
+	sendBatching = qfalse;
+
+	while ( sent < sendCount && ip_socket != INVALID_SOCKET ) {
+		const int ret = sendmmsg( ip_socket, sendHeaders + sent, sendCount - sent, 0 );
+
+		c_netSendCalls++;
+		if ( ret == SOCKET_ERROR ) {
+			// skip the packet that failed, like sendto would have
+			NET_SendError( sendTypes[sent] );
+			sent++;
+		} else {
+			c_netSendPackets += ret;
+			sent += ret;
+		}
+	}
+
+	sendCount = 0;
+}
+
+/*
+==================
+NET_QueuePacket
+
+Returns qfalse if the packet has to be sent right away.
+==================
+*/
+static qboolean NET_QueuePacket( int length, const void *data, netadrtype_t type, struct sockaddr_in *addr ) {
+	byte *slot;
+	int offset = 0;
+
+	if ( !sendBatching || length + 10 > NET_SEND_SLOT ) {
+		// keep the order of what is queued already
+		if ( sendCount ) {
+			NET_FlushSendBatch();
+			sendBatching = qtrue;
+		}
 		return qfalse;
 	}
 
-	net_message->cursize = ret;
+	if ( sendCount == NET_MAX_SEND_BATCH ) {
+		NET_FlushSendBatch();
+		sendBatching = qtrue;
+	}
+
+	slot = sendSlots[sendCount];
+
+	if( usingSocks && type == NA_IP ) {
+		slot[0] = 0;	// reserved
+		slot[1] = 0;
+		slot[2] = 0;	// fragment (not fragmented)
+		slot[3] = 1;	// address type: IPV4
+		memcpy( &slot[4], &addr->sin_addr, 4 );
+		memcpy( &slot[8], &addr->sin_port, 2 );
+		offset = 10;
+		sendAddrs[sendCount] = socksRelayAddr;
+	}
+	else {
+		sendAddrs[sendCount] = *addr;
+	}
+	memcpy( slot + offset, data, length );
+
+	sendVecs[sendCount].iov_base = slot;
+	sendVecs[sendCount].iov_len = length + offset;
+	memset( &sendHeaders[sendCount], 0, sizeof( sendHeaders[sendCount] ) );
+	sendHeaders[sendCount].msg_hdr.msg_name = &sendAddrs[sendCount];
+	sendHeaders[sendCount].msg_hdr.msg_namelen = sizeof( sendAddrs[sendCount] );
+	sendHeaders[sendCount].msg_hdr.msg_iov = &sendVecs[sendCount];
+	sendHeaders[sendCount].msg_hdr.msg_iovlen = 1;
+	sendTypes[sendCount] = type;
+	sendCount++;
+
 	return qtrue;
 }
+#else
+void NET_BeginSendBatch( void ) {
+}
 
-//=============================================================================
-
-static char socksBuf[4096];
+void NET_FlushSendBatch( void ) {
+}
+#endif
 
 /*
 ==================
@@ -324,6 +501,12 @@ void Sys_SendPacket( int length, const void *data, netadr_t to ) {
 
 	NetadrToSockadr( &to, &addr );
 
+#ifdef NET_BATCHED_SEND
+	if ( NET_QueuePacket( length, data, to.type, &addr ) ) {
+		return;
+	}
+#endif
+
 	if( usingSocks && to.type == NA_IP ) {
 		socksBuf[0] = 0;	// reserved
 		socksBuf[1] = 0;
@@ -337,20 +520,11 @@ void Sys_SendPacket( int length, const void *data, netadr_t to ) {
 	else {
 		ret = sendto( ip_socket, (const char *)data, length, 0, (sockaddr *)&addr, sizeof(addr) );
 	}
+	c_netSendCalls++;
 	if( ret == SOCKET_ERROR ) {
-		int err = socketError;
-
-		// wouldblock is silent
-		if( err == EAGAIN ) {
-			return;
-		}
-
-		// some PPP links do not allow broadcasts and return an error
-		if( err == EADDRNOTAVAIL && to.type == NA_BROADCAST ) {
-			return;
-		}
-
-		Com_Printf( "NET_SendPacket: %s\n", NET_ErrorString() );
+		NET_SendError( to.type );
+	} else {
+		c_netSendPackets++;
 	}
 }
 
@@ -372,6 +546,14 @@ int Sys_SendPacket_Status(int length, const void *data, netadr_t to) {
 		return 0;
 	}
 
+#ifdef NET_BATCHED_SEND
+	// keep the order of what is queued already
+	if ( sendCount ) {
+		NET_FlushSendBatch();
+		sendBatching = qtrue;
+	}
+#endif
+
 	NetadrToSockadr(&to, &addr);
 
 	if (usingSocks && to.type == NA_IP) {
@@ -402,6 +584,116 @@ int Sys_SendPacket_Status(int length, const void *data, netadr_t to) {
 
 //=============================================================================
 
+/*
+==================
+Sys_RemoteLogOpen
+
+Opens the socket used by the remote log shipper. This is kept apart from the
+game socket so log traffic never competes with client packets. Must be called
+from the main thread, the socket is only used by the shipper thread afterwards.
+==================
+*/
+static SOCKET log_socket = INVALID_SOCKET;
+
+SOCKET NET_IPSocket( char *net_interface, int port, int *err );
+
+qboolean Sys_RemoteLogOpen( void ) {
+	int err;
+
+	if ( log_socket != INVALID_SOCKET ) {
+		return qtrue;
+	}
+
+	log_socket = NET_IPSocket( net_ip ? net_ip->string : NULL, PORT_ANY, &err );
+	return (qboolean)(log_socket != INVALID_SOCKET);
+}
+
+/*
+==================
+Sys_RemoteLogClose
+==================
+*/
+void Sys_RemoteLogClose( void ) {
+	if ( log_socket != INVALID_SOCKET ) {
+		closesocket( log_socket );
+		log_socket = INVALID_SOCKET;
+	}
+}
+
+/*
+==================
+Sys_RemoteLogSend
+
+Safe to call from the shipper thread: never prints, the socket error is
+returned through *err instead. Returns the number of bytes sent, 0 if the
+socket would block and -1 on error.
+==================
+*/
+int Sys_RemoteLogSend( const void *data, int length, const netadr_t *to, int *err ) {
+	struct sockaddr_in	addr;
+	int					ret;
+
+	*err = 0;
+
+	if ( log_socket == INVALID_SOCKET || to->type != NA_IP ) {
+		return -1;
+	}
+
+	NetadrToSockadr( (netadr_t *)to, &addr );
+
+	ret = sendto( log_socket, (const char *)data, length, 0, (sockaddr *)&addr, sizeof(addr) );
+	if ( ret == SOCKET_ERROR ) {
+		*err = socketError;
+		if ( *err == EAGAIN ) {
+			return 0;
+		}
+		return -1;
+	}
+
+	return ret;
+}
+
+/*
+==================
+Sys_RemoteLogReceive
+
+Waits up to msec for a packet on the remote log socket. Like
+Sys_RemoteLogSend this is called from the shipper thread and never prints.
+Returns the packet length, 0 on timeout and -1 on error.
+==================
+*/
+int Sys_RemoteLogReceive( void *data, int maxlen, netadr_t *from, int msec ) {
+	struct timeval		timeout;
+	struct sockaddr_in	addr;
+	socklen_t			addrlen = sizeof( addr );
+	fd_set				fdr;
+	int					ret;
+
+	if ( log_socket == INVALID_SOCKET ) {
+		return -1;
+	}
+
+	FD_ZERO( &fdr );
+	FD_SET( log_socket, &fdr );
+	timeout.tv_sec = msec / 1000;
+	timeout.tv_usec = (msec % 1000) * 1000;
+
+	ret = select( log_socket + 1, &fdr, NULL, NULL, &timeout );
+	if ( ret <= 0 ) {
+		return ret;
+	}
+
+	ret = recvfrom( log_socket, (char *)data, maxlen, 0, (struct sockaddr *)&addr, &addrlen );
+	if ( ret == SOCKET_ERROR || addr.sin_family != AF_INET ) {
+		return -1;
+	}
+
+	SockadrToNetadr( &addr, from );
+	return ret;
+}
+
+//=============================================================================
+
 /*
 ==================
 Sys_IsLANAddress
@@ -891,6 +1183,64 @@ void NET_OpenIP( void )
 	}
 }
 
+#ifdef NET_BATCHED_RECV
+static int64_t NET_Microseconds( void ) {
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+====================
+NET_OpenEpoll
+
+The receive slots are set up once, only the address lengths have to be
+reset for every batch.
+====================
+*/
+static void NET_OpenEpoll( void ) {
+	struct epoll_event ev;
+	int i;
+
+	if ( ip_socket == INVALID_SOCKET ) {
+		return;
+	}
+
+	epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+	if ( epoll_fd == -1 ) {
+		Com_Printf( "WARNING: epoll_create1: %s, using select\n", NET_ErrorString() );
+		return;
+	}
+
+	memset( &ev, 0, sizeof( ev ) );
+	ev.events = EPOLLIN;
+	ev.data.fd = ip_socket;
+	if ( epoll_ctl( epoll_fd, EPOLL_CTL_ADD, ip_socket, &ev ) == -1 ) {
+		Com_Printf( "WARNING: epoll_ctl: %s, using select\n", NET_ErrorString() );
+		close( epoll_fd );
+		epoll_fd = -1;
+		return;
+	}
+
+	for ( i = 0; i < NET_MAX_RECV_BATCH; i++ ) {
+		recvVecs[i].iov_base = recvSlots[i];
+		recvVecs[i].iov_len = sizeof( recvSlots[i] );
+		memset( &recvHeaders[i], 0, sizeof( recvHeaders[i] ) );
+		recvHeaders[i].msg_hdr.msg_name = &recvAddrs[i];
+		recvHeaders[i].msg_hdr.msg_iov = &recvVecs[i];
+		recvHeaders[i].msg_hdr.msg_iovlen = 1;
+	}
+}
+
+static void NET_CloseEpoll( void ) {
+	if ( epoll_fd != -1 ) {
+		close( epoll_fd );
+		epoll_fd = -1;
+	}
+}
+#endif
+
 //===================================================================
 
 /*
@@ -939,6 +1289,14 @@ static qboolean NET_GetCvars( void ) {
 
 	net_dropsim = Cvar_Get( "net_dropsim", "", CVAR_TEMP);
 
+#ifdef NET_BATCHED_RECV
+	net_recvBatch = Cvar_Get( "net_recvBatch", "32", CVAR_ARCHIVE_ND, "Packets read per recvmmsg call, 0 uses select and recvfrom" );
+	Cvar_CheckRange( net_recvBatch, 0, NET_MAX_RECV_BATCH, qtrue );
+#endif
+#ifdef NET_BATCHED_SEND
+	net_sendBatch = Cvar_Get( "net_sendBatch", "1", CVAR_ARCHIVE_ND, "Send the packets of a server frame together with sendmmsg" );
+#endif
+
 	return modified ? qtrue : qfalse;
 }
 
@@ -985,6 +1343,10 @@ void NET_Config( qboolean enableNetworking ) {
 	}
 
 	if ( stop ) {
+		NET_FlushSendBatch();
+#ifdef NET_BATCHED_RECV
+		NET_CloseEpoll();
+#endif
 		if ( ip_socket != INVALID_SOCKET ) {
 			closesocket( ip_socket );
 			ip_socket = INVALID_SOCKET;
@@ -999,6 +1361,9 @@ void NET_Config( qboolean enableNetworking ) {
 	if ( start ) {
 		if ( net_enabled->integer )
 			NET_OpenIP();
+#ifdef NET_BATCHED_RECV
+		NET_OpenEpoll();
+#endif
 	}
 }
 
@@ -1041,6 +1406,25 @@ void NET_Shutdown( void ) {
 #endif
 }
 
+/*
+====================
+NET_DispatchPacket
+====================
+*/
+static void NET_DispatchPacket( netadr_t *from, msg_t *netmsg ) {
+	if(net_dropsim->value > 0.0f && net_dropsim->value <= 100.0f)
+	{
+		// com_dropsim->value percent of incoming packets get dropped.
+		if(rand() < (int) (((double) RAND_MAX) / 100.0 * (double) net_dropsim->value))
+			return;          // drop this packet
+	}
+
+	if(com_sv_running->integer)
+		Com_RunAndTimeServerPacket(from, netmsg);
+	else
+		CL_PacketEvent(*from, netmsg);
+}
+
 /*
 ====================
 NET_Event
@@ -1060,23 +1444,66 @@ void NET_Event(fd_set *fdr)
 		MSG_Init(&netmsg, bufData, sizeof(bufData));
 
 		if(NET_GetPacket(&from, &netmsg, fdr))
-		{
-			if(net_dropsim->value > 0.0f && net_dropsim->value <= 100.0f)
-			{
-				// com_dropsim->value percent of incoming packets get dropped.
-				if(rand() < (int) (((double) RAND_MAX) / 100.0 * (double) net_dropsim->value))
-					continue;          // drop this packet
+			NET_DispatchPacket(&from, &netmsg);
+		else
+			break;
+	}
+}
+
+#ifdef NET_BATCHED_RECV
+/*
+====================
+NET_EventBatch
+
+Reads up to net_recvBatch packets with every recvmmsg until the socket is
+drained.
+====================
+*/
+static void NET_EventBatch( void ) {
+	netadr_t from;
+	msg_t netmsg;
+
+	while ( ip_socket != INVALID_SOCKET ) {
+		const int batch = Com_Clampi( 1, NET_MAX_RECV_BATCH, net_recvBatch->integer );
+		int64_t start, received;
+		int count, i;
+
+		for ( i = 0; i < batch; i++ ) {
+			recvHeaders[i].msg_hdr.msg_namelen = sizeof( recvAddrs[i] );
+		}
+
+		start = NET_Microseconds();
+		count = recvmmsg( ip_socket, recvHeaders, batch, MSG_DONTWAIT, NULL );
+		received = NET_Microseconds();
+
+		if ( count == SOCKET_ERROR ) {
+			if ( socketError != EAGAIN && socketError != ECONNRESET ) {
+				Com_Printf( "NET_EventBatch: %s\n", NET_ErrorString() );
 			}
+			break;
+		}
+
+		for ( i = 0; i < count && ip_socket != INVALID_SOCKET; i++ ) {
+			MSG_Init( &netmsg, recvSlots[i], sizeof( recvSlots[i] ) );
 
-			if(com_sv_running->integer)
-				Com_RunAndTimeServerPacket(&from, &netmsg);
-			else
-				CL_PacketEvent(from, &netmsg);
+			if ( NET_ReceivedPacket( &recvAddrs[i], recvHeaders[i].msg_hdr.msg_namelen, recvHeaders[i].msg_len, &from, &netmsg ) ) {
+				NET_DispatchPacket( &from, &netmsg );
+			}
 		}
-		else
+
+		c_netBatches++;
+		c_netPackets += count;
+		time_netRecv += (int)(received - start);
+		if ( com_speeds->integer == 3 ) {
+			Com_Printf( "NET batch: %i packets, recv %i usec, process %i usec\n", count, (int)(received - start), (int)(NET_Microseconds() - received) );
+		}
+
+		if ( count < batch ) {
 			break;
+		}
 	}
 }
+#endif
 
 /*
 ====================
@@ -1094,6 +1521,23 @@ void NET_Sleep( int msec ) {
 	if (msec < 0)
 		msec = 0;
 
+	// a frame cut short by an error may have left packets queued
+	NET_FlushSendBatch();
+
+#ifdef NET_BATCHED_RECV
+	if ( epoll_fd != -1 && net_recvBatch->integer > 0 ) {
+		struct epoll_event ev;
+
+		retval = epoll_wait( epoll_fd, &ev, 1, msec );
+
+		if ( retval == SOCKET_ERROR && socketError != EINTR )
+			Com_Printf( "Warning: epoll_wait() syscall failed: %s\n", NET_ErrorString() );
+		else if ( retval > 0 )
+			NET_EventBatch();
+		return;
+	}
+#endif
+
 	FD_ZERO(&fdset);
 	if (ip_socket != INVALID_SOCKET) {
 		FD_SET(ip_socket, &fdset); // network socket
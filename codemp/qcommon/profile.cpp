@@ -0,0 +1,198 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// profile.cpp -- per frame timing of the main server phases
+//
+// Every PROFILE_SCOPE adds its time to the zone's total for the frame. At the
+// end of the frame the totals go into a history of the last PROFILE_FRAMES
+// frames, which "profile" turns into p50 / p99 / max per zone.
+//
+// With com_profileStream set, the same numbers over the frames since the last
+// one are sent as a remote log event every com_profileStream msec, e.g.
+//   {"event":"profile","time":51250,"frames":40,"zones":{"eventloop":[12,80,95],...}}
+// each zone being [p50, p99, max] in usec.
+
+#include "qcommon/qcommon.h"
+
+#include <algorithm>
+
+#define PROFILE_FRAMES		1024		// must be a power of two
+
+static const char *profileZoneNames[PROF_MAX] = {
+	"eventloop",
+	"packetevent",
+	"serverframe",
+	"gameframe",
+	"g2collision",
+	"snapshot",
+	"deltaencode",
+	"netsend"
+};
+
+typedef struct profileFrame_s {
+	int64_t		nsec[PROF_MAX];
+	int			calls[PROF_MAX];
+} profileFrame_t;
+
+static profileFrame_t	profileCurrent;
+static profileFrame_t	profileHistory[PROFILE_FRAMES];
+static int				profileFrames;			// ever recorded, the history has the last ones
+static int				profileStreamFrame;		// profileFrames at the last stream
+static int				profileStreamTime;
+
+qboolean		com_profiling;
+
+static cvar_t	*com_profile;
+static cvar_t	*com_profileStream;
+
+typedef struct profileStats_s {
+	int64_t		p50, p99, max;
+	float		calls;					// per frame
+} profileStats_t;
+
+/*
+==================
+Profile_Add
+==================
+*/
+void Profile_Add( profileZone_t zone, int64_t nsec ) {
+	profileCurrent.nsec[zone] += nsec;
+	profileCurrent.calls[zone]++;
+}
+
+/*
+==================
+Profile_Stats
+
+Spread of the zone totals over the last numFrames frames
+==================
+*/
+static void Profile_Stats( profileZone_t zone, int numFrames, profileStats_t *stats ) {
+	static int64_t	sorted[PROFILE_FRAMES];
+	int				i, calls;
+
+	calls = 0;
+	for ( i = 0 ; i < numFrames ; i++ ) {
+		const profileFrame_t *frame = &profileHistory[( profileFrames - 1 - i ) & ( PROFILE_FRAMES - 1 )];
+
+		sorted[i] = frame->nsec[zone];
+		calls += frame->calls[zone];
+	}
+	std::sort( sorted, sorted + numFrames );
+
+	stats->p50 = sorted[( numFrames - 1 ) * 50 / 100];
+	stats->p99 = sorted[( numFrames - 1 ) * 99 / 100];
+	stats->max = sorted[numFrames - 1];
+	stats->calls = (float)calls / numFrames;
+}
+
+/*
+==================
+Profile_Stream
+==================
+*/
+static void Profile_Stream( void ) {
+	char			event[MAXPRINTMSG];
+	profileStats_t	stats;
+	int				i, numFrames;
+
+	numFrames = Q_min( profileFrames - profileStreamFrame, PROFILE_FRAMES );
+	profileStreamFrame = profileFrames;
+	if ( numFrames <= 0 ) {
+		return;
+	}
+
+	Com_sprintf( event, sizeof( event ), "{\"event\":\"profile\",\"time\":%i,\"frames\":%i,\"zones\":{", com_frameTime, numFrames );
+	for ( i = 0 ; i < PROF_MAX ; i++ ) {
+		Profile_Stats( (profileZone_t)i, numFrames, &stats );
+		Q_strcat( event, sizeof( event ), va( "%s\"%s\":[%i,%i,%i]", i ? "," : "", profileZoneNames[i],
+			(int)( stats.p50 / 1000 ), (int)( stats.p99 / 1000 ), (int)( stats.max / 1000 ) ) );
+	}
+	Q_strcat( event, sizeof( event ), "}}\n" );
+
+	RemoteLog_Event( event );
+}
+
+/*
+==================
+Profile_EndFrame
+
+Files the totals of the frame that just ended
+==================
+*/
+void Profile_EndFrame( void ) {
+	if ( com_profiling ) {
+		profileHistory[profileFrames & ( PROFILE_FRAMES - 1 )] = profileCurrent;
+		profileFrames++;
+
+		if ( com_profileStream->integer > 0 && RemoteLog_EventsEnabled()
+			&& com_frameTime - profileStreamTime >= com_profileStream->integer ) {
+			profileStreamTime = com_frameTime;
+			Profile_Stream();
+		}
+	}
+
+	memset( &profileCurrent, 0, sizeof( profileCurrent ) );
+	com_profiling = com_profile->integer ? qtrue : qfalse;
+}
+
+/*
+==================
+Profile_f
+==================
+*/
+static void Profile_f( void ) {
+	profileStats_t	stats;
+	int				i, numFrames;
+
+	if ( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		profileFrames = profileStreamFrame = 0;
+		Com_Printf( "Profile history cleared.\n" );
+		return;
+	}
+
+	numFrames = Q_min( profileFrames, PROFILE_FRAMES );
+	if ( !numFrames ) {
+		Com_Printf( "No frames profiled%s.\n", com_profile->integer ? " yet" : ", set com_profile 1" );
+		return;
+	}
+
+	Com_Printf( "Last %i frames, usec per frame:\n", numFrames );
+	Com_Printf( "zone         calls      p50      p99      max\n" );
+	Com_Printf( "------------ ------ -------- -------- --------\n" );
+	for ( i = 0 ; i < PROF_MAX ; i++ ) {
+		Profile_Stats( (profileZone_t)i, numFrames, &stats );
+		Com_Printf( "%-12s %6.1f %8.1f %8.1f %8.1f\n", profileZoneNames[i], stats.calls,
+			stats.p50 / 1000.0f, stats.p99 / 1000.0f, stats.max / 1000.0f );
+	}
+}
+
+/*
+==================
+Profile_Init
+==================
+*/
+void Profile_Init( void ) {
+	com_profile = Cvar_Get( "com_profile", "0", CVAR_NONE, "Time the server phases for the profile command" );
+	com_profileStream = Cvar_Get( "com_profileStream", "0", CVAR_ARCHIVE_ND, "Send the profile to the remote log every this many msec, 0 to not" );
+	com_profiling = com_profile->integer ? qtrue : qfalse;
+
+	Cmd_AddCommand( "profile", Profile_f, "Show per frame timings of the server phases, \"profile reset\" clears them" );
+}
@@ -56,6 +56,7 @@ struct entityState_s;
 struct playerState_s;
 
 void MSG_WriteBits( msg_t *msg, int value, int bits );
+void MSG_WriteBitString( msg_t *msg, const byte *data, int numBits );
 
 void MSG_WriteChar (msg_t *sb, int c);
 void MSG_WriteByte (msg_t *sb, int c);
@@ -148,9 +149,15 @@ const char	*NET_AdrToString (netadr_t a);
 qboolean	NET_StringToAdr ( const char *s, netadr_t *a);
 qboolean	NET_GetLoopPacket (netsrc_t sock, netadr_t *net_from, msg_t *net_message);
 void		NET_Sleep(int msec);
+void		NET_BeginSendBatch( void );
+void		NET_FlushSendBatch( void );
 
 void		Sys_SendPacket( int length, const void *data, netadr_t to );
 int			Sys_SendPacket_Status( int length, const void *data, netadr_t to );
+qboolean	Sys_RemoteLogOpen( void );
+void		Sys_RemoteLogClose( void );
+int			Sys_RemoteLogSend( const void *data, int length, const netadr_t *to, int *err );
+int			Sys_RemoteLogReceive( void *data, int maxlen, netadr_t *from, int msec );
 //Does NOT parse port numbers, only base addresses.
 qboolean	Sys_StringToAdr( const char *s, netadr_t *a );
 qboolean	Sys_IsLANAddress (netadr_t adr);
@@ -547,6 +554,97 @@ extern uint32_t cvar_modifiedFlags;
 // etc, variables have been modified since the last check.  The bit
 // can then be cleared to allow another change detection.
 
+extern int cvar_modifiedCount;
+// bumped along with cvar_modifiedFlags but never cleared, so any number of
+// caches of cvar values can each tell whether they are out of date
+
+/*
+==============================================================
+
+PROFILER
+
+Zones time parts of the frame while com_profile is set, "profile" shows the
+spread of their per frame totals. Zones may be nested, every zone counts all
+of its own time.
+==============================================================
+*/
+
+typedef enum {
+	PROF_EVENTLOOP,			// Com_EventLoop, includes the packets
+	PROF_PACKETEVENT,		// SV_PacketEvent
+	PROF_SERVERFRAME,		// SV_Frame
+	PROF_GAMEFRAME,			// GVM_RunFrame
+	PROF_G2COLLISION,		// ghoul2 traces, mostly inside the game frame
+	PROF_SNAPSHOT,			// SV_BuildClientSnapshot
+	PROF_DELTAENCODE,		// SV_WriteSnapshotToClient
+	PROF_NETSEND,			// SV_Netchan_Transmit
+	PROF_MAX
+} profileZone_t;
+
+extern qboolean	com_profiling;		// com_profile, looked at once per frame
+
+void	Profile_Init( void );
+void	Profile_Add( profileZone_t zone, int64_t nsec );
+void	Profile_EndFrame( void );
+
+class profileScope_c
+{
+private:
+	profileZone_t	zone;
+	int64_t			start;
+
+public:
+	explicit profileScope_c( profileZone_t z ) : zone( z ), start( com_profiling ? Sys_Nanoseconds() : 0 )
+	{
+	}
+
+	~profileScope_c()
+	{
+		if ( start ) {
+			Profile_Add( zone, Sys_Nanoseconds() - start );
+		}
+	}
+};
+
+#define PROFILE_SCOPE( zone ) profileScope_c profileScope( zone )
+
+/*
+==============================================================
+
+INFO STRING CACHE
+
+An info string that is kept between builds and has single values patched
+in place, while coming out the same as if Info_SetValueForKey or
+Info_SetValueForKey_Big had been called for every pair again.
+==============================================================
+*/
+
+#define MAX_INFO_CACHE_PAIRS	( BIG_INFO_STRING / 3 + 1 )
+
+typedef struct infoCachePair_s {
+	const void	*owner;		// whatever the caller identifies the pair by
+	int			offset;		// of the '\\' in front of the key
+	int			keyLength;
+	int			length;		// of the whole pair
+} infoCachePair_t;
+
+typedef struct infoCache_s {
+	qboolean		big;		// Info_SetValueForKey_Big rules
+	qboolean		valid;
+	int				length;
+	char			info[BIG_INFO_STRING];
+	int				numPairs;
+	infoCachePair_t	pairs[MAX_INFO_CACHE_PAIRS];	// in the order they are in the string
+} infoCache_t;
+
+qboolean InfoCache_Build( infoCache_t *cache, int numPairs, const char **keys, const char **values, const void **owners );
+// sets the pairs in the given order, keys must be unique.  Returns qfalse and
+// leaves the cache invalid if the Info_SetValueForKey calls would not have
+// taken every pair quietly, the caller has to make the string the old way then
+qboolean InfoCache_SetValue( infoCache_t *cache, const void *owner, const char *value );
+// patches the value of one pair, returns qfalse and invalidates the cache
+// when that can't be done in place
+
 /*
 ==============================================================
 
@@ -597,6 +695,7 @@ void FS_HomeRemove( const char *homePath );
 
 void FS_Rmdir( const char *osPath, qboolean recursive );
 void FS_HomeRmdir( const char *homePath, qboolean recursive );
+int64_t FS_HomeFolderSize( const char *homePath );
 
 qboolean FS_FileExists( const char *file );
 
@@ -609,6 +708,9 @@ int		FS_GetModList(  char *listbuf, int bufsize );
 fileHandle_t	FS_FOpenFileWrite( const char *qpath, qboolean safe=qtrue );
 // will properly create any needed paths and deal with seperater character issues
 
+FILE	*FS_FOpenFileWriteRaw( const char *qpath );
+// same without a handle, for files written by another thread
+
 int		FS_filelength( fileHandle_t f );
 fileHandle_t FS_SV_FOpenFileWrite( const char *filename );
 fileHandle_t FS_SV_FOpenFileAppend( const char *filename );
@@ -643,6 +745,7 @@ long		FS_ReadFile( const char *qpath, void **buffer );
 // for other uses.
 
 void	FS_ForceFlush( fileHandle_t f );
+void	FS_WriteInBackground( fileHandle_t f );
 // forces flush on files we're writing to.
 
 void	FS_FreeFile( void *buffer );
@@ -754,6 +857,19 @@ void 		QDECL Com_Printf( const char *fmt, ... );
 void 		QDECL Com_DPrintf( const char *fmt, ... );
 void		QDECL Com_OPrintf( const char *fmt, ...); // Outputs to the VC / Windows Debug window (only in debug compile)
 void		Com_SetRemoteLogAddr( char *newAddr );
+void		RemoteLog_Init( void );
+void		RemoteLog_Shutdown( void );
+void		RemoteLog_Frame( void );
+void		RemoteLog_Print( const char *msg );
+qboolean	RemoteLog_EventsEnabled( void );
+void		RemoteLog_Event( const char *json );
+void		RemoteLog_SetAddress( const char *newAddr );
+void		LogWriter_Init( void );
+void		LogWriter_Shutdown( void );
+void		LogWriter_Flush( void );
+qboolean	LogWriter_Write( fileHandle_t handle, FILE *file, qboolean sync, const void *data, int len );
+void		ChatFilter_Init( void );
+qboolean	ChatFilter_Hide( const char *msg, int len );
 void 		NORETURN QDECL Com_Error( int code, const char *fmt, ... );
 void 		NORETURN Com_Quit_f( void );
 int			Com_EventLoop( void );
@@ -810,6 +926,11 @@ extern	cvar_t	*sv_paused;
 extern	int		time_game;
 extern	int		time_frontend;
 extern	int		time_backend;		// renderer backend time
+extern	int		time_netRecv;		// usec spent in recvmmsg
+extern	int		c_netBatches;
+extern	int		c_netPackets;
+extern	int		c_netSendCalls;		// sendto and sendmmsg calls
+extern	int		c_netSendPackets;
 
 extern	int		com_frameTime;
 
@@ -1036,6 +1157,25 @@ typedef struct huffman_s {
 	huff_t		decompressor;
 } huffman_t;
 
+/* Code tables for a tree that doesn't change any more, like the netchan one.
+ * They send and receive exactly the same bits as Huff_offsetTransmit and
+ * Huff_offsetReceive without walking the tree a bit at a time */
+
+#define HUFF_LOOKUP_BITS	11
+#define HUFF_MAX_CODE_LEN	32
+
+typedef struct huffTables_s {
+	node_t		*tree;
+	uint32_t	code[HMAX];		/* first bit sent in bit 0 */
+	byte		length[HMAX];
+
+	/* by the next HUFF_LOOKUP_BITS bits, a length of 0 means the code is
+	 * longer and the tree has to be walked on from lookupNode */
+	short		lookupSymbol[1 << HUFF_LOOKUP_BITS];
+	byte		lookupLength[1 << HUFF_LOOKUP_BITS];
+	node_t		*lookupNode[1 << HUFF_LOOKUP_BITS];
+} huffTables_t;
+
 void	Huff_Compress(msg_t *buf, int offset);
 void	Huff_Decompress(msg_t *buf, int offset);
 void	Huff_Init(huffman_t *huff);
@@ -1046,6 +1186,9 @@ void	Huff_offsetReceive (node_t *node, int *ch, byte *fin, int *offset, int maxo
 void	Huff_offsetTransmit (huff_t *huff, int ch, byte *fout, int *offset, int maxoffset);
 void	Huff_putBit( int bit, byte *fout, int *offset);
 int		Huff_getBit( byte *fout, int *offset);
+qboolean	Huff_BuildTables( huffTables_t *tables, node_t *tree );
+void	Huff_tableTransmit( const huffTables_t *tables, int ch, byte *fout, int *offset, int maxoffset );
+void	Huff_tableReceive( const huffTables_t *tables, int *ch, byte *fin, int *offset, int maxoffset );
 
 extern huffman_t clientHuffTables;
 
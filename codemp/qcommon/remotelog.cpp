@@ -0,0 +1,822 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// remotelog.cpp -- ships console output to the logremote address
+//
+// Com_Printf only appends the line to a single producer / single consumer
+// ring buffer. A background thread drains the ring every logremote_flushMsec,
+// packs as many lines as fit into one logremote_mtu sized datagram and sends
+// it on a socket of its own, so printing never blocks the frame.
+//
+// Every packet, in both directions, starts with the same header (all
+// integers little endian):
+//   0  "MBLG"
+//   4  byte    version
+//   5  byte    type
+//   6  short   count
+//   8  int     sequence
+//   12 int     session, picked at random when the server starts
+//
+// server -> reader
+//   RL_DATA       count lines follow, each NUL terminated
+//   RL_EVENT      count events follow, each a NUL terminated line of JSON
+//                 (see sv_events.cpp), sequenced together with RL_DATA
+//   RL_KEEPALIVE  sent when idle, sequence is the next one to be used so
+//                 the reader notices a lost tail
+//   RL_WELCOME    answer to RL_HELLO, sequence is the next one to be used,
+//                 followed by an int with the oldest sequence still held
+//   RL_GAP        count datagrams starting at sequence were asked for but
+//                 have left the replay window and are lost for good
+//
+// reader -> server (only accepted from the logremote host)
+//   RL_HELLO      (re)start the stream; if session matches ours the stream
+//                 resumes at sequence, otherwise it replays everything still
+//                 held. A sequence of RL_LIVE skips the replay.
+//   RL_NACK       resend count datagrams starting at sequence
+//   RL_ACK        everything up to and including sequence was received
+//
+// The last logremote_replayWindow datagrams are kept for RL_NACK / RL_HELLO.
+// Send errors don't disable the stream; the shipper keeps filling the window
+// and retries with an increasing delay, replaying what was missed once the
+// reader is reachable again.
+//
+// logremote_protocol 0 keeps the old format of one NUL terminated line per
+// datagram for readers that have not been updated yet.
+
+#include "qcommon/qcommon.h"
+#include "qcommon/ringbuffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#define RL_MAGIC			"MBLG"
+#define RL_VERSION			2
+#define RL_HEADER_SIZE		16
+#define RL_MAX_DATAGRAM		(MAXPRINTMSG + RL_HEADER_SIZE)
+
+enum {
+	RL_DATA = 1,
+	RL_KEEPALIVE,
+	RL_WELCOME,
+	RL_GAP,
+	RL_EVENT,
+	RL_HELLO = 16,
+	RL_NACK,
+	RL_ACK
+};
+
+#define RL_LIVE				0xffffffffu
+#define RL_MAX_NACK			64			// datagrams resent for a single RL_NACK
+#define RL_REPLAY_BURST		64			// datagrams replayed per flush
+#define RL_KEEPALIVE_MSEC	1000
+#define RL_MIN_RETRY_MSEC	1000
+#define RL_MAX_RETRY_MSEC	30000
+
+// ring record tags
+#define RL_TAG_LINE			0
+#define RL_TAG_EVENT		1
+
+typedef struct remoteLogSlot_s {
+	int			cursize;
+	byte		data[RL_MAX_DATAGRAM];
+} remoteLogSlot_t;
+
+typedef struct remoteLogWindow_s {
+	remoteLogSlot_t	*slots;
+	uint32_t		numSlots;
+	uint32_t		nextSequence;	// sequence of the datagram being filled
+	uint32_t		session;
+} remoteLogWindow_t;
+
+typedef enum {
+	RL_STATE_ONLINE,
+	RL_STATE_RETRYING
+} remoteLogState_t;
+
+typedef struct remoteLogStats_s {
+	std::atomic<uint32_t>	linesQueued;
+	std::atomic<uint32_t>	linesDropped;
+	std::atomic<uint32_t>	bytesDropped;
+	std::atomic<uint32_t>	eventsQueued;
+	std::atomic<uint32_t>	eventsDropped;
+	std::atomic<uint32_t>	datagramsSent;
+	std::atomic<uint32_t>	bytesSent;
+	std::atomic<uint32_t>	sendErrors;
+	std::atomic<uint32_t>	retransmits;
+	std::atomic<uint32_t>	nacks;
+	std::atomic<uint32_t>	hellos;
+	std::atomic<uint32_t>	lost;			// datagrams asked for after they left the window
+	std::atomic<uint32_t>	ackedSequence;
+	std::atomic<uint32_t>	reconnects;
+} remoteLogStats_t;
+
+static cvar_t	*logremote_flushMsec;
+static cvar_t	*logremote_mtu;
+static cvar_t	*logremote_bufferSize;
+static cvar_t	*logremote_replayWindow;
+static cvar_t	*logremote_protocol;
+
+static byteRing_t			rl_ring;		// filled by Com_Printf, drained by the shipper
+static remoteLogWindow_t	rl_window;
+static remoteLogStats_t		rl_stats;
+
+static std::thread			*rl_thread;
+static std::mutex			rl_lock;			// guards rl_addr
+static std::atomic<bool>	rl_running( false );
+static std::atomic<bool>	rl_active( false );	// lines are only queued while an address is set
+static std::atomic<int>		rl_flushMsec( 50 );
+static std::atomic<int>		rl_mtu( 1400 );
+static std::atomic<int>		rl_protocol( 1 );
+static std::atomic<int>		rl_state( RL_STATE_ONLINE );
+static std::atomic<int>		rl_lastError( 0 );
+static netadr_t				rl_addr;
+
+static uint32_t				rl_reportedDrops;
+static int					rl_reportedState = RL_STATE_ONLINE;
+
+/*
+=============================================================================
+
+SHIPPER THREAD
+
+Nothing in here may call Com_Printf, Z_Malloc or touch cvars, anything worth
+reporting is left in rl_stats for RemoteLog_Frame to print.
+
+=============================================================================
+*/
+
+typedef struct remoteLogShipper_s {
+	netadr_t	to;
+	int			now;
+	int			lastSendTime;
+	int			retryTime;
+	int			retryDelay;
+	uint32_t	firstUnsent;		// first datagram held back while retrying
+	uint32_t	replayNext;			// pending replay after RL_HELLO or a reconnect
+	uint32_t	replayEnd;
+	int			numLines;
+	int			type;				// RL_DATA or RL_EVENT, a datagram never mixes the two
+} remoteLogShipper_t;
+
+static remoteLogShipper_t	rl_shipper;
+
+static int RemoteLog_Milliseconds( void ) {
+	using namespace std::chrono;
+	static const steady_clock::time_point base = steady_clock::now();
+	return (int)duration_cast<milliseconds>( steady_clock::now() - base ).count();
+}
+
+static void RemoteLog_WriteHeader( byte *data, int type, int count, uint32_t sequence ) {
+	const uint16_t c = LittleShort( (uint16_t)count );
+	const uint32_t seq = LittleLong( sequence );
+	const uint32_t session = LittleLong( rl_window.session );
+
+	memcpy( data, RL_MAGIC, 4 );
+	data[4] = RL_VERSION;
+	data[5] = type;
+	memcpy( data + 6, &c, 2 );
+	memcpy( data + 8, &seq, 4 );
+	memcpy( data + 12, &session, 4 );
+}
+
+static remoteLogSlot_t *RemoteLog_Slot( uint32_t sequence ) {
+	return &rl_window.slots[sequence % rl_window.numSlots];
+}
+
+// the slot of nextSequence is the datagram being filled, so only the
+// numSlots - 1 before it can be sent again
+static uint32_t RemoteLog_OldestSequence( void ) {
+	if ( rl_window.nextSequence < rl_window.numSlots ) {
+		return 0;
+	}
+	return rl_window.nextSequence - rl_window.numSlots + 1;
+}
+
+/*
+==================
+RemoteLog_Send
+
+Returns qfalse and switches to retrying if the reader can't be reached.
+While retrying nothing goes out, datagrams only collect in the window.
+==================
+*/
+static qboolean RemoteLog_Send( const void *data, int length ) {
+	remoteLogShipper_t *sh = &rl_shipper;
+	int err;
+
+	if ( rl_state == RL_STATE_RETRYING ) {
+		return qfalse;
+	}
+
+	if ( Sys_RemoteLogSend( data, length, &sh->to, &err ) < 0 ) {
+		rl_stats.sendErrors++;
+		rl_lastError = err;
+		rl_state = RL_STATE_RETRYING;
+		// a replay cut short by the error has to pick up where it stopped
+		sh->firstUnsent = rl_window.nextSequence;
+		if ( sh->replayNext < sh->replayEnd ) {
+			sh->firstUnsent = Q_min( sh->replayNext, rl_window.nextSequence );
+		}
+		sh->retryTime = sh->now + sh->retryDelay;
+		sh->retryDelay = Q_min( sh->retryDelay * 2, RL_MAX_RETRY_MSEC );
+		return qfalse;
+	}
+
+	sh->lastSendTime = sh->now;
+	sh->retryDelay = RL_MIN_RETRY_MSEC;
+	rl_stats.datagramsSent++;
+	rl_stats.bytesSent += length;
+	return qtrue;
+}
+
+static qboolean RemoteLog_SendControl( int type, int count, uint32_t sequence, uint32_t extra ) {
+	byte data[RL_HEADER_SIZE + 4];
+	int length = RL_HEADER_SIZE;
+
+	RemoteLog_WriteHeader( data, type, count, sequence );
+	if ( type == RL_WELCOME ) {
+		extra = LittleLong( extra );
+		memcpy( data + RL_HEADER_SIZE, &extra, 4 );
+		length += 4;
+	}
+	return RemoteLog_Send( data, length );
+}
+
+/*
+==================
+RemoteLog_SendGap
+
+Tells the reader that everything from sequence up to the start of the
+window is gone. Returns the number of datagrams lost.
+==================
+*/
+static uint32_t RemoteLog_SendGap( uint32_t sequence ) {
+	const uint32_t count = RemoteLog_OldestSequence() - sequence;
+
+	RemoteLog_SendControl( RL_GAP, Q_min( count, 0xffffu ), sequence, 0 );
+	return count;
+}
+
+/*
+==================
+RemoteLog_Resend
+
+Sends a datagram from the window again.
+==================
+*/
+static qboolean RemoteLog_Resend( uint32_t sequence ) {
+	remoteLogSlot_t *slot;
+
+	if ( sequence >= rl_window.nextSequence || sequence < RemoteLog_OldestSequence() ) {
+		return qfalse;
+	}
+
+	slot = RemoteLog_Slot( sequence );
+	if ( !RemoteLog_Send( slot->data, slot->cursize ) ) {
+		return qfalse;
+	}
+	rl_stats.retransmits++;
+	return qtrue;
+}
+
+static void RemoteLog_StartReplay( uint32_t from ) {
+	remoteLogShipper_t *sh = &rl_shipper;
+
+	if ( from < RemoteLog_OldestSequence() ) {
+		RemoteLog_SendGap( from );
+		from = RemoteLog_OldestSequence();
+	}
+	sh->replayNext = from;
+	sh->replayEnd = rl_window.nextSequence;
+}
+
+static void RemoteLog_ContinueReplay( void ) {
+	remoteLogShipper_t *sh = &rl_shipper;
+
+	for ( int i = 0; i < RL_REPLAY_BURST && sh->replayNext < sh->replayEnd; i++ ) {
+		// the window may have moved on since the replay started
+		if ( sh->replayNext < RemoteLog_OldestSequence() ) {
+			sh->replayNext = RemoteLog_OldestSequence();
+			continue;
+		}
+		if ( !RemoteLog_Resend( sh->replayNext ) ) {
+			return;
+		}
+		sh->replayNext++;
+	}
+}
+
+/*
+==================
+RemoteLog_FlushDatagram
+
+Seals the datagram being filled into the window and sends it.
+==================
+*/
+static void RemoteLog_FlushDatagram( void ) {
+	remoteLogShipper_t *sh = &rl_shipper;
+	remoteLogSlot_t *slot = RemoteLog_Slot( rl_window.nextSequence );
+
+	if ( !sh->numLines ) {
+		return;
+	}
+
+	RemoteLog_WriteHeader( slot->data, sh->type, sh->numLines, rl_window.nextSequence );
+	RemoteLog_Send( slot->data, slot->cursize );
+
+	rl_window.nextSequence++;
+	sh->numLines = 0;
+	RemoteLog_Slot( rl_window.nextSequence )->cursize = RL_HEADER_SIZE;
+}
+
+/*
+==================
+RemoteLog_Drain
+
+Empties the ring, batching lines into datagrams of at most logremote_mtu
+bytes. A single line larger than that goes out in a datagram of its own.
+==================
+*/
+static void RemoteLog_Drain( void ) {
+	remoteLogShipper_t *sh = &rl_shipper;
+	const int mtu = rl_mtu;
+	const int protocol = rl_protocol;
+	const byte *line;
+	uint32_t len;
+	int tag;
+
+	while ( (line = Ring_Peek( &rl_ring, &len, &tag )) != NULL ) {
+		const int type = tag == RL_TAG_EVENT ? RL_EVENT : RL_DATA;
+		remoteLogSlot_t *slot;
+
+		if ( protocol == 0 ) {
+			// old readers only know about lines
+			if ( tag == RL_TAG_LINE ) {
+				RemoteLog_Send( line, len );
+			}
+			Ring_Consume( &rl_ring, len );
+			continue;
+		}
+
+		if ( sh->numLines && (sh->type != type || RemoteLog_Slot( rl_window.nextSequence )->cursize + (int)len > mtu) ) {
+			RemoteLog_FlushDatagram();
+		}
+		sh->type = type;
+
+		slot = RemoteLog_Slot( rl_window.nextSequence );
+		memcpy( slot->data + slot->cursize, line, len );
+		slot->cursize += len;
+		sh->numLines++;
+		Ring_Consume( &rl_ring, len );
+	}
+
+	RemoteLog_FlushDatagram();
+}
+
+/*
+==================
+RemoteLog_HandleControl
+
+Handles a packet from the reader.
+==================
+*/
+static void RemoteLog_HandleControl( const byte *data, int length, const netadr_t *from ) {
+	remoteLogShipper_t *sh = &rl_shipper;
+	uint16_t count;
+	uint32_t sequence, session;
+
+	if ( length < RL_HEADER_SIZE || memcmp( data, RL_MAGIC, 4 ) || data[4] != RL_VERSION ) {
+		return;
+	}
+
+	// only the reader we are sending to gets a say
+	if ( !NET_CompareBaseAdr( *from, sh->to ) ) {
+		return;
+	}
+
+	memcpy( &count, data + 6, 2 );
+	memcpy( &sequence, data + 8, 4 );
+	memcpy( &session, data + 12, 4 );
+	count = LittleShort( count );
+	sequence = LittleLong( sequence );
+	session = LittleLong( session );
+
+	// hearing from the reader at all means it is reachable again
+	if ( rl_state == RL_STATE_RETRYING ) {
+		sh->retryTime = sh->now;
+	}
+
+	switch ( data[5] ) {
+	case RL_HELLO:
+		rl_stats.hellos++;
+		RemoteLog_SendControl( RL_WELCOME, 0, rl_window.nextSequence, RemoteLog_OldestSequence() );
+		if ( sequence == RL_LIVE ) {
+			sh->replayNext = sh->replayEnd = 0;
+		} else {
+			// a reader from another session gets what the window still
+			// holds, without a gap for sequences it never could have had
+			RemoteLog_StartReplay( session == rl_window.session ? sequence : RemoteLog_OldestSequence() );
+		}
+		break;
+
+	case RL_NACK: {
+		const uint32_t end = sequence + Q_min( count, RL_MAX_NACK );
+
+		if ( session != rl_window.session ) {
+			break;
+		}
+		rl_stats.nacks++;
+		if ( sequence < RemoteLog_OldestSequence() ) {
+			rl_stats.lost += RemoteLog_SendGap( sequence );
+			sequence = RemoteLog_OldestSequence();
+		}
+		for ( ; sequence < end; sequence++ ) {
+			if ( !RemoteLog_Resend( sequence ) ) {
+				break;
+			}
+		}
+		break;
+	}
+
+	case RL_ACK:
+		if ( session == rl_window.session ) {
+			rl_stats.ackedSequence = sequence;
+		}
+		break;
+	}
+}
+
+/*
+==================
+RemoteLog_CheckRetry
+==================
+*/
+static void RemoteLog_CheckRetry( void ) {
+	remoteLogShipper_t *sh = &rl_shipper;
+	const uint32_t firstUnsent = sh->firstUnsent;
+
+	if ( rl_state != RL_STATE_RETRYING || sh->now - sh->retryTime < 0 ) {
+		return;
+	}
+
+	rl_state = RL_STATE_ONLINE;
+	if ( !RemoteLog_SendControl( RL_KEEPALIVE, 0, rl_window.nextSequence, 0 ) ) {
+		sh->firstUnsent = Q_min( firstUnsent, sh->firstUnsent );
+		return;
+	}
+
+	rl_stats.reconnects++;
+	if ( rl_protocol != 0 ) {
+		// don't cut short a replay still going on, a reader's RL_HELLO may
+		// have started one while retrying
+		if ( sh->replayNext < sh->replayEnd ) {
+			RemoteLog_StartReplay( Q_min( firstUnsent, sh->replayNext ) );
+		} else {
+			RemoteLog_StartReplay( firstUnsent );
+		}
+	}
+}
+
+static void RemoteLog_ThreadMain( void ) {
+	remoteLogShipper_t *sh = &rl_shipper;
+	byte buf[RL_HEADER_SIZE + 64];
+	netadr_t from;
+	int nextFlush;
+
+	sh->now = RemoteLog_Milliseconds();
+	sh->lastSendTime = sh->now;
+	sh->retryDelay = RL_MIN_RETRY_MSEC;
+	RemoteLog_Slot( rl_window.nextSequence )->cursize = RL_HEADER_SIZE;
+	nextFlush = sh->now + rl_flushMsec;
+
+	while ( rl_running ) {
+		const int length = Sys_RemoteLogReceive( buf, sizeof( buf ), &from, Q_max( nextFlush - sh->now, 0 ) );
+
+		{
+			std::lock_guard<std::mutex> lock( rl_lock );
+			sh->to = rl_addr;
+		}
+		sh->now = RemoteLog_Milliseconds();
+
+		if ( length > 0 ) {
+			RemoteLog_HandleControl( buf, length, &from );
+		}
+
+		if ( sh->now - nextFlush < 0 ) {
+			continue;
+		}
+		nextFlush = sh->now + rl_flushMsec;
+
+		RemoteLog_CheckRetry();
+		RemoteLog_Drain();
+		RemoteLog_ContinueReplay();
+
+		if ( rl_protocol != 0 && sh->now - sh->lastSendTime >= RL_KEEPALIVE_MSEC ) {
+			RemoteLog_SendControl( RL_KEEPALIVE, 0, rl_window.nextSequence, 0 );
+		}
+	}
+
+	// whatever was printed before shutdown still goes out
+	RemoteLog_Drain();
+}
+
+/*
+=============================================================================
+
+MAIN THREAD INTERFACE
+
+=============================================================================
+*/
+
+/*
+==================
+RemoteLog_Print
+
+Called by Com_Printf for every line. Never blocks.
+==================
+*/
+void RemoteLog_Print( const char *msg ) {
+	uint32_t len;
+
+	if ( !rl_active.load( std::memory_order_relaxed ) ) {
+		return;
+	}
+
+	len = strlen( msg ) + 1;
+	if ( len > MAXPRINTMSG ) {
+		len = MAXPRINTMSG;
+	}
+
+	if ( !Ring_Write( &rl_ring, msg, len, RL_TAG_LINE ) ) {
+		rl_stats.linesDropped++;
+		rl_stats.bytesDropped += len;
+		return;
+	}
+
+	rl_stats.linesQueued++;
+}
+
+/*
+==================
+RemoteLog_EventsEnabled
+
+Lets callers skip building events nobody is going to receive.
+==================
+*/
+qboolean RemoteLog_EventsEnabled( void ) {
+	return (rl_active.load( std::memory_order_relaxed ) && rl_protocol != 0) ? qtrue : qfalse;
+}
+
+/*
+==================
+RemoteLog_Event
+
+Queues an already serialised event. Events share the ring and the sequence
+numbers with the console lines, so the reader sees both in order.
+==================
+*/
+void RemoteLog_Event( const char *json ) {
+	uint32_t len;
+
+	if ( !RemoteLog_EventsEnabled() ) {
+		return;
+	}
+
+	len = strlen( json ) + 1;
+	if ( len > MAXPRINTMSG ) {
+		return;
+	}
+
+	if ( !Ring_Write( &rl_ring, json, len, RL_TAG_EVENT ) ) {
+		rl_stats.eventsDropped++;
+		rl_stats.bytesDropped += len;
+		return;
+	}
+
+	rl_stats.eventsQueued++;
+}
+
+/*
+==================
+RemoteLog_StartThread
+==================
+*/
+static void RemoteLog_StartThread( void ) {
+	if ( rl_thread ) {
+		return;
+	}
+
+	rl_running = true;
+	rl_thread = new std::thread( RemoteLog_ThreadMain );
+}
+
+/*
+==================
+RemoteLog_StopThread
+
+Flushes whatever is still queued and waits for the shipper to exit.
+==================
+*/
+static void RemoteLog_StopThread( void ) {
+	if ( !rl_thread ) {
+		return;
+	}
+
+	// the shipper notices within logremote_flushMsec
+	rl_running = false;
+	rl_thread->join();
+	delete rl_thread;
+	rl_thread = NULL;
+}
+
+/*
+==================
+RemoteLog_SetAddress
+==================
+*/
+void RemoteLog_SetAddress( const char *newAddr ) {
+	netadr_t adr;
+
+	if ( !rl_ring.data ) {
+		return;
+	}
+
+	if ( !newAddr[0] || !strcmp( newAddr, "0" ) ) {
+		return;
+	}
+
+	if ( !NET_StringToAdr( newAddr, &adr ) || adr.type != NA_IP ) {
+		rl_active = false;
+		Com_Printf( S_COLOR_YELLOW "logremote: couldn't resolve %s\n", newAddr );
+		return;
+	}
+
+	if ( !Sys_RemoteLogOpen() ) {
+		rl_active = false;
+		Com_Printf( S_COLOR_YELLOW "logremote: couldn't open a socket\n" );
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( rl_lock );
+		rl_addr = adr;
+	}
+
+	RemoteLog_StartThread();
+	rl_active = true;
+}
+
+/*
+==================
+RemoteLog_Frame
+
+Picks up cvar changes for the shipper and reports anything it ran into.
+==================
+*/
+void RemoteLog_Frame( void ) {
+	uint32_t drops;
+	int state;
+
+	if ( !rl_ring.data ) {
+		return;
+	}
+
+	if ( logremote_flushMsec->modified ) {
+		Cvar_CheckRange( logremote_flushMsec, 1, 1000, qtrue );
+		rl_flushMsec = logremote_flushMsec->integer;
+		logremote_flushMsec->modified = qfalse;
+	}
+
+	if ( logremote_mtu->modified ) {
+		Cvar_CheckRange( logremote_mtu, 576, MAXPRINTMSG, qtrue );
+		rl_mtu = logremote_mtu->integer;
+		logremote_mtu->modified = qfalse;
+	}
+
+	if ( logremote_protocol->modified ) {
+		Cvar_CheckRange( logremote_protocol, 0, 1, qtrue );
+		rl_protocol = logremote_protocol->integer;
+		logremote_protocol->modified = qfalse;
+	}
+
+	if ( !rl_active ) {
+		return;
+	}
+
+	drops = rl_stats.linesDropped + rl_stats.eventsDropped;
+	if ( drops != rl_reportedDrops ) {
+		Com_Printf( S_COLOR_YELLOW "logremote: %u lines or events dropped, log buffer full\n", drops - rl_reportedDrops );
+		rl_reportedDrops = drops;
+	}
+
+	state = rl_state;
+	if ( state != rl_reportedState ) {
+		rl_reportedState = state;
+		if ( state == RL_STATE_RETRYING ) {
+			Com_Printf( S_COLOR_YELLOW "logremote: unable to send (error %i), holding lines back and retrying\n", rl_lastError.load() );
+		} else {
+			Com_Printf( "logremote: sending again\n" );
+		}
+	}
+}
+
+/*
+==================
+RemoteLog_Status_f
+==================
+*/
+static void RemoteLog_Status_f( void ) {
+	const uint32_t used = Ring_Used( &rl_ring );
+	netadr_t to;
+
+	{
+		std::lock_guard<std::mutex> lock( rl_lock );
+		to = rl_addr;
+	}
+
+	Com_Printf( "address:        %s (%s)\n", rl_active ? NET_AdrToString( to ) : "none",
+		!rl_active ? "inactive" : rl_state == RL_STATE_RETRYING ? "retrying" : "active" );
+	Com_Printf( "session:        %08x\n", rl_window.session );
+	Com_Printf( "buffer:         %u / %u bytes\n", used, rl_ring.size );
+	Com_Printf( "lines queued:   %u\n", rl_stats.linesQueued.load() );
+	Com_Printf( "lines dropped:  %u (%u bytes)\n", rl_stats.linesDropped.load(), rl_stats.bytesDropped.load() );
+	Com_Printf( "events:         %u queued, %u dropped\n", rl_stats.eventsQueued.load(), rl_stats.eventsDropped.load() );
+	Com_Printf( "datagrams sent: %u (%u bytes)\n", rl_stats.datagramsSent.load(), rl_stats.bytesSent.load() );
+	Com_Printf( "retransmits:    %u (%u nacks, %u hellos, %u lost)\n", rl_stats.retransmits.load(),
+		rl_stats.nacks.load(), rl_stats.hellos.load(), rl_stats.lost.load() );
+	Com_Printf( "reader acked:   %u\n", rl_stats.ackedSequence.load() );
+	Com_Printf( "send errors:    %u (%u reconnects)\n", rl_stats.sendErrors.load(), rl_stats.reconnects.load() );
+}
+
+/*
+==================
+RemoteLog_Init
+==================
+*/
+void RemoteLog_Init( void ) {
+	uint32_t size;
+
+	logremote_flushMsec = Cvar_Get( "logremote_flushMsec", "50", CVAR_ARCHIVE_ND, "Max time in msec a remote log line is held back for batching" );
+	logremote_mtu = Cvar_Get( "logremote_mtu", "1400", CVAR_ARCHIVE_ND, "Max size of a remote log datagram" );
+	logremote_bufferSize = Cvar_Get( "logremote_bufferSize", "256", CVAR_ARCHIVE_ND | CVAR_LATCH, "Size in KB of the remote log queue" );
+	logremote_replayWindow = Cvar_Get( "logremote_replayWindow", "256", CVAR_ARCHIVE_ND | CVAR_LATCH, "Number of sent remote log datagrams kept for retransmission" );
+	logremote_protocol = Cvar_Get( "logremote_protocol", "1", CVAR_ARCHIVE_ND, "0 - one line per datagram, 1 - batched, sequenced and resumable" );
+	Cvar_CheckRange( logremote_bufferSize, 16, 16384, qtrue );
+	Cvar_CheckRange( logremote_replayWindow, 16, 4096, qtrue );
+
+	// round down to a power of two so ring offsets are a mask
+	for ( size = 1; size * 2 <= (uint32_t)logremote_bufferSize->integer * 1024; size *= 2 )
+		;
+
+	Ring_Init( &rl_ring, (byte *)Z_Malloc( size, TAG_GENERAL, qfalse ), size );
+
+	rl_window.numSlots = logremote_replayWindow->integer + 1;	// and the one being filled
+	rl_window.slots = (remoteLogSlot_t *)Z_Malloc( rl_window.numSlots * sizeof( remoteLogSlot_t ), TAG_GENERAL, qfalse );
+	rl_window.nextSequence = 0;
+	Com_RandomBytes( (byte *)&rl_window.session, sizeof( rl_window.session ) );
+
+	logremote_flushMsec->modified = qtrue;
+	logremote_mtu->modified = qtrue;
+	logremote_protocol->modified = qtrue;
+	RemoteLog_Frame();
+
+	Cmd_AddCommand( "logremote_status", RemoteLog_Status_f, "Show remote log shipping statistics" );
+}
+
+/*
+==================
+RemoteLog_Shutdown
+==================
+*/
+void RemoteLog_Shutdown( void ) {
+	rl_active = false;
+	RemoteLog_StopThread();
+	Sys_RemoteLogClose();
+
+	if ( rl_ring.data ) {
+		Cmd_RemoveCommand( "logremote_status" );
+		Z_Free( rl_ring.data );
+		rl_ring.data = NULL;
+		Z_Free( rl_window.slots );
+		rl_window.slots = NULL;
+	}
+}
@@ -0,0 +1,171 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#pragma once
+
+// ringbuffer.h -- lock free queue of byte records between one producer
+// thread and one consumer thread
+//
+// Every record starts with an int holding its length and a 7 bit tag the
+// owner can use to tell records apart. Records never wrap around the end of
+// the buffer, the remainder is skipped with a marker instead, so the consumer
+// always gets a contiguous pointer. head and tail only ever grow, the buffer
+// size must be a power of two.
+
+#include "qcommon/q_shared.h"
+
+#include <atomic>
+
+#define RING_WRAP_MARKER		0xffffffffu
+#define RING_MAX_RECORD			0x00ffffffu
+#define RING_TAG_SHIFT			24
+#define RING_RECORD_SIZE(len)	((4 + (len) + 3) & ~3u)
+
+typedef struct byteRing_s {
+	byte					*data;
+	uint32_t				size;		// power of two
+	std::atomic<uint32_t>	head;		// only written by the producer
+	std::atomic<uint32_t>	tail;		// only written by the consumer
+} byteRing_t;
+
+static inline void Ring_Init( byteRing_t *ring, byte *data, uint32_t size ) {
+	ring->data = data;
+	ring->size = size;
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+static inline uint32_t Ring_Used( const byteRing_t *ring ) {
+	return ring->head.load( std::memory_order_relaxed ) - ring->tail.load( std::memory_order_relaxed );
+}
+
+/*
+==================
+Ring_Reserve
+
+Producer side. Returns room for a record of len bytes, or NULL if it did not
+fit, it is up to the caller whether to drop it or wait. Nothing is visible to
+the consumer before Ring_Commit.
+==================
+*/
+static inline byte *Ring_Reserve( byteRing_t *ring, uint32_t len ) {
+	const uint32_t need = RING_RECORD_SIZE( len );
+	const uint32_t head = ring->head.load( std::memory_order_relaxed );
+	const uint32_t tail = ring->tail.load( std::memory_order_acquire );
+	const uint32_t avail = ring->size - (head - tail);
+	const uint32_t offset = head & (ring->size - 1);
+	const uint32_t toEnd = ring->size - offset;
+
+	assert( len <= RING_MAX_RECORD );
+
+	if ( toEnd < need ) {
+		if ( toEnd + need > avail ) {
+			return NULL;
+		}
+		return ring->data + 4;
+	}
+
+	if ( need > avail ) {
+		return NULL;
+	}
+	return ring->data + offset + 4;
+}
+
+/*
+==================
+Ring_Commit
+
+Publishes the record filled in after Ring_Reserve, len has to be the same
+that was reserved.
+==================
+*/
+static inline void Ring_Commit( byteRing_t *ring, uint32_t len, int tag ) {
+	const uint32_t head = ring->head.load( std::memory_order_relaxed );
+	uint32_t offset = head & (ring->size - 1);
+	const uint32_t toEnd = ring->size - offset;
+	uint32_t pad = 0;
+
+	assert( len <= RING_MAX_RECORD && tag >= 0 && tag < 128 );
+
+	if ( toEnd < RING_RECORD_SIZE( len ) ) {
+		*(uint32_t *)(ring->data + offset) = RING_WRAP_MARKER;
+		pad = toEnd;
+		offset = 0;
+	}
+
+	*(uint32_t *)(ring->data + offset) = len | ((uint32_t)tag << RING_TAG_SHIFT);
+
+	ring->head.store( head + pad + RING_RECORD_SIZE( len ), std::memory_order_release );
+}
+
+/*
+==================
+Ring_Write
+
+Producer side. Returns qfalse if the record did not fit, it is up to the
+caller whether to drop it or wait.
+==================
+*/
+static inline qboolean Ring_Write( byteRing_t *ring, const void *data, uint32_t len, int tag ) {
+	byte *dest = Ring_Reserve( ring, len );
+
+	if ( !dest ) {
+		return qfalse;
+	}
+
+	memcpy( dest, data, len );
+	Ring_Commit( ring, len, tag );
+	return qtrue;
+}
+
+/*
+==================
+Ring_Peek
+
+Consumer side. Returns the next record or NULL if the ring is empty, the
+record stays in the ring until Ring_Consume.
+==================
+*/
+static inline const byte *Ring_Peek( byteRing_t *ring, uint32_t *len, int *tag ) {
+	uint32_t tail = ring->tail.load( std::memory_order_relaxed );
+	const uint32_t head = ring->head.load( std::memory_order_acquire );
+
+	while ( tail != head ) {
+		const uint32_t offset = tail & (ring->size - 1);
+		const uint32_t header = *(uint32_t *)(ring->data + offset);
+
+		if ( header == RING_WRAP_MARKER ) {
+			tail += ring->size - offset;
+			ring->tail.store( tail, std::memory_order_release );
+			continue;
+		}
+
+		*len = header & RING_MAX_RECORD;
+		*tag = header >> RING_TAG_SHIFT;
+		return ring->data + offset + 4;
+	}
+
+	return NULL;
+}
+
+static inline void Ring_Consume( byteRing_t *ring, uint32_t len ) {
+	const uint32_t tail = ring->tail.load( std::memory_order_relaxed );
+	ring->tail.store( tail + RING_RECORD_SIZE( len ), std::memory_order_release );
+}
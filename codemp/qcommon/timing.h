@@ -22,8 +22,16 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
-#ifdef _WIN32
+// Start/End measure in CPU cycles where there is a time stamp counter and in
+// nanoseconds everywhere else, use Sys_Nanoseconds for real time.
+#if defined(_WIN32)
 #include <intrin.h>
+#define TIMING_RDTSC
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define TIMING_RDTSC
+#else
+#include <time.h>
 #endif
 
 class timing_c
@@ -32,6 +40,18 @@ private:
 	uint64_t	start;
 	uint64_t	end;
 
+	static uint64_t Ticks()
+	{
+#ifdef TIMING_RDTSC
+		return __rdtsc();
+#else
+		struct timespec ts;
+
+		clock_gettime( CLOCK_MONOTONIC, &ts );
+		return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+	}
+
 public:
 	timing_c(void)
 	{
@@ -39,22 +59,14 @@ public:
 
 	void Start()
 	{
-#ifdef _WIN32
-		start = __rdtsc();
-#else
-		start = 0;
-#endif
+		start = Ticks();
 	}
 
 	int End()
 	{
 		int64_t	time;
 
-#ifdef _WIN32
-		end = __rdtsc();
-#else
-		end = 0;
-#endif
+		end = Ticks();
 
 		time = end - start;
 		if (time < 0)
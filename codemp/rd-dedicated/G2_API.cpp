@@ -2081,6 +2081,42 @@ void G2API_CollisionDetectCache(CollisionRecord_t *collRecMap, CGhoul2Info_v &gh
 }
 
 
+void G2_TransformModelCached(CGhoul2Info_v &ghoul2, const int frameNum, int entNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod);
+
+void G2API_CollisionDetectTraceCache(CollisionRecord_t *collRecMap, CGhoul2Info_v &ghoul2, const vec3_t angles, const vec3_t position,
+										  int frameNumber, int entNum, vec3_t rayStart, vec3_t rayEnd, vec3_t scale, IHeapAllocator *G2VertSpace, int traceFlags, int useLod, float fRadius)
+{ //keeps the transformed verts of entNum around for the next trace against it in the same frame, see G2_TransformModelCached.
+	//only used by the server's own traces while sv_g2TraceCache is on
+	if (G2_SetupModelPointers(ghoul2))
+	{
+		vec3_t	transRayStart, transRayEnd;
+
+		G2_TransformModelCached(ghoul2, frameNumber, entNum, scale, G2VertSpace, useLod);
+
+		// pre generate the world matrix - used to transform the incoming ray
+		G2_GenerateWorldMatrix(angles, position);
+
+		// model is built. Lets check to see if any triangles are actually hit.
+		// first up, translate the ray to model space
+		TransformAndTranslatePoint(rayStart, transRayStart, &worldMatrixInv);
+		TransformAndTranslatePoint(rayEnd, transRayEnd, &worldMatrixInv);
+
+		// now walk each model and check the ray against each poly - sigh, this is SO expensive. I wish there was a better way to do this.
+#ifdef _G2_GORE
+		G2_TraceModels(ghoul2, transRayStart, transRayEnd, collRecMap, entNum, traceFlags, useLod, fRadius,0,0,0,0,0,qfalse);
+#else
+		G2_TraceModels(ghoul2, transRayStart, transRayEnd, collRecMap, entNum, traceFlags, useLod, fRadius);
+#endif
+		int i;
+		for ( i = 0; i < MAX_G2_COLLISIONS && collRecMap[i].mEntityNum != -1; i ++ );
+
+		// now sort the resulting array of collision records so they are distance ordered
+		qsort( collRecMap, i,
+			sizeof( CollisionRecord_t ), QsortDistance );
+	}
+}
+
+
 void G2API_CollisionDetect(CollisionRecord_t *collRecMap, CGhoul2Info_v &ghoul2, const vec3_t angles, const vec3_t position,
 										  int frameNumber, int entNum, vec3_t rayStart, vec3_t rayEnd, vec3_t scale, IHeapAllocator *G2VertSpace, int traceFlags, int useLod, float fRadius)
 {
@@ -21,6 +21,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "qcommon/matcomp.h"
+#include "qcommon/q_skinning.h"
 #include "ghoul2/G2.h"
 #include "qcommon/MiniHeap.h"
 #include "server/server.h"
@@ -175,6 +176,7 @@ CGoreSet::~CGoreSet()
 #endif // _SOF2
 
 const mdxaBone_t &EvalBoneCache(int index,CBoneCache *boneCache);
+extern const skinKernels_t *g2Kernels; //tr_ghoul2.cpp
 class CTraceSurface
 {
 public:
@@ -385,11 +387,102 @@ int G2_DecideTraceLod(CGhoul2Info &ghoul2, int useLod)
 	return returnLod;
 }
 
+// The skinned verts of a surface are followed by the bounds of the surface
+// and then by the bounds of every G2_TRACE_CHUNK triangles in index order,
+// so traces can skip what the ray doesn't come near without looking at the
+// triangles. Models are exported with neighbouring triangles next to each
+// other, which keeps the chunks tight.
+#define G2_TRACE_CHUNK				32
+#define G2_TRACE_BOUNDS_EPSILON		0.125f	// hit points are rounded, don't cull anything on the edge
+
+static inline int G2_TraceBoundsCount(const mdxmSurface_t *surface)
+{
+	return 1 + (surface->numTriangles + G2_TRACE_CHUNK - 1) / G2_TRACE_CHUNK;
+}
+
+static inline int G2_TransformedSurfaceSize(const mdxmSurface_t *surface)
+{
+	return surface->numVerts * 5 * 4 + G2_TraceBoundsCount(surface) * 6 * sizeof(float);
+}
+
+static void G2_BuildTraceBounds(const mdxmSurface_t *surface, float *TransformedVerts)
+{
+	const mdxmTriangle_t *tris = (mdxmTriangle_t *) ((byte *)surface + surface->ofsTriangles);
+	const int numTris = surface->numTriangles;
+	float *bounds = &TransformedVerts[surface->numVerts * 5];
+	float *chunk = bounds + 6;
+	int j, k;
+
+	ClearBounds(bounds, bounds + 3);
+	for (j = 0; j < numTris; j += G2_TRACE_CHUNK, chunk += 6)
+	{
+		const int end = Q_min(j + G2_TRACE_CHUNK, numTris);
+
+		ClearBounds(chunk, chunk + 3);
+		for (k = j; k < end; k++)
+		{
+			AddPointToBounds(&TransformedVerts[tris[k].indexes[0] * 5], chunk, chunk + 3);
+			AddPointToBounds(&TransformedVerts[tris[k].indexes[1] * 5], chunk, chunk + 3);
+			AddPointToBounds(&TransformedVerts[tris[k].indexes[2] * 5], chunk, chunk + 3);
+		}
+		for (k = 0; k < 3; k++)
+		{
+			chunk[k] -= G2_TRACE_BOUNDS_EPSILON;
+			chunk[k + 3] += G2_TRACE_BOUNDS_EPSILON;
+		}
+
+		AddPointToBounds(chunk, bounds, bounds + 3);
+		AddPointToBounds(chunk + 3, bounds, bounds + 3);
+	}
+}
+
+// does the segment from start to start + dir touch the bounds
+static bool G2_SegmentHitsBounds(const vec3_t start, const vec3_t dir, const float *bounds)
+{
+	float tMin = 0.0f, tMax = 1.0f;
+	int i;
+
+	for (i = 0; i < 3; i++)
+	{
+		if (fabs(dir[i]) < 1E-6f)
+		{
+			if (start[i] < bounds[i] || start[i] > bounds[i + 3])
+			{
+				return false;
+			}
+			continue;
+		}
+
+		float t0 = (bounds[i] - start[i]) / dir[i];
+		float t1 = (bounds[i + 3] - start[i]) / dir[i];
+
+		if (t0 > t1)
+		{
+			const float temp = t0;
+			t0 = t1;
+			t1 = temp;
+		}
+		tMin = Q_max(tMin, t0);
+		tMax = Q_min(tMax, t1);
+		if (tMin > tMax)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// verts decoded and skinned at a time
+#define G2_SKIN_BATCH	64
+
 void R_TransformEachSurface( const mdxmSurface_t *surface, vec3_t scale, IHeapAllocator *G2VertSpace, size_t *TransformedVertsArray,CBoneCache *boneCache)
 {
-	int				 j, k;
+	int				 j, k, batch;
 	mdxmVertex_t 	*v;
 	float			*TransformedVerts;
+	skinVertex_t	 skinVerts[G2_SKIN_BATCH];
+	const float		*bones[iMAX_G2_BONEREFS_PER_SURFACE];
 
 	//
 	// deform the vertexes by the lerped bones
@@ -397,103 +490,59 @@ void R_TransformEachSurface( const mdxmSurface_t *surface, vec3_t scale, IHeapAl
 	int *piBoneReferences = (int*) ((byte*)surface + surface->ofsBoneReferences);
 
 	// alloc some space for the transformed verts to get put in
-	TransformedVerts = (float *)G2VertSpace->MiniHeapAlloc(surface->numVerts * 5 * 4);
+	TransformedVerts = (float *)G2VertSpace->MiniHeapAlloc(G2_TransformedSurfaceSize(surface));
 	TransformedVertsArray[surface->thisSurfaceIndex] = (size_t)TransformedVerts;
 	if (!TransformedVerts)
 	{
 		Com_Error(ERR_DROP, "Ran out of transform space for Ghoul2 Models. Adjust MiniHeapSize in SV_SpawnServer.\n");
 	}
 
-	// whip through and actually transform each vertex
+	// bones are only evaluated once a vert uses them, as before
+	assert(surface->numBoneReferences <= iMAX_G2_BONEREFS_PER_SURFACE);
+	memset(bones, 0, sizeof(bones));
+
+	// whip through and actually transform each vertex, a batch at a time so
+	// the weights are unpacked in one loop and skinned in another
 	const int numVerts = surface->numVerts;
 	v = (mdxmVertex_t *) ((byte *)surface + surface->ofsVerts);
 	mdxmVertexTexCoord_t *pTexCoords = (mdxmVertexTexCoord_t *) &v[numVerts];
 
-	// optimisation issue
-	if ((scale[0] != 1.0) || (scale[1] != 1.0) || (scale[2] != 1.0))
+	for ( batch = 0; batch < numVerts; batch += G2_SKIN_BATCH )
 	{
-		for ( j = 0; j < numVerts; j++ )
-		{
-			vec3_t			tempVert, tempNormal;
-//			mdxmWeight_t	*w;
-
-			VectorClear( tempVert );
-			VectorClear( tempNormal );
-//			w = v->weights;
-
-			const int iNumWeights = G2_GetVertWeights( v );
+		const int numBatch = Q_min( numVerts - batch, G2_SKIN_BATCH );
 
-			float fTotalWeight = 0.0f;
-			for ( k = 0 ; k < iNumWeights ; k++ )
-			{
-				int		iBoneIndex	= G2_GetVertBoneIndex( v, k );
-				float	fBoneWeight	= G2_GetVertBoneWeight( v, k, fTotalWeight, iNumWeights );
-
-				const mdxaBone_t &bone=EvalBoneCache(piBoneReferences[iBoneIndex],boneCache);
-
-				tempVert[0] += fBoneWeight * ( DotProduct( bone.matrix[0], v->vertCoords ) + bone.matrix[0][3] );
-				tempVert[1] += fBoneWeight * ( DotProduct( bone.matrix[1], v->vertCoords ) + bone.matrix[1][3] );
-				tempVert[2] += fBoneWeight * ( DotProduct( bone.matrix[2], v->vertCoords ) + bone.matrix[2][3] );
-
-				tempNormal[0] += fBoneWeight * DotProduct( bone.matrix[0], v->normal );
-				tempNormal[1] += fBoneWeight * DotProduct( bone.matrix[1], v->normal );
-				tempNormal[2] += fBoneWeight * DotProduct( bone.matrix[2], v->normal );
-			}
-			int pos = j * 5;
-
-			// copy tranformed verts into temp space
-			TransformedVerts[pos++] = tempVert[0] * scale[0];
-			TransformedVerts[pos++] = tempVert[1] * scale[1];
-			TransformedVerts[pos++] = tempVert[2] * scale[2];
-			// we will need the S & T coors too for hitlocation and hitmaterial stuff
-			TransformedVerts[pos++] = pTexCoords[j].texCoords[0];
-			TransformedVerts[pos] = pTexCoords[j].texCoords[1];
-
-			v++;// = (mdxmVertex_t *)&v->weights[/*v->numWeights*/surface->maxVertBoneWeights];
-		}
-	}
-	else
-	{
-		int pos = 0;
-	  	for ( j = 0; j < numVerts; j++ )
+		for ( j = 0; j < numBatch; j++, v++ )
 		{
-			vec3_t			tempVert, tempNormal;
-//			const mdxmWeight_t	*w;
-
-			VectorClear( tempVert );
-			VectorClear( tempNormal );
-//			w = v->weights;
-
-			const int iNumWeights = G2_GetVertWeights( v );
-
+			skinVertex_t *sv = &skinVerts[j];
 			float fTotalWeight = 0.0f;
-			for ( k = 0 ; k < iNumWeights ; k++ )
-			{
-				int		iBoneIndex	= G2_GetVertBoneIndex( v, k );
-				float	fBoneWeight	= G2_GetVertBoneWeight( v, k, fTotalWeight, iNumWeights );
-
-				const mdxaBone_t &bone=EvalBoneCache(piBoneReferences[iBoneIndex],boneCache);
 
-				tempVert[0] += fBoneWeight * ( DotProduct( bone.matrix[0], v->vertCoords ) + bone.matrix[0][3] );
-				tempVert[1] += fBoneWeight * ( DotProduct( bone.matrix[1], v->vertCoords ) + bone.matrix[1][3] );
-				tempVert[2] += fBoneWeight * ( DotProduct( bone.matrix[2], v->vertCoords ) + bone.matrix[2][3] );
+			VectorCopy( v->vertCoords, sv->xyz );
+			sv->numWeights = G2_GetVertWeights( v );
+			for ( k = 0 ; k < sv->numWeights ; k++ )
+			{
+				const int iBoneIndex = G2_GetVertBoneIndex( v, k );
 
-				tempNormal[0] += fBoneWeight * DotProduct( bone.matrix[0], v->normal );
-				tempNormal[1] += fBoneWeight * DotProduct( bone.matrix[1], v->normal );
-				tempNormal[2] += fBoneWeight * DotProduct( bone.matrix[2], v->normal );
+				sv->bone[k] = iBoneIndex;
+				sv->weight[k] = G2_GetVertBoneWeight( v, k, fTotalWeight, sv->numWeights );
+				if ( !bones[iBoneIndex] )
+				{
+					bones[iBoneIndex] = &EvalBoneCache(piBoneReferences[iBoneIndex],boneCache).matrix[0][0];
+				}
 			}
+		}
 
-			// copy tranformed verts into temp space
-			TransformedVerts[pos++] = tempVert[0];
-			TransformedVerts[pos++] = tempVert[1];
-			TransformedVerts[pos++] = tempVert[2];
-			// we will need the S & T coors too for hitlocation and hitmaterial stuff
-			TransformedVerts[pos++] = pTexCoords[j].texCoords[0];
-			TransformedVerts[pos++] = pTexCoords[j].texCoords[1];
+		float *out = TransformedVerts + batch * 5;
+		g2Kernels->skinVerts( out, 5, skinVerts, numBatch, bones, scale );
 
-			v++;// = (mdxmVertex_t *)&v->weights[/*v->numWeights*/surface->maxVertBoneWeights];
+		// we will need the S & T coors too for hitlocation and hitmaterial stuff
+		for ( j = 0; j < numBatch; j++, out += 5 )
+		{
+			out[3] = pTexCoords[batch + j].texCoords[0];
+			out[4] = pTexCoords[batch + j].texCoords[1];
 		}
 	}
+
+	G2_BuildTraceBounds(surface, TransformedVerts);
 }
 
 void G2_TransformSurfaces(int surfaceNum, surfaceInfo_v &rootSList,
@@ -644,6 +693,293 @@ void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale,
 }
 
 
+/*
+==============
+Trace vert cache
+
+A hit detection trace needs the skeleton built and every surface skinned, and
+the same player gets traced dozens of times in a busy server frame by sabers
+and shots. The transformed verts of each entity are kept in their own heap
+until the frame, the LOD or the scale changes, or anything the game can
+change in between two traces: the bone overrides, the surface overrides and
+the models themselves. Those are copied into a key that is compared in full
+on every trace, rather than relying on every API call that touches them
+flagging the change.
+==============
+*/
+
+#define		GHOUL2_RAG_STARTED						0x0010
+
+#define G2_TRACECACHE_ALIGN		16
+#define G2_TRACECACHE_ALIGNED(x)	(((x) + G2_TRACECACHE_ALIGN - 1) & ~(G2_TRACECACHE_ALIGN - 1))
+
+class CG2TraceCache : public IHeapAllocator
+{
+public:
+	int				mFrameNum;
+	int				mUseLod;
+	vec3_t			mScale;
+	std::vector<byte>	mKey;
+	int				mNumModels;
+	size_t			**mVertsArrays;	// per model, at the start of the heap
+
+	char			*mHeap;
+	int				mSize;
+	int				mUsed;
+
+	CG2TraceCache() :
+	mFrameNum(-1),
+	mUseLod(-1),
+	mNumModels(0),
+	mVertsArrays(0),
+	mHeap(0),
+	mSize(0),
+	mUsed(0)
+	{
+		VectorClear(mScale);
+	}
+
+	void ResetHeap()
+	{
+		mUsed = 0;
+	}
+
+	char *MiniHeapAlloc(int size)
+	{
+		size = G2_TRACECACHE_ALIGNED(size);
+		if (mUsed + size > mSize)
+		{
+			return NULL;
+		}
+		char *tempAddress = mHeap + mUsed;
+		mUsed += size;
+		return tempAddress;
+	}
+};
+
+static CG2TraceCache	*g2TraceCache[MAX_GENTITIES];
+
+static void G2_TraceCacheKeyAdd(std::vector<byte> &key, const void *data, size_t size)
+{
+	const byte *p = (const byte *)data;
+
+	key.insert(key.end(), p, p + size);
+}
+
+// field by field, so padding never makes two equal poses differ
+#define G2_TRACECACHE_KEY(key, field)	G2_TraceCacheKeyAdd(key, &(field), sizeof(field))
+
+// everything the pose and the surfaces are made of, returns false if the
+// entity can't be cached at all
+static bool G2_TraceCacheKey(CGhoul2Info_v &ghoul2, std::vector<byte> &key)
+{
+	int i;
+
+	key.clear();
+	G2_TRACECACHE_KEY(key, ghoul2.mItem);
+
+	for (i=0; i<ghoul2.size(); i++)
+	{
+		CGhoul2Info &g = ghoul2[i];
+		const int flags = g.mFlags & ~GHOUL2_ZONETRANSALLOC;
+
+		if (g.mFlags & GHOUL2_RAG_STARTED)
+		{ // the ragdoll moves bones in ways the bone list doesn't show
+			return false;
+		}
+
+		G2_TRACECACHE_KEY(key, g.mValid);
+		G2_TRACECACHE_KEY(key, g.currentModel);
+		G2_TRACECACHE_KEY(key, g.aHeader);
+		G2_TRACECACHE_KEY(key, flags);
+		G2_TRACECACHE_KEY(key, g.mModelBoltLink);
+		G2_TRACECACHE_KEY(key, g.mSurfaceRoot);
+		G2_TRACECACHE_KEY(key, g.mLodBias);
+		G2_TRACECACHE_KEY(key, g.mNewOrigin);
+
+		const int numBones = (int)g.mBlist.size();
+		G2_TRACECACHE_KEY(key, numBones);
+		for (size_t j=0; j<g.mBlist.size(); j++)
+		{
+			const boneInfo_t &bone = g.mBlist[j];
+
+			if (bone.flags & (BONE_ANGLES_RAGDOLL|BONE_ANGLES_IK))
+			{
+				return false;
+			}
+			G2_TRACECACHE_KEY(key, bone.boneNumber);
+			G2_TRACECACHE_KEY(key, bone.matrix);
+			G2_TRACECACHE_KEY(key, bone.flags);
+			G2_TRACECACHE_KEY(key, bone.startFrame);
+			G2_TRACECACHE_KEY(key, bone.endFrame);
+			G2_TRACECACHE_KEY(key, bone.startTime);
+			G2_TRACECACHE_KEY(key, bone.pauseTime);
+			G2_TRACECACHE_KEY(key, bone.animSpeed);
+			G2_TRACECACHE_KEY(key, bone.blendFrame);
+			G2_TRACECACHE_KEY(key, bone.blendLerpFrame);
+			G2_TRACECACHE_KEY(key, bone.blendTime);
+			G2_TRACECACHE_KEY(key, bone.blendStart);
+			G2_TRACECACHE_KEY(key, bone.boneBlendTime);
+			G2_TRACECACHE_KEY(key, bone.boneBlendStart);
+		}
+
+		const int numSurfaces = (int)g.mSlist.size();
+		G2_TRACECACHE_KEY(key, numSurfaces);
+		for (size_t j=0; j<g.mSlist.size(); j++)
+		{
+			const surfaceInfo_t &surf = g.mSlist[j];
+
+			G2_TRACECACHE_KEY(key, surf.offFlags);
+			G2_TRACECACHE_KEY(key, surf.surface);
+			G2_TRACECACHE_KEY(key, surf.genBarycentricJ);
+			G2_TRACECACHE_KEY(key, surf.genBarycentricI);
+			G2_TRACECACHE_KEY(key, surf.genPolySurfaceIndex);
+			G2_TRACECACHE_KEY(key, surf.genLod);
+		}
+	}
+
+	return true;
+}
+
+// room for the verts of every surface, whether it ends up being on or not
+static int G2_TraceCacheSize(CGhoul2Info_v &ghoul2, int useLod)
+{
+	int size = G2_TRACECACHE_ALIGNED(ghoul2.size() * sizeof(size_t *));
+	int i, j;
+
+	for (i=0; i<ghoul2.size(); i++)
+	{
+		CGhoul2Info &g = ghoul2[i];
+
+		if (!g.mValid)
+		{
+			continue;
+		}
+
+		const int lod = G2_DecideTraceLod(g, useLod);
+		const int numSurfaces = g.currentModel->mdxm->numSurfaces;
+
+		size += G2_TRACECACHE_ALIGNED(numSurfaces * sizeof(size_t));
+		for (j=0; j<numSurfaces; j++)
+		{
+			const mdxmSurface_t *surface = (mdxmSurface_t *)G2_FindSurface((void *)g.currentModel, j, lod);
+			size += G2_TRACECACHE_ALIGNED(G2_TransformedSurfaceSize(surface));
+		}
+	}
+
+	return size;
+}
+
+/*
+==============
+G2_TransformModelCached
+
+Same as the skeleton build and G2_TransformModel, but reuses the verts of an
+earlier trace against entNum when nothing changed since. Entities outside of
+the cache fall back to G2VertSpace.
+==============
+*/
+void G2_TransformModelCached(CGhoul2Info_v &ghoul2, const int frameNum, int entNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod)
+{
+	static std::vector<byte>	key;
+	CG2TraceCache	*cache;
+	int				i;
+
+	if (entNum < 0 || entNum >= MAX_GENTITIES || !G2_TraceCacheKey(ghoul2, key))
+	{
+		G2_ConstructGhoulSkeleton(ghoul2, frameNum, true, scale);
+		G2VertSpace->ResetHeap();
+#ifdef _G2_GORE
+		G2_TransformModel(ghoul2, frameNum, scale, G2VertSpace, useLod, false);
+#else
+		G2_TransformModel(ghoul2, frameNum, scale, G2VertSpace, useLod);
+#endif
+		return;
+	}
+
+	if (!g2TraceCache[entNum])
+	{
+		g2TraceCache[entNum] = new CG2TraceCache;
+	}
+	cache = g2TraceCache[entNum];
+
+	for (i=0; i<ghoul2.size(); i++)
+	{ // the array has to come from the cache, G2API_CollisionDetectCache may
+		// have left one of its own that it would write into later
+		if ((ghoul2[i].mFlags & GHOUL2_ZONETRANSALLOC) && ghoul2[i].mTransformedVertsArray)
+		{
+			Z_Free(ghoul2[i].mTransformedVertsArray);
+			ghoul2[i].mTransformedVertsArray = 0;
+		}
+		ghoul2[i].mFlags &= ~GHOUL2_ZONETRANSALLOC;
+	}
+
+	if (cache->mFrameNum == frameNum &&
+		cache->mUseLod == useLod &&
+		cache->mNumModels == ghoul2.size() &&
+		VectorCompare(cache->mScale, scale) &&
+		cache->mKey == key)
+	{
+		for (i=0; i<ghoul2.size(); i++)
+		{
+			ghoul2[i].mTransformedVertsArray = cache->mVertsArrays[i];
+		}
+		return;
+	}
+
+	const int size = G2_TraceCacheSize(ghoul2, useLod);
+	if (size > cache->mSize)
+	{
+		if (cache->mHeap)
+		{
+			Z_Free(cache->mHeap);
+		}
+		cache->mHeap = (char *)Z_Malloc(size, TAG_GHOUL2, qfalse);
+		cache->mSize = size;
+	}
+
+	cache->ResetHeap();
+	cache->mVertsArrays = (size_t **)cache->MiniHeapAlloc(ghoul2.size() * sizeof(size_t *));
+
+	G2_ConstructGhoulSkeleton(ghoul2, frameNum, true, scale);
+#ifdef _G2_GORE
+	G2_TransformModel(ghoul2, frameNum, scale, cache, useLod, false);
+#else
+	G2_TransformModel(ghoul2, frameNum, scale, cache, useLod);
+#endif
+
+	for (i=0; i<ghoul2.size(); i++)
+	{
+		cache->mVertsArrays[i] = ghoul2[i].mValid ? ghoul2[i].mTransformedVertsArray : NULL;
+	}
+
+	cache->mFrameNum = frameNum;
+	cache->mUseLod = useLod;
+	cache->mKey = key;
+	cache->mNumModels = ghoul2.size();
+	VectorCopy(scale, cache->mScale);
+}
+
+// models are about to be reloaded, drop everything
+void G2_ClearTraceCache(void)
+{
+	int i;
+
+	for (i=0; i<MAX_GENTITIES; i++)
+	{
+		if (g2TraceCache[i])
+		{
+			if (g2TraceCache[i]->mHeap)
+			{
+				Z_Free(g2TraceCache[i]->mHeap);
+			}
+			delete g2TraceCache[i];
+			g2TraceCache[i] = NULL;
+		}
+	}
+}
+
+
 // work out how much space a triangle takes
 static float	G2_AreaOfTri(const vec3_t A, const vec3_t B, const vec3_t C)
 {
@@ -1072,9 +1408,25 @@ static bool G2_TracePolys(const mdxmSurface_t *surface, const mdxmSurfHierarchy_
 	// whip through and actually transform each vertex
 	const mdxmTriangle_t *tris = (mdxmTriangle_t *) ((byte *)surface + surface->ofsTriangles);
 	const float *verts = (float *)TS.TransformedVertsArray[surface->thisSurfaceIndex];
+	const float *bounds = &verts[surface->numVerts * 5];
+	vec3_t rayDir;
+
+	VectorSubtract(TS.rayEnd, TS.rayStart, rayDir);
+	if (!G2_SegmentHitsBounds(TS.rayStart, rayDir, bounds))
+	{
+		return false;
+	}
+
 	numTris = surface->numTriangles;
 	for ( j = 0; j < numTris; j++ )
 	{
+		// skip chunks of triangles the ray doesn't come near
+		if (!(j % G2_TRACE_CHUNK) && !G2_SegmentHitsBounds(TS.rayStart, rayDir, &bounds[6 * (1 + j / G2_TRACE_CHUNK)]))
+		{
+			j += G2_TRACE_CHUNK - 1;
+			continue;
+		}
+
 		float			face;
 		vec3_t	hitPoint, normal;
 		// determine actual coords for this triangle
@@ -1194,6 +1546,46 @@ static bool G2_TracePolys(const mdxmSurface_t *surface, const mdxmSurfHierarchy_
 	return false;
 }
 
+// which sides of the radius trace box a point is off, see G2_RadiusTracePolys
+static inline int G2_RadiusPointFlags(const float *point, const vec3_t rayStart, const vec3_t saxis, const vec3_t taxis, const vec3_t rayDir)
+{
+	vec3_t delta;
+	delta[0]=point[0]-rayStart[0];
+	delta[1]=point[1]-rayStart[1];
+	delta[2]=point[2]-rayStart[2];
+	const float s=DotProduct(delta,saxis)+0.5f;
+	const float t=DotProduct(delta,taxis)+0.5f;
+	const float u=DotProduct(delta,rayDir);
+	int vflags=0;
+
+	if (s>0)
+	{
+		vflags|=1;
+	}
+	if (s<1)
+	{
+		vflags|=2;
+	}
+	if (t>0)
+	{
+		vflags|=4;
+	}
+	if (t<1)
+	{
+		vflags|=8;
+	}
+	if (u>0)
+	{
+		vflags|=16;
+	}
+	if (u<1)
+	{
+		vflags|=32;
+	}
+
+	return ~vflags;
+}
+
 // now we're at poly level, check each model space transformed poly against the model world transfomed ray
 static bool G2_RadiusTracePolys(
 								const mdxmSurface_t *surface,
@@ -1250,44 +1642,28 @@ static bool G2_RadiusTracePolys(
 	v3RayDir[1]/=f;
 	v3RayDir[2]/=f;
 
-	for ( j = 0; j < numVerts; j++ )
+	// the test is linear, so if all corners of the bounds are off the same
+	// side the whole surface is
+	const float *bounds = &verts[numVerts * 5];
+	for ( j = 0; j < 8; j++ )
 	{
-		const int pos=j*5;
-		vec3_t delta;
-		delta[0]=verts[pos+0]-TS.rayStart[0];
-		delta[1]=verts[pos+1]-TS.rayStart[1];
-		delta[2]=verts[pos+2]-TS.rayStart[2];
-		const float s=DotProduct(delta,saxis)+0.5f;
-		const float t=DotProduct(delta,taxis)+0.5f;
-		const float u=DotProduct(delta,v3RayDir);
-		int vflags=0;
+		vec3_t corner;
+		corner[0]=bounds[(j & 1) ? 3 : 0];
+		corner[1]=bounds[(j & 2) ? 4 : 1];
+		corner[2]=bounds[(j & 4) ? 5 : 2];
+		flags&=G2_RadiusPointFlags(corner, TS.rayStart, saxis, taxis, v3RayDir);
+	}
 
-		if (s>0)
-		{
-			vflags|=1;
-		}
-		if (s<1)
-		{
-			vflags|=2;
-		}
-		if (t>0)
-		{
-			vflags|=4;
-		}
-		if (t<1)
-		{
-			vflags|=8;
-		}
-		if (u>0)
-		{
-			vflags|=16;
-		}
-		if (u<1)
-		{
-			vflags|=32;
-		}
+	if (flags)
+	{
+		return false;
+	}
+	flags=63;
+
+	for ( j = 0; j < numVerts; j++ )
+	{
+		const int vflags=G2_RadiusPointFlags(&verts[j*5], TS.rayStart, saxis, taxis, v3RayDir);
 
-		vflags=(~vflags);
 		flags&=vflags;
 		GoreVerts[j].flags=vflags;
 	}
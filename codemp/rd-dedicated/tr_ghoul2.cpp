@@ -23,6 +23,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "client/client.h"	//FIXME!! EVIL - just include the definitions needed
 #include "tr_local.h"
 #include "qcommon/matcomp.h"
+#include "qcommon/q_skinning.h"
 #include "qcommon/qcommon.h"
 #include "ghoul2/G2.h"
 #include "ghoul2/g2_local.h"
@@ -101,6 +102,9 @@ void G2Time_ReportTimers(void)
 
 bool HackadelicOnClient=false; // means this is a render traversal
 
+// bone and skinning math, the fastest the cpu can do
+const skinKernels_t *g2Kernels = Skin_SelectKernels();
+
 qboolean G2_SetupModelPointers(CGhoul2Info *ghlInfo);
 qboolean G2_SetupModelPointers(CGhoul2Info_v &ghoul2);
 
@@ -232,7 +236,6 @@ class CBoneCache
 	{
 		if (mSmoothBones[index].touch==mLastTouch)
 		{
-			int i;
 			float *oldM=&mSmoothBones[index].boneMatrix.matrix[0][0];
 			float *newM=&mFinalBones[index].boneMatrix.matrix[0][0];
 #if 0 //this is just too slow. I need a better way.
@@ -275,10 +278,7 @@ class CBoneCache
 			}
 #endif
 
-			for (i=0;i<12;i++,oldM++,newM++)
-			{
-				*oldM=mSmoothFactor*(*oldM-*newM)+*newM;
-			}
+			g2Kernels->blendMatrix(oldM, oldM, newM, mSmoothFactor);
 		}
 		else
 		{
@@ -409,13 +409,9 @@ public:
 					}
 					float f=1.0f-pow(1.0f-mSmoothFactor,16.0f/dif);
 
-					int i;
 					float *oldM=&mSmoothBones[index].boneMatrix.matrix[0][0];
 					float *newM=&mFinalBones[index].boneMatrix.matrix[0][0];
-					for (i=0;i<12;i++,oldM++,newM++)
-					{
-						*oldM=f*(*oldM-*newM)+*newM;
-					}
+					g2Kernels->blendMatrix(oldM, oldM, newM, f);
 					if (mUnsquash)
 					{
 						mdxaBone_t tempMatrix;
@@ -897,21 +893,7 @@ void G2_CreateMatrixFromQuaterion(mdxaBone_t *mat, vec4_t quat)
 // nasty little matrix multiply going on here..
 void Multiply_3x4Matrix(mdxaBone_t *out, mdxaBone_t *in2, mdxaBone_t *in)
 {
-	// first row of out
-	out->matrix[0][0] = (in2->matrix[0][0] * in->matrix[0][0]) + (in2->matrix[0][1] * in->matrix[1][0]) + (in2->matrix[0][2] * in->matrix[2][0]);
-	out->matrix[0][1] = (in2->matrix[0][0] * in->matrix[0][1]) + (in2->matrix[0][1] * in->matrix[1][1]) + (in2->matrix[0][2] * in->matrix[2][1]);
-	out->matrix[0][2] = (in2->matrix[0][0] * in->matrix[0][2]) + (in2->matrix[0][1] * in->matrix[1][2]) + (in2->matrix[0][2] * in->matrix[2][2]);
-	out->matrix[0][3] = (in2->matrix[0][0] * in->matrix[0][3]) + (in2->matrix[0][1] * in->matrix[1][3]) + (in2->matrix[0][2] * in->matrix[2][3]) + in2->matrix[0][3];
-	// second row of outf out
-	out->matrix[1][0] = (in2->matrix[1][0] * in->matrix[0][0]) + (in2->matrix[1][1] * in->matrix[1][0]) + (in2->matrix[1][2] * in->matrix[2][0]);
-	out->matrix[1][1] = (in2->matrix[1][0] * in->matrix[0][1]) + (in2->matrix[1][1] * in->matrix[1][1]) + (in2->matrix[1][2] * in->matrix[2][1]);
-	out->matrix[1][2] = (in2->matrix[1][0] * in->matrix[0][2]) + (in2->matrix[1][1] * in->matrix[1][2]) + (in2->matrix[1][2] * in->matrix[2][2]);
-	out->matrix[1][3] = (in2->matrix[1][0] * in->matrix[0][3]) + (in2->matrix[1][1] * in->matrix[1][3]) + (in2->matrix[1][2] * in->matrix[2][3]) + in2->matrix[1][3];
-	// third row of out  out
-	out->matrix[2][0] = (in2->matrix[2][0] * in->matrix[0][0]) + (in2->matrix[2][1] * in->matrix[1][0]) + (in2->matrix[2][2] * in->matrix[2][0]);
-	out->matrix[2][1] = (in2->matrix[2][0] * in->matrix[0][1]) + (in2->matrix[2][1] * in->matrix[1][1]) + (in2->matrix[2][2] * in->matrix[2][1]);
-	out->matrix[2][2] = (in2->matrix[2][0] * in->matrix[0][2]) + (in2->matrix[2][1] * in->matrix[1][2]) + (in2->matrix[2][2] * in->matrix[2][2]);
-	out->matrix[2][3] = (in2->matrix[2][0] * in->matrix[0][3]) + (in2->matrix[2][1] * in->matrix[1][3]) + (in2->matrix[2][2] * in->matrix[2][3]) + in2->matrix[2][3];
+	g2Kernels->multiplyMatrix(&out->matrix[0][0], &in2->matrix[0][0], &in->matrix[0][0]);
 }
 
 
@@ -1318,7 +1300,7 @@ void G2_TransformBone (int child,CBoneCache &BC)
 	static mdxaSkel_t		*skel;
 	static mdxaSkelOffsets_t *offsets;
 	boneInfo_v		&boneList = *BC.rootBoneList;
-	static int				j, boneListIndex;
+	static int				boneListIndex;
 	int				angleOverride = 0;
 
 #if DEBUG_G2_TIMING
@@ -1469,18 +1451,13 @@ void G2_TransformBone (int child,CBoneCache &BC)
 	if (TB.blendMode)
 	{
 		float backlerp = TB.blendFrame - (int)TB.blendFrame;
-		float frontlerp = 1.0 - backlerp;
 
 // 		MC_UnCompress(tbone[3].matrix,compBonePointer[bFrame->boneIndexes[child]].Comp);
 // 		MC_UnCompress(tbone[4].matrix,compBonePointer[boldFrame->boneIndexes[child]].Comp);
 		UnCompressBone(tbone[3].matrix, child, BC.header, TB.blendFrame);
 		UnCompressBone(tbone[4].matrix, child, BC.header, TB.blendOldFrame);
 
-		for ( j = 0 ; j < 12 ; j++ )
-		{
-  			((float *)&tbone[5])[j] = (backlerp * ((float *)&tbone[3])[j])
-				+ (frontlerp * ((float *)&tbone[4])[j]);
-		}
+		g2Kernels->blendMatrix((float *)&tbone[5], (float *)&tbone[3], (float *)&tbone[4], backlerp);
 	}
 
   	//
@@ -1494,12 +1471,7 @@ void G2_TransformBone (int child,CBoneCache &BC)
 		// blend in the other frame if we need to
 		if (TB.blendMode)
 		{
-			float blendFrontlerp = 1.0 - TB.blendLerp;
-	  		for ( j = 0 ; j < 12 ; j++ )
-			{
-  				((float *)&tbone[2])[j] = (TB.blendLerp * ((float *)&tbone[2])[j])
-					+ (blendFrontlerp * ((float *)&tbone[5])[j]);
-			}
+			g2Kernels->blendMatrix((float *)&tbone[2], (float *)&tbone[2], (float *)&tbone[5], TB.blendLerp);
 		}
 
   		if (!child)
@@ -1510,27 +1482,17 @@ void G2_TransformBone (int child,CBoneCache &BC)
   	}
 	else
   	{
-		float frontlerp = 1.0 - TB.backlerp;
 // 		MC_UnCompress(tbone[0].matrix,compBonePointer[aFrame->boneIndexes[child]].Comp);
 //		MC_UnCompress(tbone[1].matrix,compBonePointer[aoldFrame->boneIndexes[child]].Comp);
 		UnCompressBone(tbone[0].matrix, child, BC.header, TB.newFrame);
 		UnCompressBone(tbone[1].matrix, child, BC.header, TB.currentFrame);
 
-		for ( j = 0 ; j < 12 ; j++ )
-		{
-  			((float *)&tbone[2])[j] = (TB.backlerp * ((float *)&tbone[0])[j])
-				+ (frontlerp * ((float *)&tbone[1])[j]);
-		}
+		g2Kernels->blendMatrix((float *)&tbone[2], (float *)&tbone[0], (float *)&tbone[1], TB.backlerp);
 
 		// blend in the other frame if we need to
 		if (TB.blendMode)
 		{
-			float blendFrontlerp = 1.0 - TB.blendLerp;
-	  		for ( j = 0 ; j < 12 ; j++ )
-			{
-  				((float *)&tbone[2])[j] = (TB.blendLerp * ((float *)&tbone[2])[j])
-					+ (blendFrontlerp * ((float *)&tbone[5])[j]);
-			}
+			g2Kernels->blendMatrix((float *)&tbone[2], (float *)&tbone[2], (float *)&tbone[5], TB.blendLerp);
 		}
 
   		if (!child)
@@ -1598,12 +1560,7 @@ void G2_TransformBone (int child,CBoneCache &BC)
 				{
 //					mdxaBone_t lerp;
 					// now do the blend into the destination
-					float blendFrontlerp = 1.0 - blendLerp;
-	  				for ( j = 0 ; j < 12 ; j++ )
-					{
-  						((float *)&bone)[j] = (blendLerp * ((float *)&temp)[j])
-							+ (blendFrontlerp * ((float *)&tbone[2])[j]);
-					}
+					g2Kernels->blendMatrix((float *)&bone, (float *)&temp, (float *)&tbone[2], blendLerp);
 //					Multiply_3x4Matrix(&bone, &BC.mFinalBones[parent].boneMatrix,&lerp);
 				}
 			}
@@ -1668,12 +1625,7 @@ void G2_TransformBone (int child,CBoneCache &BC)
  					Multiply_3x4Matrix(&temp, &newMatrixTemp,&skel->BasePoseMatInv);
 
 					// now do the blend into the destination
-					float blendFrontlerp = 1.0 - blendLerp;
-	  				for ( j = 0 ; j < 12 ; j++ )
-					{
-  						((float *)&bone)[j] = (blendLerp * ((float *)&temp)[j])
-							+ (blendFrontlerp * ((float *)&firstPass)[j]);
-					}
+					g2Kernels->blendMatrix((float *)&bone, (float *)&temp, (float *)&firstPass, blendLerp);
 				}
 				else
 				{
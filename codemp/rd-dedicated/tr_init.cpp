@@ -674,5 +674,7 @@ refexport_t *GetRefAPI ( int apiVersion, refimport_t *rimp ) {
 	re.G2API_ClearSkinGore					= G2API_ClearSkinGore;
 	#endif // _SOF2
 
+	re.ext.G2API_CollisionDetectTraceCache	= G2API_CollisionDetectTraceCache;
+
 	return &re;
 }
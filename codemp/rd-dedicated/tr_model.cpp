@@ -1547,8 +1547,11 @@ static qboolean R_LoadMD3 (model_t *mod, int lod, void *buffer, const char *mod_
 
 //=============================================================================
 
+void G2_ClearTraceCache(void); //G2_misc.cpp
+
 void R_SVModelInit()
 {
+	G2_ClearTraceCache();
 	R_ModelInit();
 }
 
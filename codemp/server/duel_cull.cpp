@@ -97,11 +97,73 @@ static qboolean isDuelOpponent(sharedEntity_t *A, sharedEntity_t *B) { //wtf voi
 	return qfalse;
 }
 
-int DuelCull(sharedEntity_t *ent, sharedEntity_t *touch) { //figure something out for smooth collision?
+// DuelCull is asked about every entity for every client while the snapshots
+// are built, and nothing can change a duel in between, so everything it
+// needs to know about an entity is worked out once before that.
+#define DUELENT_BUILT			1
+#define DUELENT_ACTOR			2	// isActor
+#define DUELENT_DUELING			4	// isDueling
+#define DUELENT_FLAT_DUELING	8	// isDueling(flatten())
+
+typedef struct duelEntity_s {
+	byte	flags;
+	int		flat;			// flatten()
+	int		flatDuelIndex;	// duelIndex of flatten(), if it is dueling
+} duelEntity_t;
+
+static qboolean duelTableValid = qfalse;
+static duelEntity_t duelTable[MAX_GENTITIES];
+
+static void buildDuelEntity(int num) {
+	sharedEntity_t *ent = SV_GentityNum(num);
+	sharedEntity_t *flat = flatten(ent);
+	duelEntity_t *de = &duelTable[num];
+
+	de->flags = DUELENT_BUILT;
+	de->flat = SV_NumForGentity(flat);
+	de->flatDuelIndex = -1;
+
+	if (isActor(ent))
+		de->flags |= DUELENT_ACTOR;
+	if (isDueling(ent))
+		de->flags |= DUELENT_DUELING;
+	if (isDueling(flat)) {
+		de->flags |= DUELENT_FLAT_DUELING;
+		if (flat->playerState)
+			de->flatDuelIndex = flat->playerState->duelIndex;
+	}
+}
 
+/*
+==================
+SV_BuildDuelTable
+
+Only valid until the game runs again, see SV_ClearDuelTable.
+==================
+*/
+void SV_BuildDuelTable(void) {
+	int i;
+
+	duelTableValid = qfalse;
 	if (!sv_snapShotDuelCull->integer)
-		return 0;
+		return;
+
+	// only what a snapshot or a trace can ask about, the rest may be stale
+	for (i = 0; i < sv.num_entities; i++) {
+		if (i < sv_maxclients->integer || SV_GentityNum(i)->r.linked)
+			buildDuelEntity(i);
+		else
+			duelTable[i].flags = 0;
+	}
+
+	duelTableValid = qtrue;
+}
+
+void SV_ClearDuelTable(void) {
+	duelTableValid = qfalse;
+}
 
+static int duelCullLive(sharedEntity_t *ent, sharedEntity_t *touch) {
 	if (isActor(ent) && isActor(touch)) {
 		if (!isDueling(ent) && !isDueling(touch)) { //2 players in ffa
 			return 0; //don't cull
@@ -117,3 +179,33 @@ int DuelCull(sharedEntity_t *ent, sharedEntity_t *touch) { //figure something ou
 
 	return 0;
 }
+
+int DuelCull(sharedEntity_t *ent, sharedEntity_t *touch) { //figure something out for smooth collision?
+
+	if (!sv_snapShotDuelCull->integer)
+		return 0;
+
+	if (duelTableValid) {
+		const int e = ent->s.number;
+		const int t = touch->s.number;
+
+		// s.number saves a division, but it has to be the entity's slot
+		if (e >= 0 && e < sv.num_entities && t >= 0 && t < sv.num_entities
+			&& SV_GentityNum(e) == ent && SV_GentityNum(t) == touch
+			&& (duelTable[e].flags & DUELENT_BUILT) && (duelTable[t].flags & DUELENT_BUILT)) {
+			const duelEntity_t *de = &duelTable[e];
+			const duelEntity_t *dt = &duelTable[t];
+
+			if (!(de->flags & DUELENT_ACTOR) || !(dt->flags & DUELENT_ACTOR))
+				return 0;
+			if (!(de->flags & DUELENT_DUELING))
+				return (dt->flags & DUELENT_DUELING) ? 2 : 0;
+			if ((de->flags & DUELENT_FLAT_DUELING) && (dt->flags & DUELENT_FLAT_DUELING)
+				&& (de->flat == dt->flat || de->flatDuelIndex == dt->flat))
+				return 0;
+			return 1;
+		}
+	}
+
+	return duelCullLive(ent, touch);
+}
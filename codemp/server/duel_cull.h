@@ -2,4 +2,6 @@
 
 #include "server.h"
 
-int DuelCull(sharedEntity_t *a, sharedEntity_t *b);
\ No newline at end of file
+int DuelCull(sharedEntity_t *a, sharedEntity_t *b);
+void SV_BuildDuelTable(void);
+void SV_ClearDuelTable(void);
\ No newline at end of file
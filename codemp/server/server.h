@@ -42,13 +42,13 @@ extern int DuelCull(sharedEntity_t *a, sharedEntity_t *b);
 typedef struct svEntity_s {
 	struct worldSector_s *worldSector;
 	struct svEntity_s *nextEntityInWorldSector;
+	struct svEntity_s *prevEntityInWorldSector;
 
 	entityState_t	baseline;		// for delta compression of initial sighting
 	int			numClusters;		// if -1, use headnode instead
 	int			clusternums[MAX_ENT_CLUSTERS];
 	int			lastCluster;		// if all the clusters don't fit in clusternums
 	int			areanum, areanum2;
-	int			snapshotCounter;	// used to prevent double adding from portal views
 } svEntity_t;
 
 typedef enum {
@@ -63,7 +63,6 @@ typedef struct server_s {
 	int				serverId;			// changes each server start
 	int				restartedServerId;	// serverId before a map_restart
 	int				checksumFeed;		//
-	int				snapshotCounter;	// incremented for each snapshot built
 	int				timeResidual;		// <= 1000 / sv_frame->value
 	int				nextFrameTime;		// when time > nextFrameTime, process world
 	char			*configstrings[MAX_CONFIGSTRINGS];
@@ -129,12 +128,18 @@ typedef struct {
 	qboolean	demorecording;
 	qboolean	demowaiting;	// don't record until a non-delta message is sent
 	int			minDeltaFrame;	// the first non-delta frame stored in the demo.  cannot delta against frames older than this
-	fileHandle_t	demofile;
+	int			demoStream;	// see sv_demowriter.cpp
 	qboolean	isBot;
 	int			botReliableAcknowledge; // for bots, need to maintain a separate reliableAcknowledge to record server messages into the demo file
 } demoInfo_t;
 
 
+// a reliable command string, one copy shared by every client it was sent to
+typedef struct reliableCommand_s {
+	int				refCount;
+	char			string[1];		// allocated to fit
+} reliableCommand_t;
+
 typedef struct client_s {
 	clientState_t	state;
 	char			userinfo[MAX_INFO_STRING];		// name, etc
@@ -142,7 +147,7 @@ typedef struct client_s {
 
 	qboolean		sentGamedir; //see if he has been sent an svc_setgame
 
-	char			reliableCommands[MAX_RELIABLE_COMMANDS][MAX_STRING_CHARS];
+	reliableCommand_t	*reliableCommands[MAX_RELIABLE_COMMANDS];	// NULL until used, see SV_ReliableCommand
 	int				reliableSequence;		// last added reliable message, not necesarily sent or acknowledged yet
 	int				reliableAcknowledge;	// last acknowledged reliable message
 	int				reliableSent;			// last sent reliable message, not necesarily acknowledged yet
@@ -250,7 +255,7 @@ typedef struct serverStatic_s {
 #endif
 } serverStatic_t;
 
-#define SERVER_MAXBANS	1024
+#define SERVER_MAXBANS	16384
 // Structure for managing bans
 typedef struct serverBan_s {
 	netadr_t ip;
@@ -276,6 +281,7 @@ extern	cvar_t	*sv_timeout;
 extern	cvar_t	*sv_zombietime;
 extern	cvar_t	*sv_rconPassword;
 extern	cvar_t	*sv_logremote;
+extern	cvar_t	*sv_logEvents;
 extern	cvar_t	*sv_privatePassword;
 extern	cvar_t	*sv_allowDownload;
 extern	cvar_t	*sv_maxclients;
@@ -306,6 +312,8 @@ extern	cvar_t	*sv_filterCommands;
 extern	cvar_t	*sv_autoDemo;
 extern	cvar_t	*sv_autoDemoBots;
 extern	cvar_t	*sv_autoDemoMaxMaps;
+extern	cvar_t	*sv_autoDemoMaxMB;
+extern	cvar_t	*sv_autoDemoCompress;
 extern	cvar_t	*sv_legacyFixes;
 extern	cvar_t	*sv_strictPacketTimestamp;
 extern	cvar_t	*sv_banFile;
@@ -314,6 +322,9 @@ extern	cvar_t	*sv_maxOOBRateIP;
 extern	cvar_t	*sv_autoWhitelist;
 
 extern	cvar_t	*sv_snapShotDuelCull;
+extern	cvar_t	*sv_sectorSize;
+extern	cvar_t	*sv_snapshotVerify;
+extern	cvar_t	*sv_deltaCache;
 
 extern	cvar_t	*sv_pingFix;
 extern	cvar_t	*sv_hibernateTime;
@@ -321,6 +332,7 @@ extern	cvar_t	*sv_hibernateFPS;
 
 #ifdef DEDICATED
 extern	cvar_t	*sv_antiDST;
+extern	cvar_t	*sv_g2TraceCache;
 
 //extern	cvar_t	*sv_g_logSync;
 #endif
@@ -362,6 +374,11 @@ void SVC_LoadWhitelist( void );
 void SVC_WhitelistAdr( netadr_t adr );
 void SV_FinalMessage (char *message);
 void QDECL SV_SendServerCommand( client_t *cl, const char *fmt, ...);
+reliableCommand_t *SV_NewReliableCommand( const char *cmd );
+void SV_ReleaseReliableCommand( reliableCommand_t *cmd );
+void SV_AddReliableCommand( client_t *client, reliableCommand_t *cmd );
+const char *SV_ReliableCommand( const client_t *client, int sequence );
+void SV_ClearReliableCommands( client_t *client );
 
 
 void SV_AddOperatorCommands (void);
@@ -389,6 +406,14 @@ void SV_SpawnServer( char *server, qboolean killBots, ForceReload_e eForceReload
 
 
 
+//
+// sv_bantrie.cpp
+//
+void SV_RebuildBanTrie( void );
+void SV_BanTrieAdd( const netadr_t *adr, int subnet, qboolean isexception );
+qboolean SV_BanTrieMatch( const netadr_t *adr, qboolean isexception );
+qboolean SV_BanTrieCovers( const netadr_t *adr, int subnet, qboolean isexception );
+
 //
 // sv_challenge.cpp
 //
@@ -424,12 +449,33 @@ void SV_WriteDownloadToClient( client_t *cl , msg_t *msg );
 // sv_ccmds.c
 //
 void SV_Heartbeat_f( void );
-void SV_RecordDemo( client_t *cl, char *demoName );
+void SV_RecordDemo( client_t *cl, char *demoName, int compression );
 void SV_StopRecordDemo( client_t *cl );
 void SV_AutoRecordDemo( client_t *cl );
 void SV_StopAutoRecordDemos();
 void SV_BeginAutoRecordDemos();
 
+//
+// sv_demowriter.cpp
+//
+int SV_DemoWriter_Open( const char *qpath, int client, int compression );
+qboolean SV_DemoWriter_Write( int stream, int sequence, const void *data, int len );
+void SV_DemoWriter_Close( int stream );
+void SV_DemoWriterStatus_f( void );
+void SV_DemoConvert_f( void );
+void SV_DemoWriter_Init( void );
+void SV_DemoWriter_Shutdown( void );
+
+//
+// sv_jobs.cpp
+//
+typedef void (*svJobFunc_t)( int job, void *data );
+
+int SV_Jobs_Threads( void );
+void SV_Jobs_Run( svJobFunc_t func, void *data, int numJobs );
+void SV_Jobs_Init( void );
+void SV_Jobs_Shutdown( void );
+
 //
 // sv_snapshot.c
 //
@@ -439,6 +485,7 @@ void SV_WriteFrameToClient (client_t *client, msg_t *msg);
 void SV_SendMessageToClient( msg_t *msg, client_t *client );
 void SV_SendClientMessages( void );
 void SV_SendClientSnapshot( client_t *client );
+void SV_DeltaCacheStatus_f( void );
 
 //
 // sv_game.c
@@ -452,6 +499,12 @@ void		SV_InitGameProgs ( void );
 void		SV_ShutdownGameProgs ( void );
 qboolean	SV_inPVS (const vec3_t p1, const vec3_t p2);
 
+//
+// sv_events.cpp
+//
+void		SV_LogEvent( const logEvent_t *ev );
+void		SV_LogClientEvent( client_t *cl, logEventType_t type, const char *reason );
+
 //
 // sv_bot.c
 //
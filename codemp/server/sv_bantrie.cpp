@@ -0,0 +1,237 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// sv_bantrie.cpp -- prefix lookup of bans and exceptions
+//
+// serverBans stays the list that is listed, edited and written to the ban
+// file. Connecting clients are looked up in a path compressed binary trie of
+// the IPv4 entries instead, which visits at most one node per prefix length
+// however long the list is. Every node is a prefix that has a ban, an
+// exception or two children, so n entries never need more than 2n + 1 nodes.
+//
+// The trie is rebuilt from the list whenever the list is edited, sv_banimport
+// adds to it directly. Other address types are rare and still go through the
+// list, see SV_IsBanned.
+
+#include "server.h"
+
+#define BANTRIE_BAN			1
+#define BANTRIE_EXCEPTION	2
+
+typedef struct banNode_s {
+	uint32_t	key;		// host order, the bits past len are zero
+	byte		len;		// prefix length, 0 - 32
+	byte		flags;		// BANTRIE_*
+	int			child[2];	// by the bit after the prefix, -1 for none
+} banNode_t;
+
+static banNode_t	*banNodes;
+static int			banNodeCount;
+static int			banNodeAlloc;
+
+static uint32_t SV_BanTrieKey( const netadr_t *adr ) {
+	return ((uint32_t)adr->ip[0] << 24) | ((uint32_t)adr->ip[1] << 16) | ((uint32_t)adr->ip[2] << 8) | adr->ip[3];
+}
+
+static uint32_t SV_BanTrieMask( int len ) {
+	return len ? 0xffffffffu << (32 - len) : 0;
+}
+
+static int SV_BanTrieBit( uint32_t key, int pos ) {
+	return (key >> (31 - pos)) & 1;
+}
+
+static int SV_BanTrieCommonLength( uint32_t a, uint32_t b, int limit ) {
+	const uint32_t diff = a ^ b;
+	int len;
+
+	for ( len = 0; len < limit && !SV_BanTrieBit( diff, len ); len++ )
+		;
+	return len;
+}
+
+/*
+==================
+SV_AllocBanNode
+
+Returns an index, the pool may move so don't hold on to node pointers.
+==================
+*/
+static int SV_AllocBanNode( uint32_t key, int len, int flags ) {
+	banNode_t *node;
+
+	if ( banNodeCount == banNodeAlloc ) {
+		const int newAlloc = banNodeAlloc ? banNodeAlloc * 2 : 256;
+		banNode_t *newNodes = (banNode_t *)Z_Malloc( newAlloc * sizeof( *newNodes ), TAG_GENERAL, qfalse );
+
+		if ( banNodes ) {
+			memcpy( newNodes, banNodes, banNodeCount * sizeof( *newNodes ) );
+			Z_Free( banNodes );
+		}
+		banNodes = newNodes;
+		banNodeAlloc = newAlloc;
+	}
+
+	node = &banNodes[banNodeCount];
+	node->key = key;
+	node->len = (byte)len;
+	node->flags = (byte)flags;
+	node->child[0] = node->child[1] = -1;
+	return banNodeCount++;
+}
+
+static void SV_BanTrieInsert( uint32_t key, int len, int flag ) {
+	int n = 0;
+
+	key &= SV_BanTrieMask( len );
+
+	// the prefix of node n always matches key and is shorter than len
+	while ( banNodes[n].len != len ) {
+		const int bit = SV_BanTrieBit( key, banNodes[n].len );
+		const int c = banNodes[n].child[bit];
+		int common, split;
+
+		if ( c < 0 ) {
+			const int leaf = SV_AllocBanNode( key, len, flag );
+			banNodes[n].child[bit] = leaf;
+			return;
+		}
+
+		common = SV_BanTrieCommonLength( key, banNodes[c].key, Q_min( len, (int)banNodes[c].len ) );
+		if ( common == banNodes[c].len ) {
+			n = c;
+			continue;
+		}
+
+		// the new prefix ends or branches off half way down the edge to c
+		if ( common == len ) {
+			split = SV_AllocBanNode( key, len, flag );
+		} else {
+			const int leaf = SV_AllocBanNode( key, len, flag );
+			split = SV_AllocBanNode( key & SV_BanTrieMask( common ), common, 0 );
+			banNodes[split].child[SV_BanTrieBit( key, common )] = leaf;
+		}
+		banNodes[split].child[SV_BanTrieBit( banNodes[c].key, common )] = c;
+		banNodes[n].child[bit] = split;
+		return;
+	}
+
+	banNodes[n].flags |= flag;
+}
+
+/*
+==================
+SV_BanTrieFlags
+
+Collects the flags of every prefix of key that is at most maxLen long.
+==================
+*/
+static int SV_BanTrieFlags( uint32_t key, int maxLen ) {
+	int n = 0, flags = 0;
+
+	if ( !banNodeCount ) {
+		return 0;
+	}
+
+	while ( n >= 0 ) {
+		const banNode_t *node = &banNodes[n];
+
+		if ( node->len > maxLen || ((key ^ node->key) & SV_BanTrieMask( node->len )) ) {
+			break;
+		}
+		flags |= node->flags;
+
+		if ( node->len == 32 ) {
+			break;
+		}
+		n = node->child[SV_BanTrieBit( key, node->len )];
+	}
+
+	return flags;
+}
+
+/*
+==================
+SV_RebuildBanTrie
+
+Call after serverBans was changed.
+==================
+*/
+void SV_RebuildBanTrie( void ) {
+	int i;
+
+	banNodeCount = 0;
+	SV_AllocBanNode( 0, 0, 0 );
+
+	for ( i = 0; i < serverBansCount; i++ ) {
+		const serverBan_t *ban = &serverBans[i];
+
+		if ( ban->ip.type == NA_IP ) {
+			SV_BanTrieInsert( SV_BanTrieKey( &ban->ip ), ban->subnet, ban->isexception ? BANTRIE_EXCEPTION : BANTRIE_BAN );
+		}
+	}
+}
+
+/*
+==================
+SV_BanTrieAdd
+
+Adds an entry that was just appended to serverBans without a rebuild.
+==================
+*/
+void SV_BanTrieAdd( const netadr_t *adr, int subnet, qboolean isexception ) {
+	if ( !banNodeCount ) {
+		SV_RebuildBanTrie();
+		return;
+	}
+	SV_BanTrieInsert( SV_BanTrieKey( adr ), subnet, isexception ? BANTRIE_EXCEPTION : BANTRIE_BAN );
+}
+
+/*
+==================
+SV_BanTrieMatch
+
+Whether an IPv4 address is covered by a ban or, with isexception, by an
+exception.
+==================
+*/
+qboolean SV_BanTrieMatch( const netadr_t *adr, qboolean isexception ) {
+	const int flags = SV_BanTrieFlags( SV_BanTrieKey( adr ), 32 );
+
+	return (flags & (isexception ? BANTRIE_EXCEPTION : BANTRIE_BAN)) ? qtrue : qfalse;
+}
+
+/*
+==================
+SV_BanTrieCovers
+
+Whether a ban, or with isexception an exception, on adr/subnet would change
+nothing because a shorter or equal prefix already has one. A new ban is also
+covered by an exception, which would win anyway.
+==================
+*/
+qboolean SV_BanTrieCovers( const netadr_t *adr, int subnet, qboolean isexception ) {
+	const int flags = SV_BanTrieFlags( SV_BanTrieKey( adr ), subnet );
+
+	if ( isexception ) {
+		return (flags & BANTRIE_EXCEPTION) ? qtrue : qfalse;
+	}
+	return flags ? qtrue : qfalse;
+}
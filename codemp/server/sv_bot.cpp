@@ -753,7 +753,7 @@ SV_BotGetConsoleMessage
 int SV_BotGetConsoleMessage( int client, char *buf, int size )
 {
 	client_t	*cl;
-	int			index;
+	const char	*command;
 
 	cl = &svs.clients[client];
 	cl->lastPacketTime = svs.time;
@@ -763,13 +763,13 @@ int SV_BotGetConsoleMessage( int client, char *buf, int size )
 	}
 
 	cl->reliableAcknowledge++;
-	index = cl->reliableAcknowledge & ( MAX_RELIABLE_COMMANDS - 1 );
+	command = SV_ReliableCommand( cl, cl->reliableAcknowledge );
 
-	if ( !cl->reliableCommands[index][0] ) {
+	if ( !command[0] ) {
 		return qfalse;
 	}
 
-	Q_strncpyz( buf, cl->reliableCommands[index], size );
+	Q_strncpyz( buf, command, size );
 	return qtrue;
 }
 
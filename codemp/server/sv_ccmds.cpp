@@ -592,6 +592,7 @@ static void SV_RehashBans_f( void )
 	}
 
 	serverBansCount = 0;
+	SV_RebuildBanTrie();
 
 	if ( !sv_banFile->string || !*sv_banFile->string )
 		return;
@@ -649,6 +650,7 @@ static void SV_RehashBans_f( void )
 		}
 
 		serverBansCount = index;
+		SV_RebuildBanTrie();
 
 		Z_Free( textbuf );
 	}
@@ -889,6 +891,7 @@ static void SV_AddBanToList( qboolean isexception )
 
 	serverBansCount++;
 
+	SV_RebuildBanTrie();
 	SV_WriteBans();
 
 	Com_Printf( "Added %s: %s/%d\n", isexception ? "ban exception" : "ban",
@@ -983,6 +986,7 @@ static void SV_DelBanFromList( qboolean isexception )
 		}
 	}
 
+	SV_RebuildBanTrie();
 	SV_WriteBans();
 }
 
@@ -1049,6 +1053,7 @@ static void SV_FlushBans_f( void )
 	}
 
 	serverBansCount = 0;
+	SV_RebuildBanTrie();
 
 	// empty the ban file.
 	SV_WriteBans();
@@ -1056,6 +1061,117 @@ static void SV_FlushBans_f( void )
 	Com_Printf( "All bans and exceptions have been deleted.\n" );
 }
 
+/*
+==================
+SV_ImportBans_f
+
+Adds a list of addresses, one ip[/subnet] per line, as bans or exceptions.
+Anything after a '#' or ';' is a comment, which covers the usual published
+block lists. Entries an existing one already covers are skipped, entries
+the new ones cover are kept; unlike sv_banaddr this doesn't look at every
+other entry for each line, so lists of thousands import in one go.
+==================
+*/
+
+static void SV_ImportBans_f( void )
+{
+	int filelen, added = 0, covered = 0, invalid = 0, dropped = 0;
+	qboolean isexception;
+	fileHandle_t readfrom;
+	char *textbuf, *line, *next;
+	char filepath[MAX_QPATH];
+
+	// make sure server is running
+	if ( !com_sv_running->integer ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	if ( Cmd_Argc() < 2 || Cmd_Argc() > 3 ||
+		(Cmd_Argc() == 3 && Q_stricmp( Cmd_Argv( 2 ), "ban" ) && Q_stricmp( Cmd_Argv( 2 ), "except" )) )
+	{
+		Com_Printf( "Usage: %s <file> [ban | except]\n", Cmd_Argv( 0 ) );
+		return;
+	}
+
+	isexception = (qboolean)(Cmd_Argc() == 3 && !Q_stricmp( Cmd_Argv( 2 ), "except" ));
+
+	Com_sprintf( filepath, sizeof( filepath ), "%s/%s", FS_GetCurrentGameDir(), Cmd_Argv( 1 ) );
+
+	filelen = FS_SV_FOpenFileRead( filepath, &readfrom );
+	if ( !readfrom )
+	{
+		Com_Printf( "Error: Couldn't open %s\n", filepath );
+		return;
+	}
+
+	textbuf = (char *)Z_Malloc( filelen + 1, TAG_TEMP_WORKSPACE );
+	filelen = FS_Read( textbuf, filelen, readfrom );
+	FS_FCloseFile( readfrom );
+	textbuf[filelen] = '\0';
+
+	for ( line = textbuf; line; line = next )
+	{
+		char *token, *end;
+		netadr_t ip;
+		int mask;
+
+		next = strchr( line, '\n' );
+		if ( next )
+			*next++ = '\0';
+
+		end = strpbrk( line, "#;" );
+		if ( end )
+			*end = '\0';
+
+		for ( token = line; *token == ' ' || *token == '\t'; token++ );
+		for ( end = token; *end && *end != ' ' && *end != '\t' && *end != '\r'; end++ );
+		*end = '\0';
+
+		if ( !*token )
+			continue;
+
+		// numbers only, a host name would be looked up for every line
+		if ( strspn( token, "0123456789./" ) != strlen( token ) || !strchr( token, '.' ) ||
+			SV_ParseCIDRNotation( &ip, &mask, token ) || ip.type != NA_IP )
+		{
+			invalid++;
+			continue;
+		}
+
+		if ( SV_BanTrieCovers( &ip, mask, isexception ) )
+		{
+			covered++;
+			continue;
+		}
+
+		if ( serverBansCount >= (int)ARRAY_LEN( serverBans ) )
+		{
+			dropped++;
+			continue;
+		}
+
+		serverBans[serverBansCount].ip = ip;
+		serverBans[serverBansCount].subnet = mask;
+		serverBans[serverBansCount].isexception = isexception;
+		serverBansCount++;
+
+		SV_BanTrieAdd( &ip, mask, isexception );
+		added++;
+	}
+
+	Z_Free( textbuf );
+
+	if ( added )
+		SV_WriteBans();
+
+	Com_Printf( "Imported %d %s from %s, %d already covered, %d invalid\n",
+		added, isexception ? "exceptions" : "bans", filepath, covered, invalid );
+	if ( dropped )
+		Com_Printf( "Error: Maximum number of bans/exceptions exceeded, %d were left out.\n", dropped );
+}
+
+
 static void SV_BanAddr_f( void )
 {
 	SV_AddBanToList( qfalse );
@@ -1611,34 +1727,22 @@ static void SV_KillServer_f( void ) {
 }
 
 void SV_WriteDemoMessage ( client_t *cl, msg_t *msg, int headerBytes ) {
-	int		len, swlen;
-
-	// write the packet sequence
-	len = cl->netchan.outgoingSequence;
-	swlen = LittleLong( len );
-	FS_Write( &swlen, 4, cl->demo.demofile );
-
 	// skip the packet sequencing information
-	len = msg->cursize - headerBytes;
-	swlen = LittleLong( len );
-	FS_Write( &swlen, 4, cl->demo.demofile );
-	FS_Write( msg->data + headerBytes, len, cl->demo.demofile );
+	if ( !SV_DemoWriter_Write( cl->demo.demoStream, cl->netchan.outgoingSequence, msg->data + headerBytes, msg->cursize - headerBytes ) ) {
+		SV_StopRecordDemo( cl );
+	}
 }
 
 void SV_StopRecordDemo( client_t *cl ) {
-	int		len;
-
 	if ( !cl->demo.demorecording ) {
 		Com_Printf( "Client %d is not recording a demo.\n", cl - svs.clients );
 		return;
 	}
 
 	// finish up
-	len = -1;
-	FS_Write (&len, 4, cl->demo.demofile);
-	FS_Write (&len, 4, cl->demo.demofile);
-	FS_FCloseFile (cl->demo.demofile);
-	cl->demo.demofile = 0;
+	SV_DemoWriter_Write( cl->demo.demoStream, -1, NULL, -1 );
+	SV_DemoWriter_Close( cl->demo.demoStream );
+	cl->demo.demoStream = -1;
 	cl->demo.demorecording = qfalse;
 	Com_Printf ("Stopped demo for client %d.\n", cl - svs.clients);
 }
@@ -1705,11 +1809,10 @@ void SV_DemoFilename( char *buf, int bufSize ) {
 // defined in sv_client.cpp
 extern void SV_CreateClientGameStateMessage( client_t *client, msg_t* msg );
 
-void SV_RecordDemo( client_t *cl, char *demoName ) {
+void SV_RecordDemo( client_t *cl, char *demoName, int compression ) {
 	char		name[MAX_OSPATH];
 	byte		bufData[MAX_MSGLEN];
 	msg_t		msg;
-	int			len;
 
 	if ( cl->demo.demorecording ) {
 		Com_Printf( "Already recording.\n" );
@@ -1723,10 +1826,10 @@ void SV_RecordDemo( client_t *cl, char *demoName ) {
 
 	// open the demo file
 	Q_strncpyz( cl->demo.demoName, demoName, sizeof( cl->demo.demoName ) );
-	Com_sprintf( name, sizeof( name ), "demos/%s.dm_%d", cl->demo.demoName, PROTOCOL_VERSION );
+	Com_sprintf( name, sizeof( name ), "demos/%s.%s_%d", cl->demo.demoName, compression ? "dmz" : "dm", PROTOCOL_VERSION );
 	Com_Printf( "recording to %s.\n", name );
-	cl->demo.demofile = FS_FOpenFileWrite( name );
-	if ( !cl->demo.demofile ) {
+	cl->demo.demoStream = SV_DemoWriter_Open( name, cl - svs.clients, compression );
+	if ( cl->demo.demoStream < 0 ) {
 		Com_Printf ("ERROR: couldn't open.\n");
 		return;
 	}
@@ -1750,12 +1853,7 @@ void SV_RecordDemo( client_t *cl, char *demoName ) {
 	MSG_WriteByte( &msg, svc_EOF );
 
 	// write it to the demo file
-	len = LittleLong( cl->netchan.outgoingSequence - 1 );
-	FS_Write( &len, 4, cl->demo.demofile );
-
-	len = LittleLong( msg.cursize );
-	FS_Write( &len, 4, cl->demo.demofile );
-	FS_Write( msg.data, msg.cursize, cl->demo.demofile );
+	SV_DemoWriter_Write( cl->demo.demoStream, cl->netchan.outgoingSequence - 1, msg.data, msg.cursize );
 
 	// the rest of the demo file will be copied from net messages
 }
@@ -1787,7 +1885,7 @@ void SV_AutoRecordDemo( client_t *cl ) {
 		Q_strstrip( *start, "\n\r;:.?*<>|\\/\"", NULL );
 	}
 	Com_sprintf( demoName, sizeof( demoName ), "autorecord/%s/%s/%s", folderTreeDate, demoFolderName, demoFileName );
-	SV_RecordDemo( cl, demoName );
+	SV_RecordDemo( cl, demoName, Com_Clampi( 0, 9, sv_autoDemoCompress->integer ) );
 }
 
 static time_t SV_ExtractTimeFromDemoFolder( char *folder ) {
@@ -1866,6 +1964,33 @@ static int SV_FindLeafFolders( const char *baseFolder, char *result, int maxResu
 	return resultCount;
 }
 
+static void SV_RemoveAutoRecordFolder( char *folder ) {
+	char tmpFileList[5 * MAX_OSPATH], *slash = NULL;
+
+	FS_HomeRmdir( folder, qtrue );
+	// if this folder was the last thing in its parent folder (and its parent isn't the root folder),
+	// also delete the parent.
+	for (;;) {
+		slash = strrchr( folder, '/' );
+		if ( slash == NULL ) {
+			break;
+		}
+		slash[0] = '\0';
+		if ( !strcmp( folder, "demos/autorecord" ) ) {
+			break;
+		}
+		int numFiles = FS_GetFileList( folder, "", tmpFileList, sizeof( tmpFileList ) );
+		int numFolders = FS_GetFileList( folder, "/", tmpFileList, sizeof( tmpFileList ) );
+		// numFolders will include . and ..
+		if ( numFiles == 0 && numFolders == 2 ) {
+			// dangling empty folder, delete
+			FS_HomeRmdir( folder, qfalse );
+		} else {
+			break;
+		}
+	}
+}
+
 // starts demo recording on all active clients
 void SV_BeginAutoRecordDemos() {
 	if ( sv_autoDemo->integer ) {
@@ -1876,35 +2001,27 @@ void SV_BeginAutoRecordDemos() {
 				}
 			}
 		}
-		if ( sv_autoDemoMaxMaps->integer > 0 && sv.demosPruned == qfalse ) {
-			char autorecordDirList[500 * MAX_OSPATH], tmpFileList[5 * MAX_OSPATH];
+		if ( (sv_autoDemoMaxMaps->integer > 0 || sv_autoDemoMaxMB->integer > 0) && sv.demosPruned == qfalse ) {
+			char autorecordDirList[500 * MAX_OSPATH];
 			int autorecordDirListCount = SV_FindLeafFolders( "demos/autorecord", autorecordDirList, 500, MAX_OSPATH );
+			int64_t budget = (int64_t)sv_autoDemoMaxMB->integer * 1024 * 1024;
+			int64_t total = 0;
 			int i;
 
 			qsort( autorecordDirList, autorecordDirListCount, MAX_OSPATH, SV_DemoFolderTimeComparator );
-			for ( i = sv_autoDemoMaxMaps->integer; i < autorecordDirListCount; i++ ) {
-				char *folder = &autorecordDirList[i * MAX_OSPATH], *slash = NULL;
-				FS_HomeRmdir( folder, qtrue );
-				// if this folder was the last thing in its parent folder (and its parent isn't the root folder),
-				// also delete the parent.
-				for (;;) {
-					slash = strrchr( folder, '/' );
-					if ( slash == NULL ) {
-						break;
-					}
-					slash[0] = '\0';
-					if ( !strcmp( folder, "demos/autorecord" ) ) {
-						break;
-					}
-					int numFiles = FS_GetFileList( folder, "", tmpFileList, sizeof( tmpFileList ) );
-					int numFolders = FS_GetFileList( folder, "/", tmpFileList, sizeof( tmpFileList ) );
-					// numFolders will include . and ..
-					if ( numFiles == 0 && numFolders == 2 ) {
-						// dangling empty folder, delete
-						FS_HomeRmdir( folder, qfalse );
-					} else {
-						break;
-					}
+			// newest first, the current map is never removed
+			if ( budget > 0 && autorecordDirListCount > 0 ) {
+				total = FS_HomeFolderSize( autorecordDirList );
+			}
+			for ( i = 1; i < autorecordDirListCount; i++ ) {
+				char *folder = &autorecordDirList[i * MAX_OSPATH];
+
+				if ( budget > 0 ) {
+					total += FS_HomeFolderSize( folder );
+				}
+
+				if ( (sv_autoDemoMaxMaps->integer > 0 && i >= sv_autoDemoMaxMaps->integer) || (budget > 0 && total > budget) ) {
+					SV_RemoveAutoRecordFolder( folder );
 				}
 			}
 			sv.demosPruned = qtrue;
@@ -1989,7 +2106,7 @@ static void SV_Record_f( void ) {
  		}
 	}
 
-	SV_RecordDemo( cl, demoName );
+	SV_RecordDemo( cl, demoName, 0 );
 }
 
 /*
@@ -2070,6 +2187,9 @@ void SV_AddOperatorCommands( void ) {
 	Cmd_AddCommand ("weapontoggle", SV_WeaponToggle_f, "Toggle g_weaponDisable bits" );
 	Cmd_AddCommand ("svrecord", SV_Record_f, "Record a server-side demo" );
 	Cmd_AddCommand ("svstoprecord", SV_StopRecord_f, "Stop recording a server-side demo" );
+	Cmd_AddCommand ("svdemostatus", SV_DemoWriterStatus_f, "Shows how far behind writing server-side demos is" );
+	Cmd_AddCommand ("svdemoconvert", SV_DemoConvert_f, "Converts a compressed server-side demo to a plain one" );
+	Cmd_AddCommand ("svdeltacache", SV_DeltaCacheStatus_f, "Shows how often entity deltas were shared between clients" );
 	Cmd_AddCommand ("sv_rehashbans", SV_RehashBans_f, "Reloads banlist from file" );
 	Cmd_AddCommand ("sv_listbans", SV_ListBans_f, "Lists bans" );
 	Cmd_AddCommand ("sv_banaddr", SV_BanAddr_f, "Bans a user" );
@@ -2077,6 +2197,7 @@ void SV_AddOperatorCommands( void ) {
 	Cmd_AddCommand ("sv_bandel", SV_BanDel_f, "Removes a ban" );
 	Cmd_AddCommand ("sv_exceptdel", SV_ExceptDel_f, "Removes a ban exception" );
 	Cmd_AddCommand ("sv_flushbans", SV_FlushBans_f, "Removes all bans and exceptions" );
+	Cmd_AddCommand ("sv_banimport", SV_ImportBans_f, "Adds bans or exceptions from a file of ip[/subnet] lines" );
 	Cmd_AddCommand ("whitelistip", SV_WhitelistIP_f, "Add IP to the whitelist" );
 }
 
@@ -107,6 +107,9 @@ static qboolean SV_IsBanned( netadr_t *from, qboolean isexception )
 			return qfalse;
 	}
 
+	if ( from->type == NA_IP )
+		return SV_BanTrieMatch( from, isexception );
+
 	for ( index = 0; index < serverBansCount; index++ )
 	{
 		curban = &serverBans[index];
@@ -301,6 +304,7 @@ gotnewcl:
 	// build a new connection
 	// accept the new client
 	// this is the only place a client_t is ever initialized
+	SV_ClearReliableCommands( newcl );
 	*newcl = temp;
 	clientNum = newcl - svs.clients;
 	ent = SV_GentityNum( clientNum );
@@ -350,6 +354,8 @@ gotnewcl:
 	newcl->lastPacketTime = svs.time;
 	newcl->lastConnectTime = svs.time;
 
+	SV_LogClientEvent( newcl, LOGEVENT_CONNECT, NULL );
+
 	// when we receive the first packet from the client, we will
 	// notice that it is from a different serverid and that the
 	// gamestate message was not just sent, forcing a retransmit
@@ -405,6 +411,8 @@ void SV_DropClient( client_t *drop, const char *reason ) {
 	// tell everyone why they got dropped
 	SV_SendServerCommand( NULL, "print \"%s" S_COLOR_WHITE " %s\n\"", drop->name, reason );
 
+	SV_LogClientEvent( drop, LOGEVENT_DISCONNECT, reason );
+
 	// call the prog function for removing a client
 	// this will remove the body, among other things
 	GVM_ClientDisconnect( drop - svs.clients );
@@ -1486,6 +1494,8 @@ static void SV_UpdateUserinfo_f( client_t *cl ) {
 	SV_UserinfoChanged( cl );
 	// call prog code to allow overrides
 	GVM_ClientUserinfoChanged( cl - svs.clients );
+
+	SV_LogClientEvent( cl, LOGEVENT_USERINFO, NULL );
 }
 
 typedef struct ucmd_s {
@@ -1718,6 +1728,8 @@ void SV_ClientThink (client_t *cl, usercmd_t *cmd) {
 		Info_SetValueForKey(cl->userinfo, "name", Info_ValueForKey(info, "n"));
 		Q_strncpyz(cl->name, Info_ValueForKey(info, "n"), sizeof(cl->name));
 
+		SV_LogClientEvent( cl, LOGEVENT_USERINFO, NULL );
+
 		// clear it
 		cl->userinfoPostponed[0] = 0;
 		cl->lastUserInfoCount = 0;
@@ -1789,7 +1801,7 @@ static void SV_UserMove( client_t *cl, msg_t *msg, qboolean delta ) {
 	// also use the message acknowledge
 	key ^= cl->messageAcknowledge;
 	// also use the last acknowledged server command in the key
-	key ^= Com_HashKey(cl->reliableCommands[ cl->reliableAcknowledge & (MAX_RELIABLE_COMMANDS-1) ], 32);
+	key ^= Com_HashKey((char *)SV_ReliableCommand( cl, cl->reliableAcknowledge ), 32);
 
 	Com_Memset( &nullcmd, 0, sizeof(nullcmd) );
 	oldcmd = &nullcmd;
@@ -0,0 +1,801 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// sv_demowriter.cpp -- writes server side demos from a background thread
+//
+// Every recording demo gets a stream with its own queue of sv_demoBufferSize
+// kilobytes. SV_WriteDemoMessage only copies the message into the queue, a
+// writer thread collects what is queued for each stream and writes it with
+// one fwrite. The files are opened on the main thread but written and closed
+// by the writer only, so they don't take up one of the filesystem handles.
+//
+// The frame never waits for the writer. If a queue fills up, the disk can't
+// keep up and that demo is stopped with a warning and counted as a stall,
+// the server and the other demos go on. svdemostatus shows queue use, stalls
+// and how long messages sat in the queue before they were written.
+//
+// Autorecorded demos can be compressed with sv_autoDemoCompress. The writer
+// collects whole messages into blocks of up to DW_BLOCK_SIZE and deflates
+// every block on its own, so any block can be read without the ones before
+// it. The .dmz file looks like this, all ints little endian:
+//
+//   header   "JKDZ", version, protocol
+//   block    raw length, packed length, sequence of its first message,
+//            packed data
+//   ...
+//   index    "JKDI", block count, then offset, raw length, packed length and
+//            first sequence of every block
+//   trailer  offset of the index, "JKDE"
+//
+// A demo that was never closed has no index, svdemoconvert finds the blocks
+// by walking the headers instead.
+
+#include "server.h"
+#include "qcommon/ringbuffer.h"
+
+#ifdef USE_INTERNAL_ZLIB
+#include "zlib/zlib.h"
+#else
+#include <zlib.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a stream can still be finishing while the client's next demo starts
+#define DW_MAX_STREAMS		(MAX_CLIENTS * 2)
+#define DW_BLOCK_SIZE		(64 * 1024)	// more than MAX_MSGLEN, every message fits a block
+#define DW_FLUSH_MSEC		100
+
+#define DEMOZ_VERSION		1
+#define DEMOZ_HEADER		('J' | 'K' << 8 | 'D' << 16 | 'Z' << 24)
+#define DEMOZ_INDEX			('J' | 'K' << 8 | 'D' << 16 | 'I' << 24)
+#define DEMOZ_END			('J' | 'K' << 8 | 'D' << 16 | 'E' << 24)
+
+typedef struct demoBlock_s {
+	int		offset;
+	int		rawLen;
+	int		packedLen;
+	int		firstSequence;
+} demoBlock_t;
+
+typedef enum {
+	DS_FREE,
+	DS_RECORDING,		// written to by the main thread
+	DS_CLOSING,			// the writer closes the file once the queue is empty
+	DS_CLOSED			// the main thread can free the queue
+} demoStreamState_t;
+
+typedef struct demoStream_s {
+	std::atomic<int>	state;
+	FILE				*file;
+	byteRing_t			ring;
+	byte				*queue;
+	char				name[MAX_QPATH];
+	int					client;
+	int					compression;	// zlib level, 0 writes a plain demo
+	qboolean			failed;			// stopped because the queue stayed full
+
+	// only used by the writer
+	byte				*block;			// messages not written yet, DW_BLOCK_SIZE
+	int					blockLen;
+	int					blockMessages;
+	int					blockOldest;
+	int64_t				blockQueued;
+	int					fileOffset;
+	std::vector<demoBlock_t>	index;
+
+	// main thread accounting
+	uint32_t			peakQueued;
+	int					stalls;
+
+	// writer accounting
+	std::atomic<int64_t>	raw;			// demo bytes written, before compression
+	std::atomic<int64_t>	written;
+	std::atomic<int64_t>	latencyTotal;	// msec, summed over all messages
+	std::atomic<int>		latencyMax;
+	std::atomic<int>		messages;
+	std::atomic<bool>		writeError;
+} demoStream_t;
+
+static cvar_t					*sv_demoBufferSize;
+
+static demoStream_t				dw_streams[DW_MAX_STREAMS];
+static byte						dw_packed[DW_BLOCK_SIZE + DW_BLOCK_SIZE / 1000 + 64];	// compressBound
+
+static std::thread				*dw_thread;
+static std::mutex				dw_wakeLock;
+static std::condition_variable	dw_wake;
+static std::atomic<bool>		dw_running( false );
+
+static int DemoWriter_Milliseconds( void ) {
+	static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	return (int)std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start ).count();
+}
+
+/*
+=============================================================================
+
+WRITER THREAD
+
+Nothing in here may call Com_Printf or touch the zone.
+
+=============================================================================
+*/
+
+static void DemoWriter_WriteOut( demoStream_t *ds, const void *data, size_t len ) {
+	const byte *p = (const byte *)data;
+
+	if ( ds->writeError ) {
+		return;
+	}
+
+	while ( len ) {
+		const size_t written = fwrite( p, 1, len, ds->file );
+
+		if ( !written ) {
+			ds->writeError = true;
+			return;
+		}
+		p += written;
+		len -= written;
+		ds->written += written;
+		ds->fileOffset += written;
+	}
+}
+
+static void DemoWriter_WriteInt( demoStream_t *ds, int value ) {
+	value = LittleLong( value );
+	DemoWriter_WriteOut( ds, &value, 4 );
+}
+
+/*
+==================
+DemoWriter_FlushBlock
+
+Writes out the messages collected in the block, compressed or not.
+==================
+*/
+static void DemoWriter_FlushBlock( demoStream_t *ds ) {
+	if ( !ds->blockMessages ) {
+		return;
+	}
+
+	if ( ds->compression ) {
+		demoBlock_t block;
+		uLongf packedLen = sizeof( dw_packed );
+
+		if ( compress2( dw_packed, &packedLen, ds->block, ds->blockLen, ds->compression ) != Z_OK ) {
+			ds->writeError = true;
+		}
+
+		block.offset = ds->fileOffset;
+		block.rawLen = ds->blockLen;
+		block.packedLen = (int)packedLen;
+		block.firstSequence = LittleLong( *(int *)ds->block );
+		ds->index.push_back( block );
+
+		DemoWriter_WriteInt( ds, block.rawLen );
+		DemoWriter_WriteInt( ds, block.packedLen );
+		DemoWriter_WriteInt( ds, block.firstSequence );
+		DemoWriter_WriteOut( ds, dw_packed, packedLen );
+	} else {
+		DemoWriter_WriteOut( ds, ds->block, ds->blockLen );
+	}
+	ds->raw += ds->blockLen;
+
+	const int now = DemoWriter_Milliseconds();
+	ds->latencyTotal += (int64_t)now * ds->blockMessages - ds->blockQueued;
+	ds->messages += ds->blockMessages;
+	if ( now - ds->blockOldest > ds->latencyMax ) {
+		ds->latencyMax = now - ds->blockOldest;
+	}
+
+	ds->blockLen = 0;
+	ds->blockMessages = 0;
+	ds->blockQueued = 0;
+}
+
+/*
+==================
+DemoWriter_Drain
+
+Moves everything queued for a stream into its block. Every record is the
+time it was queued followed by the demo data. Plain demos are written right
+away, compressed ones once the block is full.
+==================
+*/
+static void DemoWriter_Drain( demoStream_t *ds ) {
+	const byte *data;
+	uint32_t len;
+	int tag;
+
+	while ( (data = Ring_Peek( &ds->ring, &len, &tag )) != NULL ) {
+		const int queued = *(const int *)data;
+		const uint32_t demoLen = len - 4;
+
+		if ( ds->blockLen + demoLen > DW_BLOCK_SIZE ) {
+			DemoWriter_FlushBlock( ds );
+		}
+
+		memcpy( ds->block + ds->blockLen, data + 4, demoLen );
+		ds->blockLen += demoLen;
+		if ( !ds->blockMessages ) {
+			ds->blockOldest = queued;
+		}
+		ds->blockQueued += queued;
+		ds->blockMessages++;
+		Ring_Consume( &ds->ring, len );
+	}
+
+	if ( !ds->compression ) {
+		DemoWriter_FlushBlock( ds );
+	}
+}
+
+static void DemoWriter_Finish( demoStream_t *ds ) {
+	DemoWriter_FlushBlock( ds );
+
+	if ( ds->compression ) {
+		const int indexOffset = ds->fileOffset;
+
+		DemoWriter_WriteInt( ds, DEMOZ_INDEX );
+		DemoWriter_WriteInt( ds, (int)ds->index.size() );
+		for ( size_t i = 0; i < ds->index.size(); i++ ) {
+			DemoWriter_WriteInt( ds, ds->index[i].offset );
+			DemoWriter_WriteInt( ds, ds->index[i].rawLen );
+			DemoWriter_WriteInt( ds, ds->index[i].packedLen );
+			DemoWriter_WriteInt( ds, ds->index[i].firstSequence );
+		}
+		DemoWriter_WriteInt( ds, indexOffset );
+		DemoWriter_WriteInt( ds, DEMOZ_END );
+	}
+
+	std::vector<demoBlock_t>().swap( ds->index );
+	fclose( ds->file );
+	ds->file = NULL;
+}
+
+static void DemoWriter_ThreadMain( void ) {
+	while ( dw_running ) {
+		{
+			std::unique_lock<std::mutex> lock( dw_wakeLock );
+			dw_wake.wait_for( lock, std::chrono::milliseconds( DW_FLUSH_MSEC ) );
+		}
+
+		for ( int i = 0; i < DW_MAX_STREAMS; i++ ) {
+			demoStream_t *ds = &dw_streams[i];
+			// checked before draining so nothing queued before the close is missed
+			const int state = ds->state.load( std::memory_order_acquire );
+
+			if ( state != DS_RECORDING && state != DS_CLOSING ) {
+				continue;
+			}
+
+			DemoWriter_Drain( ds );
+
+			if ( state == DS_CLOSING ) {
+				DemoWriter_Finish( ds );
+				ds->state.store( DS_CLOSED, std::memory_order_release );
+			}
+		}
+	}
+}
+
+/*
+=============================================================================
+
+MAIN THREAD INTERFACE
+
+=============================================================================
+*/
+
+/*
+==================
+SV_DemoWriter_Reclaim
+
+Frees the queues of streams the writer is done with.
+==================
+*/
+static void SV_DemoWriter_Reclaim( void ) {
+	for ( int i = 0; i < DW_MAX_STREAMS; i++ ) {
+		demoStream_t *ds = &dw_streams[i];
+
+		if ( ds->state.load( std::memory_order_acquire ) != DS_CLOSED ) {
+			continue;
+		}
+
+		if ( ds->writeError ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: demo %s is incomplete, writing it failed\n", ds->name );
+		}
+
+		Z_Free( ds->queue );
+		Z_Free( ds->block );
+		ds->queue = NULL;
+		ds->block = NULL;
+		ds->state = DS_FREE;
+	}
+}
+
+/*
+==================
+SV_DemoWriter_Open
+
+Opens a demo file for writing, returns the stream or -1. With a compression
+level the file is written as a .dmz.
+==================
+*/
+int SV_DemoWriter_Open( const char *qpath, int client, int compression ) {
+	demoStream_t *ds = NULL;
+	uint32_t size;
+	int i;
+
+	SV_DemoWriter_Reclaim();
+
+	for ( i = 0; i < DW_MAX_STREAMS; i++ ) {
+		if ( dw_streams[i].state == DS_FREE ) {
+			ds = &dw_streams[i];
+			break;
+		}
+	}
+
+	if ( !ds ) {
+		Com_Printf( "Too many demos being written.\n" );
+		return -1;
+	}
+
+	ds->file = FS_FOpenFileWriteRaw( qpath );
+	if ( !ds->file ) {
+		return -1;
+	}
+
+	if ( sv_demoBufferSize->modified ) {
+		Cvar_CheckRange( sv_demoBufferSize, 128, 8192, qtrue );
+		sv_demoBufferSize->modified = qfalse;
+	}
+
+	// the queue has to be a power of two, and at least twice MAX_MSGLEN so a
+	// message always fits once it is empty
+	for ( size = 128 * 1024; size < (uint32_t)sv_demoBufferSize->integer * 1024; size <<= 1 ) {
+	}
+
+	ds->queue = (byte *)Z_Malloc( size, TAG_CLIENTS, qfalse );
+	ds->block = (byte *)Z_Malloc( DW_BLOCK_SIZE, TAG_CLIENTS, qfalse );
+	Ring_Init( &ds->ring, ds->queue, size );
+	Q_strncpyz( ds->name, qpath, sizeof( ds->name ) );
+	ds->client = client;
+	ds->compression = compression;
+	ds->blockLen = 0;
+	ds->blockMessages = 0;
+	ds->blockQueued = 0;
+	ds->fileOffset = 0;
+	ds->failed = qfalse;
+	ds->peakQueued = 0;
+	ds->stalls = 0;
+	ds->raw = 0;
+	ds->written = 0;
+	ds->latencyTotal = 0;
+	ds->latencyMax = 0;
+	ds->messages = 0;
+	ds->writeError = false;
+
+	if ( compression ) {
+		const int header[3] = { LittleLong( DEMOZ_HEADER ), LittleLong( DEMOZ_VERSION ), LittleLong( PROTOCOL_VERSION ) };
+
+		fwrite( header, sizeof( header ), 1, ds->file );
+		ds->fileOffset = sizeof( header );
+		ds->written = sizeof( header );
+	}
+
+	if ( !dw_thread ) {
+		dw_running = true;
+		dw_thread = new std::thread( DemoWriter_ThreadMain );
+	}
+
+	ds->state.store( DS_RECORDING, std::memory_order_release );
+	return ds - dw_streams;
+}
+
+/*
+==================
+SV_DemoWriter_Write
+
+Queues one demo message: the sequence, the length and the data. A length of
+-1 without data ends the demo. Returns qfalse if the queue was full and the
+message was dropped, the demo is useless from then on and should be stopped.
+Never waits for the writer, that would hold up the whole frame.
+==================
+*/
+qboolean SV_DemoWriter_Write( int stream, int sequence, const void *data, int len ) {
+	demoStream_t *ds = &dw_streams[stream];
+	const int demoLen = 8 + (len > 0 ? len : 0);
+	int *dest;
+
+	if ( ds->failed ) {
+		return qfalse;
+	}
+
+	dest = (int *)Ring_Reserve( &ds->ring, 4 + demoLen );
+
+	if ( !dest ) {
+		ds->stalls++;
+		ds->failed = qtrue;
+		dw_wake.notify_one();
+		Com_Printf( S_COLOR_YELLOW "WARNING: demo writer can't keep up, stopping %s\n", ds->name );
+		return qfalse;
+	}
+
+	dest[0] = DemoWriter_Milliseconds();
+	dest[1] = LittleLong( sequence );
+	dest[2] = LittleLong( len );
+	if ( len > 0 ) {
+		memcpy( dest + 3, data, len );
+	}
+	Ring_Commit( &ds->ring, 4 + demoLen, 0 );
+
+	if ( Ring_Used( &ds->ring ) > ds->peakQueued ) {
+		ds->peakQueued = Ring_Used( &ds->ring );
+	}
+
+	if ( Ring_Used( &ds->ring ) > ds->ring.size / 2 ) {
+		dw_wake.notify_one();
+	}
+	return qtrue;
+}
+
+/*
+==================
+SV_DemoWriter_Close
+
+The writer closes the file once everything queued is written.
+==================
+*/
+void SV_DemoWriter_Close( int stream ) {
+	dw_streams[stream].state.store( DS_CLOSING, std::memory_order_release );
+	dw_wake.notify_one();
+}
+
+/*
+==================
+SV_DemoWriterStatus_f
+==================
+*/
+void SV_DemoWriterStatus_f( void ) {
+	int i, count = 0;
+
+	SV_DemoWriter_Reclaim();
+
+	Com_Printf( "cl queued KB   peak  written KB  ratio  avg ms  max ms  stalls  demo\n" );
+	Com_Printf( "-- ----------  ----  ----------  -----  ------  ------  ------  ----\n" );
+
+	for ( i = 0; i < DW_MAX_STREAMS; i++ ) {
+		const demoStream_t *ds = &dw_streams[i];
+		const int messages = ds->messages;
+		const int64_t raw = ds->raw;
+		char ratio[8] = "  -";
+
+		if ( ds->state == DS_FREE ) {
+			continue;
+		}
+
+		if ( ds->compression && raw ) {
+			Com_sprintf( ratio, sizeof( ratio ), "%3i%%", (int)(ds->written * 100 / raw) );
+		}
+
+		Com_Printf( "%2i %5u/%-4u  %3u%%  %10lld  %5s  %6.1f  %6i  %6i  %s%s\n",
+			ds->client,
+			Ring_Used( &ds->ring ) / 1024, ds->ring.size / 1024,
+			(uint32_t)((uint64_t)ds->peakQueued * 100 / ds->ring.size),
+			(long long)(ds->written / 1024),
+			ratio,
+			messages ? (double)ds->latencyTotal / messages : 0.0,
+			ds->latencyMax.load(),
+			ds->stalls,
+			ds->name,
+			ds->state == DS_RECORDING ? "" : " (closing)" );
+
+		if ( ds->failed ) {
+			Com_Printf( "   stopped, the queue was full\n" );
+		}
+		count++;
+	}
+
+	if ( !count ) {
+		Com_Printf( "No demos being written.\n" );
+	}
+}
+
+/*
+=============================================================================
+
+CONVERTING
+
+=============================================================================
+*/
+
+/*
+==================
+SV_DemoBlockValid
+
+Whether a block header could describe a block of this file
+==================
+*/
+static qboolean SV_DemoBlockValid( const demoBlock_t *block, int fileLen ) {
+	return (qboolean)( block->offset >= 12 && block->offset <= fileLen - 12
+		&& block->rawLen > 0 && block->rawLen <= DW_BLOCK_SIZE
+		&& block->packedLen > 0 && block->packedLen <= (int)sizeof( dw_packed )
+		&& block->packedLen <= fileLen - block->offset - 12 );
+}
+
+/*
+==================
+SV_DemoReadIndex
+
+Loads the block index of a .dmz, or rebuilds it from the block headers if
+the demo wasn't closed properly. Returns the number of blocks.
+==================
+*/
+static int SV_DemoReadIndex( fileHandle_t f, int fileLen, std::vector<demoBlock_t> &index ) {
+	int trailer[2], count, offset;
+	qboolean corrupt = qfalse;
+
+	if ( fileLen >= 20 ) {
+		FS_Seek( f, fileLen - 8, FS_SEEK_SET );
+		FS_Read( trailer, sizeof( trailer ), f );
+		offset = LittleLong( trailer[0] );
+
+		if ( LittleLong( trailer[1] ) == DEMOZ_END && offset >= 12 && offset < fileLen - 16 ) {
+			int header[2];
+
+			FS_Seek( f, offset, FS_SEEK_SET );
+			FS_Read( header, sizeof( header ), f );
+			count = LittleLong( header[1] );
+
+			if ( LittleLong( header[0] ) == DEMOZ_INDEX && count >= 0 && count <= (fileLen - offset) / (int)sizeof( demoBlock_t ) ) {
+				index.resize( count );
+				if ( count ) {
+					FS_Read( &index[0], count * sizeof( demoBlock_t ), f );
+				}
+				for ( int i = 0; i < count; i++ ) {
+					index[i].offset = LittleLong( index[i].offset );
+					index[i].rawLen = LittleLong( index[i].rawLen );
+					index[i].packedLen = LittleLong( index[i].packedLen );
+					index[i].firstSequence = LittleLong( index[i].firstSequence );
+
+					if ( !SV_DemoBlockValid( &index[i], fileLen ) ) {
+						corrupt = qtrue;
+					}
+				}
+				if ( !corrupt ) {
+					return count;
+				}
+				index.clear();
+			}
+		}
+	}
+
+	if ( corrupt ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: demo block index is corrupt, rebuilding it\n" );
+	} else {
+		Com_Printf( "Demo has no block index, it was not closed properly.\n" );
+	}
+
+	for ( offset = 12; offset + 12 <= fileLen; ) {
+		demoBlock_t block;
+		int header[3];
+
+		FS_Seek( f, offset, FS_SEEK_SET );
+		FS_Read( header, sizeof( header ), f );
+		block.offset = offset;
+		block.rawLen = LittleLong( header[0] );
+		block.packedLen = LittleLong( header[1] );
+		block.firstSequence = LittleLong( header[2] );
+
+		if ( !SV_DemoBlockValid( &block, fileLen ) ) {
+			break;
+		}
+		index.push_back( block );
+		offset += 12 + block.packedLen;
+	}
+
+	return (int)index.size();
+}
+
+/*
+==================
+SV_DemoConvertBlock
+
+Unpacks a block and writes out the messages in the sequence range. The first
+message of the demo is the gamestate, it is always kept.
+==================
+*/
+static qboolean SV_DemoConvertBlock( fileHandle_t in, fileHandle_t out, const demoBlock_t *block, byte *raw, byte *packed,
+	int first, int last, qboolean firstBlock, int *written )
+{
+	uLongf rawLen = DW_BLOCK_SIZE;
+	int offset = 0;
+
+	if ( block->rawLen <= 0 || block->rawLen > DW_BLOCK_SIZE || block->packedLen <= 0 || block->packedLen > (int)sizeof( dw_packed ) ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: bad block at offset %i, demo is cut short\n", block->offset );
+		return qfalse;
+	}
+
+	FS_Seek( in, block->offset + 12, FS_SEEK_SET );
+	if ( FS_Read( packed, block->packedLen, in ) != block->packedLen
+		|| uncompress( raw, &rawLen, packed, block->packedLen ) != Z_OK || (int)rawLen != block->rawLen ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: bad block at offset %i, demo is cut short\n", block->offset );
+		return qfalse;
+	}
+
+	while ( offset + 8 <= (int)rawLen ) {
+		const int sequence = LittleLong( *(int *)(raw + offset) );
+		const int len = LittleLong( *(int *)(raw + offset + 4) );
+
+		if ( len < 0 || offset + 8 + len > (int)rawLen ) {
+			break;
+		}
+
+		if ( (firstBlock && !offset) || (sequence >= first && sequence <= last) ) {
+			FS_Write( raw + offset, 8 + len, out );
+			(*written)++;
+		}
+		offset += 8 + len;
+	}
+
+	return qtrue;
+}
+
+/*
+==================
+SV_DemoConvert_f
+
+Turns a compressed demo back into a plain one players can watch. With a
+sequence range only the blocks holding it are unpacked. Such a part still
+starts with the gamestate, but the first snapshots delta against ones left
+out, so it is meant for tools rather than playback.
+==================
+*/
+void SV_DemoConvert_f( void ) {
+	char name[MAX_QPATH], inName[MAX_OSPATH], outName[MAX_OSPATH];
+	std::vector<demoBlock_t> index;
+	fileHandle_t in, out;
+	byte *raw, *packed;
+	int header[3];
+	int first = INT_MIN, last = INT_MAX;
+	int fileLen, count, i, written = 0;
+
+	if ( Cmd_Argc() < 2 || Cmd_Argc() > 4 ) {
+		Com_Printf( "svdemoconvert <demoname> [<first sequence> [<last sequence>]]\n" );
+		return;
+	}
+
+	Q_strncpyz( name, Cmd_Argv( 1 ), sizeof( name ) );
+	COM_StripExtension( name, name, sizeof( name ) );
+	if ( Cmd_Argc() > 2 ) {
+		first = atoi( Cmd_Argv( 2 ) );
+	}
+	if ( Cmd_Argc() > 3 ) {
+		last = atoi( Cmd_Argv( 3 ) );
+	}
+
+	Com_sprintf( inName, sizeof( inName ), "demos/%s.dmz_%d", name, PROTOCOL_VERSION );
+	fileLen = FS_FOpenFileRead( inName, &in, qtrue );
+	if ( !in ) {
+		Com_Printf( "Couldn't open %s.\n", inName );
+		return;
+	}
+
+	FS_Read( header, sizeof( header ), in );
+	if ( fileLen < (int)sizeof( header ) || LittleLong( header[0] ) != DEMOZ_HEADER || LittleLong( header[1] ) != DEMOZ_VERSION ) {
+		Com_Printf( "%s is not a compressed demo.\n", inName );
+		FS_FCloseFile( in );
+		return;
+	}
+
+	count = SV_DemoReadIndex( in, fileLen, index );
+
+	// the last block starting at or before the first sequence wanted
+	for ( i = 0; i + 1 < count && index[i + 1].firstSequence <= first; i++ ) {
+	}
+
+	Com_sprintf( outName, sizeof( outName ), "demos/%s.dm_%d", name, LittleLong( header[2] ) );
+	out = FS_FOpenFileWrite( outName );
+	if ( !out ) {
+		Com_Printf( "Couldn't open %s.\n", outName );
+		FS_FCloseFile( in );
+		return;
+	}
+
+	raw = (byte *)Z_Malloc( DW_BLOCK_SIZE, TAG_TEMP_WORKSPACE, qfalse );
+	packed = (byte *)Z_Malloc( sizeof( dw_packed ), TAG_TEMP_WORKSPACE, qfalse );
+
+	// a part still needs the gamestate from the first block
+	if ( i && !SV_DemoConvertBlock( in, out, &index[0], raw, packed, first, last, qtrue, &written ) ) {
+		i = count;
+	}
+
+	for ( ; i < count && index[i].firstSequence <= last; i++ ) {
+		if ( !SV_DemoConvertBlock( in, out, &index[i], raw, packed, first, last, i == 0 ? qtrue : qfalse, &written ) ) {
+			break;
+		}
+	}
+
+	// end of demo
+	header[0] = header[1] = -1;
+	FS_Write( header, 8, out );
+
+	FS_FCloseFile( out );
+	FS_FCloseFile( in );
+	Z_Free( packed );
+	Z_Free( raw );
+
+	Com_Printf( "Wrote %i messages to %s.\n", written, outName );
+}
+
+/*
+==================
+SV_DemoWriter_Init
+==================
+*/
+void SV_DemoWriter_Init( void ) {
+	sv_demoBufferSize = Cvar_Get( "sv_demoBufferSize", "256", CVAR_ARCHIVE_ND, "Kilobytes of memory per server-side demo for data not yet written to disk" );
+	Cvar_CheckRange( sv_demoBufferSize, 128, 8192, qtrue );
+	sv_demoBufferSize->modified = qfalse;
+}
+
+/*
+==================
+SV_DemoWriter_Shutdown
+
+Waits until all demos are written and closed and stops the writer.
+==================
+*/
+void SV_DemoWriter_Shutdown( void ) {
+	int i;
+
+	if ( !dw_thread ) {
+		return;
+	}
+
+	for ( i = 0; i < DW_MAX_STREAMS; i++ ) {
+		if ( dw_streams[i].state == DS_RECORDING ) {
+			SV_DemoWriter_Close( i );
+		}
+	}
+
+	for ( i = 0; i < DW_MAX_STREAMS; i++ ) {
+		while ( dw_streams[i].state == DS_CLOSING ) {
+			dw_wake.notify_one();
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+		}
+	}
+
+	dw_running = false;
+	dw_wake.notify_one();
+	dw_thread->join();
+	delete dw_thread;
+	dw_thread = NULL;
+
+	SV_DemoWriter_Reclaim();
+}
@@ -0,0 +1,240 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// sv_events.cpp -- structured events for the remote log
+//
+// Every event is one line of JSON, shipped in RL_EVENT datagrams next to the
+// console lines, e.g.
+//   {"event":"kill","time":51250,"killer":3,"victim":5,"mod":12}
+//
+// "time" is sv.time. Fields per event:
+//   connect     client, name, ip
+//   disconnect  client, name, reason
+//   userinfo    client, name, userinfo
+//   kill        killer (1022 for the world), victim, mod
+//   chat        client, mode ("all", "team", "tell"), target (tell only), text
+//   duel_start  client, target
+//   duel_end    winner, loser, result ("win", "tie", "stopped")
+//
+// Strings are passed through byte for byte, color codes included. Bytes
+// outside of ASCII are escaped as \u00XX, treating names as Latin-1.
+
+#include "server.h"
+
+static const char *eventNames[LOGEVENT_MAX] = {
+	"connect",
+	"disconnect",
+	"userinfo",
+	"kill",
+	"chat",
+	"duel_start",
+	"duel_end"
+};
+
+static const char *chatModeNames[] = { "all", "team", "tell" };
+static const char *duelResultNames[] = { "win", "tie", "stopped" };
+
+// room kept free at the end of the buffer so the event can always be closed
+#define EVENT_RESERVE	32
+
+typedef struct eventWriter_s {
+	char	data[MAXPRINTMSG];
+	int		len;
+} eventWriter_t;
+
+static qboolean SV_EventAppend( eventWriter_t *w, const char *s ) {
+	const int len = strlen( s );
+
+	if ( w->len + len >= (int)sizeof( w->data ) - EVENT_RESERVE ) {
+		return qfalse;
+	}
+	memcpy( w->data + w->len, s, len + 1 );
+	w->len += len;
+	return qtrue;
+}
+
+static void SV_EventInt( eventWriter_t *w, const char *key, int value ) {
+	SV_EventAppend( w, va( ",\"%s\":%i", key, value ) );
+}
+
+/*
+==================
+SV_EventString
+
+Appends a JSON string, truncating it if the event would get too long.
+==================
+*/
+static void SV_EventString( eventWriter_t *w, const char *key, const char *value ) {
+	const byte *s;
+
+	if ( !SV_EventAppend( w, va( ",\"%s\":\"", key ) ) ) {
+		return;
+	}
+
+	for ( s = (const byte *)value; *s; s++ ) {
+		char esc[8];
+
+		if ( *s == '"' || *s == '\\' ) {
+			esc[0] = '\\';
+			esc[1] = *s;
+			esc[2] = '\0';
+		} else if ( *s < 0x20 || *s >= 0x7f ) {
+			Com_sprintf( esc, sizeof( esc ), "\\u%04x", *s );
+		} else {
+			esc[0] = *s;
+			esc[1] = '\0';
+		}
+
+		if ( !SV_EventAppend( w, esc ) ) {
+			break;
+		}
+	}
+
+	// the reserve guarantees the closing quote fits
+	w->data[w->len++] = '"';
+	w->data[w->len] = '\0';
+}
+
+static void SV_EventBegin( eventWriter_t *w, logEventType_t type ) {
+	w->len = 0;
+	w->data[0] = '\0';
+	SV_EventAppend( w, va( "{\"event\":\"%s\",\"time\":%i", eventNames[type], sv.time ) );
+}
+
+static void SV_EventEnd( eventWriter_t *w ) {
+	Q_strcat( w->data, sizeof( w->data ), "}\n" );
+	RemoteLog_Event( w->data );
+}
+
+static qboolean SV_EventsEnabled( void ) {
+	return (sv_logEvents && sv_logEvents->integer && RemoteLog_EventsEnabled()) ? qtrue : qfalse;
+}
+
+/*
+==================
+SV_LogEvent
+
+Called by the game module. The event is copied before anything is looked at,
+it may live in VM memory.
+==================
+*/
+void SV_LogEvent( const logEvent_t *event ) {
+	eventWriter_t w;
+	logEvent_t ev;
+
+	if ( !event || !SV_EventsEnabled() ) {
+		return;
+	}
+
+	ev = *event;
+	ev.text[sizeof( ev.text ) - 1] = '\0';
+
+	// the engine keeps connect, disconnect and userinfo for itself
+	if ( ev.type < LOGEVENT_KILL || ev.type >= LOGEVENT_MAX ) {
+		return;
+	}
+
+	if ( ev.type == LOGEVENT_CHAT ) {
+		if ( ev.value < SAY_ALL || ev.value > SAY_TELL ) {
+			return;
+		}
+		// same privacy policy as the text log, see SV_SendClientChatLogPolicy
+		if ( com_logChat && com_logChat->integer < 2 ) {
+			if ( !com_logChat->integer || ev.value == SAY_TELL ) {
+				return;
+			}
+		}
+	}
+
+	if ( ev.type == LOGEVENT_DUEL_END && (ev.value < DUELRESULT_WIN || ev.value > DUELRESULT_STOPPED) ) {
+		return;
+	}
+
+	SV_EventBegin( &w, (logEventType_t)ev.type );
+
+	switch ( ev.type ) {
+	case LOGEVENT_KILL:
+		SV_EventInt( &w, "killer", ev.client );
+		SV_EventInt( &w, "victim", ev.target );
+		SV_EventInt( &w, "mod", ev.value );
+		break;
+
+	case LOGEVENT_CHAT:
+		SV_EventInt( &w, "client", ev.client );
+		SV_EventString( &w, "mode", chatModeNames[ev.value] );
+		if ( ev.value == SAY_TELL ) {
+			SV_EventInt( &w, "target", ev.target );
+		}
+		SV_EventString( &w, "text", ev.text );
+		break;
+
+	case LOGEVENT_DUEL_START:
+		SV_EventInt( &w, "client", ev.client );
+		SV_EventInt( &w, "target", ev.target );
+		break;
+
+	case LOGEVENT_DUEL_END:
+		SV_EventInt( &w, "winner", ev.client );
+		SV_EventInt( &w, "loser", ev.target );
+		SV_EventString( &w, "result", duelResultNames[ev.value] );
+		break;
+	}
+
+	SV_EventEnd( &w );
+}
+
+/*
+==================
+SV_LogClientEvent
+
+Connect, disconnect and userinfo events, sent by the engine so they don't
+depend on the game module. reason is only used for disconnects.
+==================
+*/
+void SV_LogClientEvent( client_t *cl, logEventType_t type, const char *reason ) {
+	eventWriter_t w;
+
+	if ( !SV_EventsEnabled() ) {
+		return;
+	}
+
+	SV_EventBegin( &w, type );
+	SV_EventInt( &w, "client", cl - svs.clients );
+	SV_EventString( &w, "name", cl->name );
+
+	switch ( type ) {
+	case LOGEVENT_CONNECT:
+		SV_EventString( &w, "ip", NET_AdrToString( cl->netchan.remoteAddress ) );
+		break;
+
+	case LOGEVENT_DISCONNECT:
+		SV_EventString( &w, "reason", reason ? reason : "" );
+		break;
+
+	case LOGEVENT_USERINFO:
+		SV_EventString( &w, "userinfo", cl->userinfo );
+		break;
+
+	default:
+		return;
+	}
+
+	SV_EventEnd( &w );
+}
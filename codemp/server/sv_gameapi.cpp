@@ -120,6 +120,7 @@ void GVM_ClientThink( int clientNum, usercmd_t *ucmd ) {
 void GVM_RunFrame( int levelTime ) {
 	if (!gvm)
 		return;
+	PROFILE_SCOPE( PROF_GAMEFRAME );
 	if ( gvm->isLegacy ) {
 		VM_Call( gvm, GAME_RUN_FRAME, levelTime );
 		return;
@@ -408,13 +409,8 @@ int GVM_FS_Write(const void *buffer, int len, fileHandle_t f)
 { //wrapper function to filter things out of log files
 	char *msg = (char *)buffer;
 
-	if (com_logChat && com_logChat->integer < 2 && msg)
-	{
-		if (!com_logChat->integer && (Q_stristr(msg, "say: ") || Q_stristr(msg, "sayteam: ") || Q_stristr(msg, "tell: "))) //0 - log nothing
-			return len;
-		if (com_logChat->integer == 1 && Q_stristr(msg, "tell: ")) //1 - only log public/team chat
-			return len; //return len so it thinks the write was successful
-	}
+	if (msg && ChatFilter_Hide(msg, len))
+		return len; //return len so it thinks the write was successful
 
 	return FS_Write(buffer, len, f);
 }
@@ -1526,11 +1522,13 @@ static qboolean SV_G2API_SetSkin( void *ghoul2, int modelIndex, qhandle_t custom
 }
 
 static void SV_G2API_CollisionDetect( CollisionRecord_t *collRecMap, void* ghoul2, const vec3_t angles, const vec3_t position, int frameNumber, int entNum, vec3_t rayStart, vec3_t rayEnd, vec3_t scale, int traceFlags, int useLod, float fRadius ) {
+	PROFILE_SCOPE( PROF_G2COLLISION );
 	if ( !ghoul2 ) return;
 	re->G2API_CollisionDetect( collRecMap, *((CGhoul2Info_v *)ghoul2), angles, position, frameNumber, entNum, rayStart, rayEnd, scale, G2VertSpaceServer, traceFlags, useLod, fRadius );
 }
 
 static void SV_G2API_CollisionDetectCache( CollisionRecord_t *collRecMap, void* ghoul2, const vec3_t angles, const vec3_t position, int frameNumber, int entNum, vec3_t rayStart, vec3_t rayEnd, vec3_t scale, int traceFlags, int useLod, float fRadius ) {
+	PROFILE_SCOPE( PROF_G2COLLISION );
 	if ( !ghoul2 ) return;
 	re->G2API_CollisionDetectCache( collRecMap, *((CGhoul2Info_v *)ghoul2), angles, position, frameNumber, entNum, rayStart, rayEnd, scale, G2VertSpaceServer, traceFlags, useLod, fRadius );
 }
@@ -1769,6 +1767,17 @@ static void GVM_Cvar_Set( const char *var_name, const char *value ) {
 	Cvar_VM_Set( var_name, value, VM_GAME );
 }
 
+// only the game log goes through the log writer thread, other files the
+// game appends to may be read back while open
+static int GVM_FS_Open( const char *qpath, fileHandle_t *f, fsMode_t mode ) {
+	int r = FS_FOpenFileByMode( qpath, f, mode );
+
+	if ( f && *f && (mode == FS_APPEND || mode == FS_APPEND_SYNC) && !Q_stricmp( qpath, Cvar_VariableString( "g_log" ) ) ) {
+		FS_WriteInBackground( *f );
+	}
+	return r;
+}
+
 // legacy syscall
 
 intptr_t SV_GameSystemCalls( intptr_t *args ) {
@@ -1880,7 +1889,7 @@ intptr_t SV_GameSystemCalls( intptr_t *args ) {
 		return 0;
 
 	case G_FS_FOPEN_FILE:
-		return FS_FOpenFileByMode( (const char *)VMA(1), (int *)VMA(2), (fsMode_t)args[3] );
+		return GVM_FS_Open( (const char *)VMA(1), (int *)VMA(2), (fsMode_t)args[3] );
 
 	case G_FS_READ:
 		FS_Read( VMA(1), args[2], args[3] );
@@ -2801,6 +2810,10 @@ intptr_t SV_GameSystemCalls( intptr_t *args ) {
 		SV_BotCalculatePaths(args[1]);
 		return 0;
 
+	case G_LOG_EVENT:
+		SV_LogEvent( (const logEvent_t *)VMA(1) );
+		return 0;
+
 	case G_GET_ENTITY_TOKEN:
 		return SV_GetEntityToken((char *)VMA(1), args[2]);
 
@@ -2906,7 +2919,7 @@ void SV_BindGame( void ) {
 		gi.Argv									= Cmd_ArgvBuffer;
 		gi.FS_Close								= FS_FCloseFile;
 		gi.FS_GetFileList						= FS_GetFileList;
-		gi.FS_Open								= FS_FOpenFileByMode;
+		gi.FS_Open								= GVM_FS_Open;
 		gi.FS_Read								= FS_Read;
 #ifdef DEDICATED
 		gi.FS_Write								= GVM_FS_Write;
@@ -3200,6 +3213,7 @@ void SV_BindGame( void ) {
 		gi.G2API_CleanEntAttachments			= SV_G2API_CleanEntAttachments;
 		gi.G2API_OverrideServer					= SV_G2API_OverrideServer;
 		gi.G2API_GetSurfaceName					= SV_G2API_GetSurfaceName;
+		gi.LogEvent								= SV_LogEvent;
 
 		GetGameAPI = (GetGameAPI_t)gvm->GetModuleAPI;
 		ret = GetGameAPI( GAME_API_VERSION, &gi );
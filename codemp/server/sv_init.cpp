@@ -29,20 +29,25 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/stringed_ingame.h"
 #include "sv_gameapi.h"
 
+#define MAX_CONFIGSTRING_COMMANDS	( MAX_GAMESTATE_CHARS / ( MAX_STRING_CHARS - 25 ) + 2 )
+
 /*
 ===============
-SV_SendConfigstring
+SV_ConfigstringCommands
 
-Creates and sends the server command necessary to update the CS index for the
-given client
+Creates the server commands necessary to update the CS index. They are made
+once and shared by every client that gets the update, the caller releases
+them when done.
 ===============
 */
-static void SV_SendConfigstring(client_t *client, int index)
+static int SV_ConfigstringCommands( int index, reliableCommand_t **cmds )
 {
 	int maxChunkSize = MAX_STRING_CHARS - 24;
-	int len;
+	int len, count;
+	char message[MAX_STRING_CHARS + 32];
 
 	len = strlen(sv.configstrings[index]);
+	count = 0;
 
 	if( len >= maxChunkSize ) {
 		int		sent = 0;
@@ -50,7 +55,7 @@ static void SV_SendConfigstring(client_t *client, int index)
 		char	*cmd;
 		char	buf[MAX_STRING_CHARS];
 
-		while (remaining > 0 ) {
+		while (remaining > 0 && count < MAX_CONFIGSTRING_COMMANDS ) {
 			if ( sent == 0 ) {
 				cmd = "bcs0";
 			}
@@ -63,16 +68,40 @@ static void SV_SendConfigstring(client_t *client, int index)
 			Q_strncpyz( buf, &sv.configstrings[index][sent],
 				maxChunkSize );
 
-			SV_SendServerCommand( client, "%s %i \"%s\"\n", cmd,
+			Com_sprintf( message, sizeof( message ), "%s %i \"%s\"\n", cmd,
 				index, buf );
+			cmds[count++] = SV_NewReliableCommand( message );
 
 			sent += (maxChunkSize - 1);
 			remaining -= (maxChunkSize - 1);
 		}
 	} else {
 		// standard cs, just send it
-		SV_SendServerCommand( client, "cs %i \"%s\"\n", index,
+		Com_sprintf( message, sizeof( message ), "cs %i \"%s\"\n", index,
 			sv.configstrings[index] );
+		cmds[count++] = SV_NewReliableCommand( message );
+	}
+
+	return count;
+}
+
+/*
+===============
+SV_SendConfigstring
+
+Sends the server commands necessary to update the CS index for the
+given client
+===============
+*/
+static void SV_SendConfigstring(client_t *client, int index)
+{
+	reliableCommand_t	*cmds[MAX_CONFIGSTRING_COMMANDS];
+	int					i, count;
+
+	count = SV_ConfigstringCommands( index, cmds );
+	for ( i = 0 ; i < count ; i++ ) {
+		SV_AddReliableCommand( client, cmds[i] );
+		SV_ReleaseReliableCommand( cmds[i] );
 	}
 }
 
@@ -133,6 +162,8 @@ void SV_SetConfigstring (int index, const char *val) {
 	// send it to all the clients if we aren't
 	// spawning a new server
 	if ( sv.state == SS_GAME || sv.restarting ) {
+		reliableCommand_t	*cmds[MAX_CONFIGSTRING_COMMANDS];
+		int					j, count = -1;
 
 		// send the data to all relevent clients
 		for (i = 0, client = svs.clients; i < sv_maxclients->integer ; i++, client++) {
@@ -146,7 +177,17 @@ void SV_SetConfigstring (int index, const char *val) {
 				continue;
 			}
 
-			SV_SendConfigstring(client, index);
+			// the commands are only made once for all of the clients
+			if ( count < 0 ) {
+				count = SV_ConfigstringCommands( index, cmds );
+			}
+			for ( j = 0 ; j < count ; j++ ) {
+				SV_AddReliableCommand( client, cmds[j] );
+			}
+		}
+
+		for ( j = 0 ; j < count ; j++ ) {
+			SV_ReleaseReliableCommand( cmds[j] );
 		}
 	}
 }
@@ -344,6 +385,13 @@ void SV_ChangeMaxClients( void ) {
 		}
 	}
 
+	// the clients that are not copied let go of their commands
+	for ( i = 0 ; i < oldMaxClients ; i++ ) {
+		if ( svs.clients[i].state < CS_CONNECTED ) {
+			SV_ClearReliableCommands( &svs.clients[i] );
+		}
+	}
+
 	// free old clients arrays
 	Z_Free( svs.clients );
 
@@ -979,6 +1027,7 @@ void SV_Init (void) {
 	// server vars
 	sv_rconPassword = Cvar_Get ("rconPassword", "", CVAR_TEMP );
 	sv_logremote = Cvar_Get ("logremote", "", CVAR_TEMP );
+	sv_logEvents = Cvar_Get ("sv_logEvents", "1", CVAR_ARCHIVE_ND, "Send kill, chat, connect, userinfo and duel events to logremote as JSON" );
 	sv_privatePassword = Cvar_Get ("sv_privatePassword", "", CVAR_TEMP );
 	sv_snapsMin = Cvar_Get ("sv_snapsMin", "0", CVAR_ARCHIVE_ND ); // 1 <=> sv_snapsMax
 	sv_snapsMax = Cvar_Get ("sv_snapsMax", "0", CVAR_ARCHIVE_ND ); // sv_snapsMin <=> sv_fps
@@ -1010,6 +1059,10 @@ void SV_Init (void) {
 	sv_autoDemo = Cvar_Get( "sv_autoDemo", "0", CVAR_ARCHIVE_ND | CVAR_SERVERINFO, "Automatically take server-side demos" );
 	sv_autoDemoBots = Cvar_Get( "sv_autoDemoBots", "0", CVAR_ARCHIVE_ND, "Record server-side demos for bots" );
 	sv_autoDemoMaxMaps = Cvar_Get( "sv_autoDemoMaxMaps", "0", CVAR_ARCHIVE_ND );
+	sv_autoDemoMaxMB = Cvar_Get( "sv_autoDemoMaxMB", "0", CVAR_ARCHIVE_ND, "Delete the oldest autorecorded maps once all of them take up more megabytes than this" );
+	sv_autoDemoCompress = Cvar_Get( "sv_autoDemoCompress", "0", CVAR_ARCHIVE_ND, "Compress autorecorded demos with this zlib level (1-9), svdemoconvert turns them back into plain demos" );
+	SV_DemoWriter_Init();
+	SV_Jobs_Init();
 
 #ifndef DEDICATED //Default this to off on client to avoid potential mod compatibility issues.
 	sv_legacyFixes = Cvar_Get( "sv_legacyFixes", "0", CVAR_ARCHIVE );
@@ -1021,6 +1074,9 @@ void SV_Init (void) {
 	sv_banFile = Cvar_Get( "sv_banFile", "serverbans.dat", CVAR_ARCHIVE, "File to use to store bans and exceptions" );
 
 	sv_snapShotDuelCull = Cvar_Get("sv_snapShotDuelCull", "1", CVAR_NONE, "Snapshot-based duel isolation");
+	sv_sectorSize = Cvar_Get("sv_sectorSize", "512", CVAR_ARCHIVE_ND, "Size the entity sectors are split down to on map load, 0 for the old fixed 16 sectors");
+	sv_snapshotVerify = Cvar_Get("sv_snapshotVerify", "0", CVAR_NONE, "Find the entities of every snapshot again walking all of them on the main thread and warn if that differs");
+	sv_deltaCache = Cvar_Get("sv_deltaCache", "1", CVAR_ARCHIVE_ND, "Encode an entity delta once per frame and copy it to every client that gets the same one");
 
 	sv_hibernateTime = Cvar_Get("sv_hibernateTime", "0", CVAR_ARCHIVE_ND, "Time after which server will enter hibernation mode");
 	sv_hibernateFPS = Cvar_Get("sv_hibernateFPS", "2", CVAR_ARCHIVE_ND, "FPS during hibernation mode");
@@ -1032,6 +1088,7 @@ void SV_Init (void) {
 
 #ifdef DEDICATED
 	sv_antiDST = Cvar_Get("sv_antiDST", "1", CVAR_NONE, "Attempts to detect and kick players injecting or using DST");
+	sv_g2TraceCache = Cvar_Get("sv_g2TraceCache", "0", CVAR_ARCHIVE_ND, "Reuse the skinned Ghoul2 model of an entity for all traces against it in a frame");
 	sv_pingFix = Cvar_Get("sv_pingFix", "2", CVAR_ARCHIVE_ND, "Improved scoreboard client ping calculation - 1: always use new ping calculation - 2: fall back to old method if client's packet rate is less than 60");
 
 	//Used to control/force certain settings at all times
@@ -1113,6 +1170,17 @@ void SV_Shutdown( char *finalmsg )
 		SV_FinalMessage( finalmsg );
 	}
 
+	// finish the demos while the clients are still around
+	if ( svs.clients ) {
+		for ( client_t *client = svs.clients; client - svs.clients < sv_maxclients->integer; client++ ) {
+			if ( client->demo.demorecording ) {
+				SV_StopRecordDemo( client );
+			}
+		}
+	}
+	SV_DemoWriter_Shutdown();
+	SV_Jobs_Shutdown();
+
 	SV_RemoveOperatorCommands();
 	SV_MasterShutdown();
 	SV_ChallengeShutdown();
@@ -1134,6 +1202,9 @@ Ghoul2 Insert Start
 
 	// free server static data
 	if ( svs.clients ) {
+		for ( int i = 0 ; i < sv_maxclients->integer ; i++ ) {
+			SV_ClearReliableCommands( &svs.clients[i] );
+		}
 		Z_Free( svs.clients );
 	}
 	Com_Memset( &svs, 0, sizeof( svs ) );
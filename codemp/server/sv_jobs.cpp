@@ -0,0 +1,194 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// sv_jobs.cpp -- a small pool of worker threads for the server frame
+//
+// SV_Jobs_Run hands out a batch of numbered jobs to sv_jobThreads workers and
+// works on the batch itself as well, it returns once every job is done. The
+// main thread is blocked meanwhile, so the jobs can read all of the server
+// and game state without locks as long as they only write to their own job.
+//
+// Jobs run on other threads: they may not print, allocate from the zone,
+// drop clients or call Com_Error. With sv_jobThreads 0 every job runs on the
+// main thread in order.
+
+#include "server.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define JOBS_MAX_THREADS	16
+
+static cvar_t					*sv_jobThreads;
+
+static std::thread				*jobs_threads[JOBS_MAX_THREADS];
+static int						jobs_numThreads;
+
+static std::mutex				jobs_lock;
+static std::condition_variable	jobs_wake;		// a batch was started or the pool stops
+static std::condition_variable	jobs_done;		// the last worker finished its share
+static bool						jobs_running;
+static int						jobs_batch;		// bumped for every batch
+static int						jobs_busy;		// workers still on the batch
+
+static svJobFunc_t				jobs_func;
+static void						*jobs_data;
+static int						jobs_count;
+static std::atomic<int>			jobs_next;
+
+static void SV_Jobs_Work( void ) {
+	int job;
+
+	while ( (job = jobs_next++) < jobs_count ) {
+		jobs_func( job, jobs_data );
+	}
+}
+
+static void SV_Jobs_ThreadMain( void ) {
+	int batch = 0;
+
+	for ( ;; ) {
+		{
+			std::unique_lock<std::mutex> lock( jobs_lock );
+			jobs_wake.wait( lock, [&batch] { return !jobs_running || jobs_batch != batch; } );
+			if ( !jobs_running ) {
+				return;
+			}
+			batch = jobs_batch;
+		}
+
+		SV_Jobs_Work();
+
+		std::lock_guard<std::mutex> lock( jobs_lock );
+		if ( !--jobs_busy ) {
+			jobs_done.notify_one();
+		}
+	}
+}
+
+static void SV_Jobs_StopThreads( void ) {
+	int i;
+
+	{
+		std::lock_guard<std::mutex> lock( jobs_lock );
+		jobs_running = false;
+	}
+	jobs_wake.notify_all();
+
+	for ( i = 0; i < jobs_numThreads; i++ ) {
+		jobs_threads[i]->join();
+		delete jobs_threads[i];
+		jobs_threads[i] = NULL;
+	}
+	jobs_numThreads = 0;
+}
+
+static void SV_Jobs_StartThreads( int count ) {
+	int i;
+
+	jobs_running = true;
+	jobs_batch = 0;
+	for ( i = 0; i < count; i++ ) {
+		jobs_threads[i] = new std::thread( SV_Jobs_ThreadMain );
+	}
+	jobs_numThreads = count;
+}
+
+/*
+==================
+SV_Jobs_Threads
+
+The number of workers a batch is spread over, 0 when SV_Jobs_Run runs
+everything on the main thread. Applies sv_jobThreads changes.
+==================
+*/
+int SV_Jobs_Threads( void ) {
+	if ( sv_jobThreads && sv_jobThreads->modified ) {
+		sv_jobThreads->modified = qfalse;
+		Cvar_CheckRange( sv_jobThreads, 0, JOBS_MAX_THREADS, qtrue );
+
+		if ( sv_jobThreads->integer != jobs_numThreads ) {
+			SV_Jobs_StopThreads();
+			SV_Jobs_StartThreads( sv_jobThreads->integer );
+		}
+	}
+
+	return jobs_numThreads;
+}
+
+/*
+==================
+SV_Jobs_Run
+
+Calls func for every job from 0 to numJobs - 1 and returns when they are all
+done. Which thread runs which job is up to the scheduler, the jobs may not
+depend on each other.
+==================
+*/
+void SV_Jobs_Run( svJobFunc_t func, void *data, int numJobs ) {
+	int i;
+
+	if ( numJobs < 2 || !SV_Jobs_Threads() ) {
+		for ( i = 0; i < numJobs; i++ ) {
+			func( i, data );
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( jobs_lock );
+		jobs_func = func;
+		jobs_data = data;
+		jobs_count = numJobs;
+		jobs_next = 0;
+		jobs_busy = jobs_numThreads;
+		jobs_batch++;
+	}
+	jobs_wake.notify_all();
+
+	SV_Jobs_Work();
+
+	std::unique_lock<std::mutex> lock( jobs_lock );
+	jobs_done.wait( lock, [] { return !jobs_busy; } );
+}
+
+/*
+==================
+SV_Jobs_Init
+==================
+*/
+void SV_Jobs_Init( void ) {
+	sv_jobThreads = Cvar_Get( "sv_jobThreads", "0", CVAR_ARCHIVE_ND, "Worker threads that help build client snapshots, 0 builds them on the main thread only" );
+	sv_jobThreads->modified = qtrue;
+}
+
+/*
+==================
+SV_Jobs_Shutdown
+==================
+*/
+void SV_Jobs_Shutdown( void ) {
+	SV_Jobs_StopThreads();
+	if ( sv_jobThreads ) {
+		sv_jobThreads->modified = qtrue;
+	}
+}
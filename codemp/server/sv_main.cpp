@@ -38,6 +38,7 @@ cvar_t	*sv_timeout;			// seconds without any message
 cvar_t	*sv_zombietime;			// seconds to sink messages after disconnect
 cvar_t	*sv_rconPassword;		// password for remote server commands
 cvar_t	*sv_logremote;			// remote address to send log data to
+cvar_t	*sv_logEvents;			// send structured events along with the remote log
 cvar_t	*sv_privatePassword;	// password for the privateClient slots
 cvar_t	*sv_maxclients;
 cvar_t	*sv_privateClients;		// number of clients reserved for password
@@ -68,6 +69,8 @@ cvar_t	*sv_filterCommands; // strict filtering on commands (1: strip ['\r', '\n'
 cvar_t	*sv_autoDemo;
 cvar_t	*sv_autoDemoBots;
 cvar_t	*sv_autoDemoMaxMaps;
+cvar_t	*sv_autoDemoMaxMB;
+cvar_t	*sv_autoDemoCompress;
 cvar_t	*sv_legacyFixes;
 cvar_t	*sv_strictPacketTimestamp;
 cvar_t	*sv_banFile;
@@ -76,6 +79,9 @@ cvar_t	*sv_maxOOBRateIP;
 cvar_t	*sv_autoWhitelist;
 
 cvar_t	*sv_snapShotDuelCull;
+cvar_t	*sv_sectorSize;
+cvar_t	*sv_snapshotVerify;
+cvar_t	*sv_deltaCache;
 
 cvar_t	*sv_pingFix;
 cvar_t	*sv_hibernateTime;
@@ -83,6 +89,7 @@ cvar_t	*sv_hibernateFPS;
 
 #ifdef DEDICATED
 cvar_t	*sv_antiDST;
+cvar_t	*sv_g2TraceCache;
 
 //cvar_t	*sv_g_logSync;
 #endif
@@ -126,13 +133,81 @@ char	*SV_ExpandNewlines( char *in ) {
 
 /*
 ======================
-SV_AddServerCommand
+SV_NewReliableCommand
+
+Reliable commands are kept once no matter how many clients they go to, a
+broadcast only hands the same copy to every client. The caller holds the
+first reference and lets go of it with SV_ReleaseReliableCommand once the
+command was added to the clients.
+======================
+*/
+reliableCommand_t *SV_NewReliableCommand( const char *cmd ) {
+	reliableCommand_t	*rc;
+	int					length;
+
+	// as much as the old per client buffers held
+	length = strlen( cmd );
+	if ( length > MAX_STRING_CHARS - 1 ) {
+		length = MAX_STRING_CHARS - 1;
+	}
+
+	rc = (reliableCommand_t *)Z_Malloc( sizeof( *rc ) + length, TAG_CLIENTS, qfalse );
+	rc->refCount = 1;
+	Com_Memcpy( rc->string, cmd, length );
+	rc->string[length] = 0;
+	return rc;
+}
+
+/*
+======================
+SV_ReleaseReliableCommand
+======================
+*/
+void SV_ReleaseReliableCommand( reliableCommand_t *cmd ) {
+	if ( cmd && !--cmd->refCount ) {
+		Z_Free( cmd );
+	}
+}
+
+/*
+======================
+SV_ReliableCommand
+
+The command sent with the given sequence, or the last one that used its
+slot. Slots that were never used are empty strings.
+======================
+*/
+const char *SV_ReliableCommand( const client_t *client, int sequence ) {
+	const reliableCommand_t *cmd = client->reliableCommands[ sequence & (MAX_RELIABLE_COMMANDS-1) ];
+
+	return cmd ? cmd->string : "";
+}
+
+/*
+======================
+SV_ClearReliableCommands
+
+Lets go of the commands of a client slot before it is cleared or freed.
+======================
+*/
+void SV_ClearReliableCommands( client_t *client ) {
+	int i;
+
+	for ( i = 0 ; i < MAX_RELIABLE_COMMANDS ; i++ ) {
+		SV_ReleaseReliableCommand( client->reliableCommands[i] );
+		client->reliableCommands[i] = NULL;
+	}
+}
+
+/*
+======================
+SV_AddReliableCommand
 
 The given command will be transmitted to the client, and is guaranteed to
 not have future snapshot_t executed before it is executed
 ======================
 */
-void SV_AddServerCommand( client_t *client, const char *cmd ) {
+void SV_AddReliableCommand( client_t *client, reliableCommand_t *cmd ) {
 	int		index, i;
 
 	// do not send commands until the gamestate has been sent
@@ -148,14 +223,34 @@ void SV_AddServerCommand( client_t *client, const char *cmd ) {
 	if ( client->reliableSequence - client->reliableAcknowledge == MAX_RELIABLE_COMMANDS + 1 ) {
 		Com_Printf( "===== pending server commands =====\n" );
 		for ( i = client->reliableAcknowledge + 1 ; i <= client->reliableSequence ; i++ ) {
-			Com_Printf( "cmd %5d: %s\n", i, client->reliableCommands[ i & (MAX_RELIABLE_COMMANDS-1) ] );
+			Com_Printf( "cmd %5d: %s\n", i, SV_ReliableCommand( client, i ) );
 		}
-		Com_Printf( "cmd %5d: %s\n", i, cmd );
+		Com_Printf( "cmd %5d: %s\n", i, cmd->string );
 		SV_DropClient( client, "Server command overflow" );
 		return;
 	}
 	index = client->reliableSequence & ( MAX_RELIABLE_COMMANDS - 1 );
-	Q_strncpyz( client->reliableCommands[ index ], cmd, sizeof( client->reliableCommands[ index ] ) );
+	cmd->refCount++;
+	SV_ReleaseReliableCommand( client->reliableCommands[ index ] );
+	client->reliableCommands[ index ] = cmd;
+}
+
+/*
+======================
+SV_AddServerCommand
+======================
+*/
+void SV_AddServerCommand( client_t *client, const char *cmd ) {
+	reliableCommand_t *rc;
+
+	// do not send commands until the gamestate has been sent
+	if ( client->state < CS_PRIMED ) {
+		return;
+	}
+
+	rc = SV_NewReliableCommand( cmd );
+	SV_AddReliableCommand( client, rc );
+	SV_ReleaseReliableCommand( rc );
 }
 
 
@@ -173,6 +268,7 @@ void QDECL SV_SendServerCommand(client_t *cl, const char *fmt, ...) {
 	byte		message[MAX_MSGLEN];
 	client_t	*client;
 	int			j;
+	reliableCommand_t	*rc;
 
 	va_start (argptr,fmt);
 	Q_vsnprintf((char *)message, sizeof(message), fmt, argptr);
@@ -197,9 +293,11 @@ void QDECL SV_SendServerCommand(client_t *cl, const char *fmt, ...) {
 	}
 
 	// send the data to all relevent clients
+	rc = SV_NewReliableCommand( (char *)message );
 	for (j = 0, client = svs.clients; j < sv_maxclients->integer ; j++, client++) {
-		SV_AddServerCommand( client, (char *)message );
+		SV_AddReliableCommand( client, rc );
 	}
+	SV_ReleaseReliableCommand( rc );
 }
 
 
@@ -422,6 +520,105 @@ qboolean SVC_RateLimitAddress( netadr_t from, int burst, int period, int now ) {
 	return SVC_RateLimit( bucket, burst, period, now );
 }
 
+/*
+================
+Status and info caches
+
+Server browsers and trackers ask for getstatus and getinfo all the time,
+and both answers only change when a cvar or a client does. They are kept
+built between queries, only the challenge of each query is added in.
+================
+*/
+
+typedef struct statusPlayer_s {
+	qboolean	connected;
+	int			score;
+	int			ping;
+	char		name[MAX_NAME_LENGTH];
+} statusPlayer_t;
+
+static struct {
+	qboolean		valid;
+	int				cvarCount;		// cvar_modifiedCount it was built at
+	char			infostring[MAX_INFO_STRING];	// the serverinfo without a challenge
+
+	qboolean		playersValid;
+	int				maxclients;
+	statusPlayer_t	players[MAX_CLIENTS];
+	char			status[MAX_MSGLEN];
+} statusCache;
+
+static struct {
+	qboolean		valid;
+	int				cvarCount;
+	int				count, humans;
+	char			infostring[MAX_INFO_STRING];	// everything in front of the challenge
+} infoCache;
+
+/*
+================
+SV_StatusPlayers
+
+The player lines of a status response, rebuilt when any of them changed.
+================
+*/
+static const char *SV_StatusPlayers( void ) {
+	char			player[1024];
+	int				i;
+	client_t		*cl;
+	statusPlayer_t	*sp;
+	playerState_t	*ps;
+	int				statusLength;
+	int				playerLength;
+	qboolean		same;
+
+	same = (qboolean)( statusCache.playersValid && statusCache.maxclients == sv_maxclients->integer );
+	for ( i=0, cl = svs.clients, sp = statusCache.players ; i < sv_maxclients->integer && same ; i++, cl++, sp++ ) {
+		if ( cl->state >= CS_CONNECTED ) {
+			ps = SV_GameClientNum( i );
+			same = (qboolean)( sp->connected && sp->score == ps->persistant[PERS_SCORE]
+				&& sp->ping == cl->ping && !strcmp( sp->name, cl->name ) );
+		} else {
+			same = (qboolean)!sp->connected;
+		}
+	}
+	if ( same ) {
+		return statusCache.status;
+	}
+
+	statusCache.status[0] = 0;
+	statusLength = 0;
+
+	for ( i=0, cl = svs.clients, sp = statusCache.players ; i < sv_maxclients->integer ; i++, cl++, sp++ ) {
+		sp->connected = (qboolean)( cl->state >= CS_CONNECTED );
+		if ( !sp->connected ) {
+			continue;
+		}
+
+		ps = SV_GameClientNum( i );
+		sp->score = ps->persistant[PERS_SCORE];
+		sp->ping = cl->ping;
+		Q_strncpyz( sp->name, cl->name, sizeof( sp->name ) );
+
+		if ( statusLength < 0 ) {
+			continue;		// full, but keep track of the rest
+		}
+		Com_sprintf (player, sizeof(player), "%i %i \"%s\"\n",
+			sp->score, sp->ping, cl->name);
+		playerLength = strlen(player);
+		if (statusLength + playerLength >= (int)sizeof(statusCache.status) ) {
+			statusLength = -1;		// can't hold any more
+			continue;
+		}
+		strcpy (statusCache.status + statusLength, player);
+		statusLength += playerLength;
+	}
+
+	statusCache.maxclients = sv_maxclients->integer;
+	statusCache.playersValid = qtrue;
+	return statusCache.status;
+}
+
 /*
 ================
 SVC_Status
@@ -432,13 +629,6 @@ the simple info query.
 ================
 */
 void SVC_Status( netadr_t from ) {
-	char	player[1024];
-	char	status[MAX_MSGLEN];
-	int		i;
-	client_t	*cl;
-	playerState_t	*ps;
-	int		statusLength;
-	int		playerLength;
 	char	infostring[MAX_INFO_STRING];
 
 	// ignore if we are in single player
@@ -452,31 +642,66 @@ void SVC_Status( netadr_t from ) {
 	if(strlen(Cmd_Argv(1)) > 128)
 		return;
 
-	Q_strncpyz( infostring, Cvar_InfoString( CVAR_SERVERINFO ), sizeof( infostring ) );
+	if ( !statusCache.valid || statusCache.cvarCount != cvar_modifiedCount ) {
+		Q_strncpyz( statusCache.infostring, Cvar_InfoString( CVAR_SERVERINFO ), sizeof( statusCache.infostring ) );
+		statusCache.cvarCount = cvar_modifiedCount;
+		statusCache.valid = qtrue;
+	}
+	Q_strncpyz( infostring, statusCache.infostring, sizeof( infostring ) );
 
 	// echo back the parameter to status. so master servers can use it as a challenge
 	// to prevent timed spoofed reply packets that add ghost servers
 	Info_SetValueForKey( infostring, "challenge", Cmd_Argv(1) );
 
-	status[0] = 0;
-	statusLength = 0;
+	NET_OutOfBandPrint( NS_SERVER, from, "statusResponse\n%s\n%s", infostring, SV_StatusPlayers() );
+}
 
-	for (i=0 ; i < sv_maxclients->integer ; i++) {
-		cl = &svs.clients[i];
-		if ( cl->state >= CS_CONNECTED ) {
-			ps = SV_GameClientNum( i );
-			Com_sprintf (player, sizeof(player), "%i %i \"%s\"\n",
-				ps->persistant[PERS_SCORE], cl->ping, cl->name);
-			playerLength = strlen(player);
-			if (statusLength + playerLength >= (int)sizeof(status) ) {
-				break;		// can't hold any more
-			}
-			strcpy (status + statusLength, player);
-			statusLength += playerLength;
-		}
+/*
+================
+SV_InfoString
+
+Every key of an info response but the challenge. Each key is added in
+front of the ones before it, so the challenge that goes in first ends up
+at the end.
+================
+*/
+static void SV_InfoString( char *infostring, int count, int humans ) {
+	int		wDisable;
+	char	*gamedir;
+
+	Info_SetValueForKey( infostring, "protocol", va("%i", PROTOCOL_VERSION) );
+	Info_SetValueForKey( infostring, "hostname", sv_hostname->string );
+	Info_SetValueForKey( infostring, "mapname", sv_mapname->string );
+	Info_SetValueForKey( infostring, "clients", va("%i", count) );
+	Info_SetValueForKey( infostring, "g_humanplayers", va("%i", humans) );
+	Info_SetValueForKey( infostring, "sv_maxclients",
+		va("%i", sv_maxclients->integer - sv_privateClients->integer ) );
+	Info_SetValueForKey( infostring, "gametype", va("%i", sv_gametype->integer ) );
+	Info_SetValueForKey( infostring, "needpass", va("%i", sv_needpass->integer ) );
+	Info_SetValueForKey( infostring, "truejedi", va("%i", Cvar_VariableIntegerValue( "g_jediVmerc" ) ) );
+	if ( sv_gametype->integer == GT_DUEL || sv_gametype->integer == GT_POWERDUEL )
+	{
+		wDisable = Cvar_VariableIntegerValue( "g_duelWeaponDisable" );
+	}
+	else
+	{
+		wDisable = Cvar_VariableIntegerValue( "g_weaponDisable" );
 	}
+	Info_SetValueForKey( infostring, "wdisable", va("%i", wDisable ) );
+	Info_SetValueForKey( infostring, "fdisable", va("%i", Cvar_VariableIntegerValue( "g_forcePowerDisable" ) ) );
+	//Info_SetValueForKey( infostring, "pure", va("%i", sv_pure->integer ) );
+	Info_SetValueForKey( infostring, "autodemo", va("%i", sv_autoDemo->integer ) );
 
-	NET_OutOfBandPrint( NS_SERVER, from, "statusResponse\n%s\n%s", infostring, status );
+	if( sv_minPing->integer ) {
+		Info_SetValueForKey( infostring, "minPing", va("%i", sv_minPing->integer) );
+	}
+	if( sv_maxPing->integer ) {
+		Info_SetValueForKey( infostring, "maxPing", va("%i", sv_maxPing->integer) );
+	}
+	gamedir = Cvar_VariableString( "fs_game" );
+	if( *gamedir ) {
+		Info_SetValueForKey( infostring, "game", gamedir );
+	}
 }
 
 /*
@@ -488,8 +713,8 @@ if a user is interested in a server to do a full status
 ================
 */
 void SVC_Info( netadr_t from ) {
-	int		i, count, humans, wDisable;
-	char	*gamedir;
+	int		i, count, humans;
+	char	challenge[MAX_INFO_STRING];
 	char	infostring[MAX_INFO_STRING];
 
 	// ignore if we are in single player
@@ -524,47 +749,39 @@ void SVC_Info( netadr_t from ) {
 		}
 	}
 
-	infostring[0] = 0;
-
 	// echo back the parameter to status. so servers can use it as a challenge
 	// to prevent timed spoofed reply packets that add ghost servers
-	Info_SetValueForKey( infostring, "challenge", Cmd_Argv(1) );
-
-	Info_SetValueForKey( infostring, "protocol", va("%i", PROTOCOL_VERSION) );
-	Info_SetValueForKey( infostring, "hostname", sv_hostname->string );
-	Info_SetValueForKey( infostring, "mapname", sv_mapname->string );
-	Info_SetValueForKey( infostring, "clients", va("%i", count) );
-	Info_SetValueForKey( infostring, "g_humanplayers", va("%i", humans) );
-	Info_SetValueForKey( infostring, "sv_maxclients",
-		va("%i", sv_maxclients->integer - sv_privateClients->integer ) );
-	Info_SetValueForKey( infostring, "gametype", va("%i", sv_gametype->integer ) );
-	Info_SetValueForKey( infostring, "needpass", va("%i", sv_needpass->integer ) );
-	Info_SetValueForKey( infostring, "truejedi", va("%i", Cvar_VariableIntegerValue( "g_jediVmerc" ) ) );
-	if ( sv_gametype->integer == GT_DUEL || sv_gametype->integer == GT_POWERDUEL )
-	{
-		wDisable = Cvar_VariableIntegerValue( "g_duelWeaponDisable" );
-	}
-	else
-	{
-		wDisable = Cvar_VariableIntegerValue( "g_weaponDisable" );
-	}
-	Info_SetValueForKey( infostring, "wdisable", va("%i", wDisable ) );
-	Info_SetValueForKey( infostring, "fdisable", va("%i", Cvar_VariableIntegerValue( "g_forcePowerDisable" ) ) );
-	//Info_SetValueForKey( infostring, "pure", va("%i", sv_pure->integer ) );
-	Info_SetValueForKey( infostring, "autodemo", va("%i", sv_autoDemo->integer ) );
-
-	if( sv_minPing->integer ) {
-		Info_SetValueForKey( infostring, "minPing", va("%i", sv_minPing->integer) );
-	}
-	if( sv_maxPing->integer ) {
-		Info_SetValueForKey( infostring, "maxPing", va("%i", sv_maxPing->integer) );
-	}
-	gamedir = Cvar_VariableString( "fs_game" );
-	if( *gamedir ) {
-		Info_SetValueForKey( infostring, "game", gamedir );
+	challenge[0] = 0;
+	Info_SetValueForKey( challenge, "challenge", Cmd_Argv(1) );
+
+	if ( !infoCache.valid || infoCache.cvarCount != cvar_modifiedCount
+		|| infoCache.count != count || infoCache.humans != humans ) {
+		// the keys only go in front of the challenge if none of them gets
+		// dropped for length, even behind the longest challenge there is
+		char	longest[160];
+		int		length;
+
+		length = Com_sprintf( longest, sizeof( longest ), "\\challenge\\%0128d", 0 );
+		Q_strncpyz( infostring, longest, sizeof( infostring ) );
+		SV_InfoString( infostring, count, humans );
+		infoCache.infostring[0] = 0;
+		SV_InfoString( infoCache.infostring, count, humans );
+
+		i = strlen( infostring ) - length;
+		infoCache.valid = (qboolean)( i >= 0 && !strcmp( infostring + i, longest )
+			&& !strncmp( infostring, infoCache.infostring, i ) && !infoCache.infostring[i] );
+		infoCache.cvarCount = cvar_modifiedCount;
+		infoCache.count = count;
+		infoCache.humans = humans;
+	}
+
+	if ( infoCache.valid ) {
+		NET_OutOfBandPrint( NS_SERVER, from, "infoResponse\n%s%s", infoCache.infostring, challenge );
+		return;
 	}
 
-	NET_OutOfBandPrint( NS_SERVER, from, "infoResponse\n%s", infostring );
+	SV_InfoString( challenge, count, humans );
+	NET_OutOfBandPrint( NS_SERVER, from, "infoResponse\n%s", challenge );
 }
 
 /*
@@ -801,6 +1018,7 @@ void SV_PacketEvent( netadr_t from, msg_t *msg ) {
 	int			i;
 	client_t	*cl;
 	int			qport;
+	PROFILE_SCOPE( PROF_PACKETEVENT );
 
 	// check for connectionless packet (0xffffffff) first
 	if ( msg->cursize >= 4 && *(int *)msg->data == -1) {
@@ -1299,16 +1517,23 @@ void SV_Frame( int msec ) {
 		time_game = Sys_Milliseconds () - startTime;
 	}
 
+	// everything sent from here on goes out together
+	NET_BeginSendBatch();
+
 	// check timeouts
 	SV_CheckTimeouts();
 
-	// send messages back to the clients
+	// send messages back to the clients, the game doesn't run in between
+	SV_BuildDuelTable();
 	SV_SendClientMessages();
+	SV_ClearDuelTable();
 
 	SV_CheckCvars();
 
 	// send a heartbeat to the master if needed
 	SV_MasterHeartbeat();
+
+	NET_FlushSendBatch();
 }
 
 //============================================================================
@@ -111,7 +111,7 @@ static void SV_Netchan_Decode( client_t *client, msg_t *msg ) {
         msg->bit = sbit;
         msg->readcount = srdc;
 
-	string = (byte *)client->reliableCommands[ reliableAcknowledge & (MAX_RELIABLE_COMMANDS-1) ];
+	string = (byte *)SV_ReliableCommand( client, reliableAcknowledge );
 	index = 0;
 	//
 	key = client->challenge ^ serverId ^ messageAcknowledge;
@@ -140,6 +140,7 @@ SV_Netchan_TransmitNextFragment
 =================
 */
 void SV_Netchan_TransmitNextFragment( netchan_t *chan ) {
+	PROFILE_SCOPE( PROF_NETSEND );
 	Netchan_TransmitNextFragment( chan );
 }
 
@@ -152,6 +153,7 @@ SV_Netchan_Transmit
 
 void SV_Netchan_Transmit( client_t *client, msg_t *msg) {	//int length, const byte *data ) {
 //	int i;
+	PROFILE_SCOPE( PROF_NETSEND );
 	MSG_WriteByte( msg, svc_EOF );
 //	for(i=SV_ENCODE_START;i<msg->cursize;i++) {
 //		chksum[i-SV_ENCODE_START] = msg->data[i];
@@ -24,6 +24,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "server.h"
 #include "qcommon/cm_public.h"
 
+#include <vector>
+
 /*
 =============================================================================
 
@@ -46,6 +48,153 @@ A normal server packet will look like:
 =============================================================================
 */
 
+/*
+=============================================================================
+
+Entity delta cache
+
+Clients that acked the same old state of an entity get the very same delta
+for it. The netchan Huffman tree is fixed, so the encoded bits don't depend
+on the message they end up in: the first client encodes the delta, the
+rest of the frame just copies the bits. Entries are found by entity number
+and compared in full, so a hit is always the exact same delta.
+
+=============================================================================
+*/
+
+#define	DELTA_CACHE_ENTRIES		2048
+#define	DELTA_CACHE_BYTES		(512*1024)
+#define	DELTA_CACHE_CHAIN		8		// states of one entity looked at
+#define	DELTA_MAX_BYTES			1024	// one encoded entity delta
+
+typedef struct deltaCacheEntry_s {
+	entityState_t	from;
+	entityState_t	to;
+	qboolean		force;
+	int				data;		// into deltaCache.data
+	int				numBits;
+	int				next;		// same entity number, -1 ends
+} deltaCacheEntry_t;
+
+static struct {
+	qboolean			active;		// this frame
+	int					first[MAX_GENTITIES];
+	int					numEntries;
+	int					numBytes;
+	int					frameHits, frameMisses, frameFull;
+	int64_t				hits, misses, full;
+	deltaCacheEntry_t	entries[DELTA_CACHE_ENTRIES];
+	byte				data[DELTA_CACHE_BYTES];
+} deltaCache;
+
+/*
+=============
+SV_ClearDeltaCache
+
+Starts a new frame, the cache only pays off with more than one client.
+=============
+*/
+static void SV_ClearDeltaCache( int numClients ) {
+	deltaCache.hits += deltaCache.frameHits;
+	deltaCache.misses += deltaCache.frameMisses;
+	deltaCache.full += deltaCache.frameFull;
+
+	memset( deltaCache.first, -1, sizeof( deltaCache.first ) );
+	deltaCache.numEntries = 0;
+	deltaCache.numBytes = 0;
+	deltaCache.frameHits = deltaCache.frameMisses = deltaCache.frameFull = 0;
+	deltaCache.active = (qboolean)( sv_deltaCache->integer && numClients > 1 );
+}
+
+/*
+=============
+SV_WriteDeltaEntity
+
+MSG_WriteDeltaEntity through the delta cache.
+=============
+*/
+static void SV_WriteDeltaEntity( msg_t *msg, entityState_t *from, entityState_t *to, qboolean force ) {
+	static byte			buffer[DELTA_MAX_BYTES];
+	deltaCacheEntry_t	*entry;
+	msg_t				scratch;
+	int					i, chain, bytes;
+
+	// removes are only a few bits, and nothing is written for unchanged ones
+	if ( !deltaCache.active || !to || msg->overflowed
+		|| ( !force && !memcmp( from, to, sizeof( *to ) ) ) ) {
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return;
+	}
+
+	chain = 0;
+	for ( i = deltaCache.first[to->number]; i != -1; i = entry->next, chain++ ) {
+		entry = &deltaCache.entries[i];
+		if ( entry->force == force && !memcmp( &entry->to, to, sizeof( *to ) )
+			&& !memcmp( &entry->from, from, sizeof( *from ) ) ) {
+			break;
+		}
+	}
+
+	if ( i == -1 ) {
+		// encode it once on its own
+		deltaCache.frameMisses++;
+		MSG_Init( &scratch, buffer, sizeof( buffer ) );
+		MSG_WriteDeltaEntity( &scratch, from, to, force );
+		bytes = ( scratch.bit + 7 ) >> 3;
+
+		if ( chain >= DELTA_CACHE_CHAIN || scratch.overflowed
+			|| deltaCache.numEntries == DELTA_CACHE_ENTRIES
+			|| deltaCache.numBytes + bytes > DELTA_CACHE_BYTES ) {
+			deltaCache.frameFull++;
+			MSG_WriteDeltaEntity( msg, from, to, force );
+			return;
+		}
+
+		i = deltaCache.numEntries++;
+		entry = &deltaCache.entries[i];
+		entry->from = *from;
+		entry->to = *to;
+		entry->force = force;
+		entry->data = deltaCache.numBytes;
+		entry->numBits = scratch.bit;
+		entry->next = deltaCache.first[to->number];
+		deltaCache.first[to->number] = i;
+
+		// the bits past the end of the last byte are 0 already
+		Com_Memcpy( deltaCache.data + entry->data, buffer, bytes );
+		deltaCache.numBytes += bytes;
+	} else {
+		deltaCache.frameHits++;
+	}
+
+	// MSG_WriteBits overflows part of the way through, only copy what fits
+	if ( msg->bit + entry->numBits > msg->maxsize << 3 ) {
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return;
+	}
+	MSG_WriteBitString( msg, deltaCache.data + entry->data, entry->numBits );
+}
+
+/*
+=============
+SV_DeltaCacheStatus_f
+=============
+*/
+void SV_DeltaCacheStatus_f( void ) {
+	const int64_t total = deltaCache.hits + deltaCache.misses;
+
+	if ( !sv_deltaCache->integer ) {
+		Com_Printf( "sv_deltaCache is off\n" );
+	}
+
+	Com_Printf( "last frame: %i hits, %i misses, %i not cached, %i entries, %i KB\n",
+		deltaCache.frameHits, deltaCache.frameMisses, deltaCache.frameFull,
+		deltaCache.numEntries, deltaCache.numBytes / 1024 );
+	Com_Printf( "total: %lld hits, %lld misses, %lld not cached, %.1f%% hit rate\n",
+		(long long)deltaCache.hits, (long long)deltaCache.misses, (long long)deltaCache.full,
+		total ? deltaCache.hits * 100.0 / total : 0.0 );
+}
+
 /*
 =============
 SV_EmitPacketEntities
@@ -89,7 +238,7 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 			// delta update from old position
 			// because the force parm is qfalse, this will not result
 			// in any bytes being emited if the entity has not changed at all
-			MSG_WriteDeltaEntity (msg, oldent, newent, qfalse );
+			SV_WriteDeltaEntity (msg, oldent, newent, qfalse );
 			oldindex++;
 			newindex++;
 			continue;
@@ -97,7 +246,7 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 
 		if ( newnum < oldnum ) {
 			// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity (msg, &sv.svEntities[newnum].baseline, newent, qtrue );
+			SV_WriteDeltaEntity (msg, &sv.svEntities[newnum].baseline, newent, qtrue );
 			newindex++;
 			continue;
 		}
@@ -126,6 +275,7 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 	int					i;
 	int					snapFlags;
 	int					deltaMessage;
+	PROFILE_SCOPE( PROF_DELTAENCODE );
 
 	// this is the snapshot we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
@@ -301,7 +451,7 @@ void SV_UpdateServerCommandsToClient( client_t *client, msg_t *msg ) {
 	for ( i = reliableAcknowledge + 1 ; i <= client->reliableSequence ; i++ ) {
 		MSG_WriteByte( msg, svc_serverCommand );
 		MSG_WriteLong( msg, i );
-		MSG_WriteString( msg, client->reliableCommands[ i & (MAX_RELIABLE_COMMANDS-1) ] );
+		MSG_WriteString( msg, SV_ReliableCommand( client, i ) );
 	}
 	client->reliableSent = client->reliableSequence;
 }
@@ -317,6 +467,7 @@ Build a client snapshot structure
 typedef struct snapshotEntityNumbers_s {
 	int		numSnapshotEntities;
 	int		snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	byte	added[MAX_GENTITIES/8];		// used to prevent double adding from portal views
 } snapshotEntityNumbers_t;
 
 /*
@@ -347,22 +498,175 @@ static int QDECL SV_QsortEntityNumbers( const void *a, const void *b ) {
 SV_AddEntToSnapshot
 ===============
 */
-static void SV_AddEntToSnapshot( svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
+static void SV_AddEntToSnapshot( sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
+	const int num = gEnt->s.number;
+
 	// if we have already added this entity to this snapshot, don't add again
-	if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+	if ( eNums->added[num >> 3] & (1 << (num & 7)) ) {
 		return;
 	}
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	eNums->added[num >> 3] |= 1 << (num & 7);
 
 	// if we are full, silently discard entities
 	if ( eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES ) {
 		return;
 	}
 
-	eNums->snapshotEntities[ eNums->numSnapshotEntities ] = gEnt->s.number;
+	eNums->snapshotEntities[ eNums->numSnapshotEntities ] = num;
 	eNums->numSnapshotEntities++;
 }
 
+/*
+=============================================================================
+
+Most of what SV_AddEntitiesVisibleFromPoint checks doesn't depend on who is
+looking, so SV_BuildSnapshotVis sorts the entities once per frame. Every
+occupied PVS cluster gets a bitset of the entities touching it. Entities
+that can be sent without being in the PVS, events, which are counted before
+the PVS check, and entities with more clusters than clusternums holds go on
+the always list. Everything else is never sent and left out.
+
+A viewpoint ORs together the sets of the clusters its PVS sees and the
+always list, and only walks the entities in that. All the other checks still
+run on those, in entity order as before, only the cluster loop is skipped
+for entities that came in through a visible cluster.
+
+=============================================================================
+*/
+
+#define VIS_WORDS	(MAX_GENTITIES/32)
+
+typedef struct visCluster_s {
+	int			cluster;
+	uint32_t	entities[VIS_WORDS];
+} visCluster_t;
+
+static struct {
+	qboolean					valid;
+	uint32_t					always[VIS_WORDS];
+	uint32_t					clustered[VIS_WORDS];	// in the cluster sets
+	std::vector<visCluster_t>	clusters;				// the first numClusters are in use
+	int							numClusters;
+	std::vector<int>			clusterIndex;			// cluster -> clusters or -1
+} snapshotVis;
+
+static visCluster_t *SV_VisCluster( int cluster ) {
+	visCluster_t *vc;
+
+	if ( cluster >= (int)snapshotVis.clusterIndex.size() ) {
+		snapshotVis.clusterIndex.resize( cluster + 1, -1 );
+	}
+
+	if ( snapshotVis.clusterIndex[cluster] >= 0 ) {
+		return &snapshotVis.clusters[snapshotVis.clusterIndex[cluster]];
+	}
+
+	if ( snapshotVis.numClusters == (int)snapshotVis.clusters.size() ) {
+		snapshotVis.clusters.resize( snapshotVis.numClusters + 64 );
+	}
+	snapshotVis.clusterIndex[cluster] = snapshotVis.numClusters;
+	vc = &snapshotVis.clusters[snapshotVis.numClusters++];
+	vc->cluster = cluster;
+	Com_Memset( vc->entities, 0, sizeof( vc->entities ) );
+	return vc;
+}
+
+/*
+=============
+SV_BuildSnapshotVis
+
+Sorts the entities for this frame's snapshots. The game may not run until
+SV_ClearSnapshotVis.
+=============
+*/
+static void SV_BuildSnapshotVis( void ) {
+	int				e, i;
+	sharedEntity_t	*ent;
+	svEntity_t		*svEnt;
+	uint32_t		bit;
+
+	for ( i = 0 ; i < snapshotVis.numClusters ; i++ ) {
+		snapshotVis.clusterIndex[snapshotVis.clusters[i].cluster] = -1;
+	}
+	snapshotVis.numClusters = 0;
+	Com_Memset( snapshotVis.always, 0, sizeof( snapshotVis.always ) );
+	Com_Memset( snapshotVis.clustered, 0, sizeof( snapshotVis.clustered ) );
+
+	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		ent = SV_GentityNum(e);
+		bit = 1u << (e & 31);
+
+		if ( !ent->r.linked || (ent->s.eFlags & EF_PERMANENT) ) {
+			continue;
+		}
+
+		// SV_AddEntitiesVisibleFromPoint fixes these as it goes, the
+		// snapshot jobs can't
+		if ( ent->s.number != e ) {
+			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
+			ent->s.number = e;
+		}
+
+		if ( ent->r.svFlags & SVF_NOCLIENT ) {
+			continue;
+		}
+
+		svEnt = &sv.svEntities[e];
+
+		if ( (ent->r.svFlags & SVF_BROADCAST) || ent->s.isPortalEnt
+			|| ent->r.broadcastClients[0] || ent->r.broadcastClients[1]
+			|| ent->s.eType >= ET_EVENTS || svEnt->lastCluster )
+		{
+			snapshotVis.always[e >> 5] |= bit;
+			continue;
+		}
+
+		if ( !svEnt->numClusters ) {
+			continue;
+		}
+
+		snapshotVis.clustered[e >> 5] |= bit;
+		for ( i = 0 ; i < svEnt->numClusters ; i++ ) {
+			SV_VisCluster( svEnt->clusternums[i] )->entities[e >> 5] |= bit;
+		}
+	}
+
+	snapshotVis.valid = qtrue;
+}
+
+/*
+=============
+SV_ClearSnapshotVis
+
+Once the game could have moved something, snapshots walk all entities again.
+=============
+*/
+static void SV_ClearSnapshotVis( void ) {
+	snapshotVis.valid = qfalse;
+}
+
+/*
+=============
+SV_SnapshotVisCandidates
+
+The entities worth checking from a viewpoint with this PVS.
+=============
+*/
+static void SV_SnapshotVisCandidates( const byte *pvs, uint32_t *candidates ) {
+	const visCluster_t	*vc;
+	int					i, j;
+
+	Com_Memcpy( candidates, snapshotVis.always, sizeof( snapshotVis.always ) );
+
+	for ( i = 0, vc = snapshotVis.clusters.data() ; i < snapshotVis.numClusters ; i++, vc++ ) {
+		if ( pvs[vc->cluster >> 3] & (1 << (vc->cluster & 7)) ) {
+			for ( j = 0 ; j < VIS_WORDS ; j++ ) {
+				candidates[j] |= vc->entities[j];
+			}
+		}
+	}
+}
+
 /*
 ===============
 SV_AddEntitiesVisibleFromPoint
@@ -388,6 +692,8 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 	vec3_t	difference;
 	float	length, radius;
 	int		effectCount = 0;
+	uint32_t	candidates[VIS_WORDS];
+	const qboolean	useVis = snapshotVis.valid;
 
 	// during an error shutdown message we may need to transmit
 	// the shutdown message after the server has shutdown, so
@@ -405,7 +711,18 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 
 	clientpvs = CM_ClusterPVS (clientcluster);
 
+	if ( useVis ) {
+		SV_SnapshotVisCandidates( clientpvs, candidates );
+	}
+
 	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		if ( useVis && !(candidates[e >> 5] & (1u << (e & 31))) ) {
+			if ( !candidates[e >> 5] ) {
+				e |= 31;	// skip the rest of the word
+			}
+			continue;
+		}
+
 		ent = SV_GentityNum(e);
 
 		// never send entities that aren't linked in
@@ -469,7 +786,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		svEnt = SV_SvEntityForGentity( ent );
 
 		// don't double add an entity through portals
-		if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+		if ( eNums->added[e >> 3] & (1 << (e & 7)) ) {
 			continue;
 		}
 
@@ -483,13 +800,13 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		if ( (ent->r.svFlags & SVF_BROADCAST) || e == frame->ps.clientNum
 			|| (ent->r.broadcastClients[frame->ps.clientNum/32] & (1 << (frame->ps.clientNum % 32))) )
 		{
-			SV_AddEntToSnapshot( svEnt, ent, eNums );
+			SV_AddEntToSnapshot( ent, eNums );
 			continue;
 		}
 
 		if (ent->s.isPortalEnt)
 		{ //rww - portal entities are always sent as well
-			SV_AddEntToSnapshot( svEnt, ent, eNums );
+			SV_AddEntToSnapshot( ent, eNums );
 			continue;
 		}
 
@@ -505,32 +822,35 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 
 		bitvector = clientpvs;
 
-		// check individual leafs
-		if ( !svEnt->numClusters ) {
-			continue;
-		}
-		l = 0;
-		for ( i=0 ; i < svEnt->numClusters ; i++ ) {
-			l = svEnt->clusternums[i];
-			if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
-				break;
+		// came in through one of the visible clusters
+		if ( !useVis || !(snapshotVis.clustered[e >> 5] & (1u << (e & 31))) ) {
+			// check individual leafs
+			if ( !svEnt->numClusters ) {
+				continue;
+			}
+			l = 0;
+			for ( i=0 ; i < svEnt->numClusters ; i++ ) {
+				l = svEnt->clusternums[i];
+				if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
+					break;
+				}
 			}
-		}
 
-		// if we haven't found it to be visible,
-		// check overflow clusters that coudln't be stored
-		if ( i == svEnt->numClusters ) {
-			if ( svEnt->lastCluster ) {
-				for ( ; l <= svEnt->lastCluster ; l++ ) {
-					if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
-						break;
+			// if we haven't found it to be visible,
+			// check overflow clusters that coudln't be stored
+			if ( i == svEnt->numClusters ) {
+				if ( svEnt->lastCluster ) {
+					for ( ; l <= svEnt->lastCluster ; l++ ) {
+						if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
+							break;
+						}
 					}
+					if ( l == svEnt->lastCluster ) {
+						continue;	// not visible
+					}
+				} else {
+					continue;
 				}
-				if ( l == svEnt->lastCluster ) {
-					continue;	// not visible
-				}
-			} else {
-				continue;
 			}
 		}
 
@@ -551,7 +871,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		}
 
 		// add it
-		SV_AddEntToSnapshot( svEnt, ent, eNums );
+		SV_AddEntToSnapshot( ent, eNums );
 
 		// if its a portal entity, add everything visible from its camera position
 		if ( ent->r.svFlags & SVF_PORTAL ) {
@@ -574,6 +894,180 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		Com_Printf("Snapshot: numEffects = %i\n", effectCount);
 }
 
+/*
+=============
+SV_FindSnapshotEntities
+
+Fills in the areabits and the sorted entity numbers for frame->ps, which has
+to be set already with a valid clientNum. Doesn't write to anything else,
+so it is safe to run on a worker.
+=============
+*/
+static void SV_FindSnapshotEntities( client_t *client, clientSnapshot_t *frame, snapshotEntityNumbers_t *entityNumbers ) {
+	vec3_t	org;
+	int		i;
+	int		clientNum;
+
+	// clear everything in this snapshot
+	entityNumbers->numSnapshotEntities = 0;
+	Com_Memset( entityNumbers->added, 0, sizeof( entityNumbers->added ) );
+	Com_Memset( frame->areabits, 0, sizeof( frame->areabits ) );
+
+	// never send client's own entity, because it can
+	// be regenerated from the playerstate
+	clientNum = frame->ps.clientNum;
+	entityNumbers->added[clientNum >> 3] |= 1 << (clientNum & 7);
+
+	// find the client's viewpoint
+	VectorCopy( frame->ps.origin, org );
+	org[2] += frame->ps.viewheight;
+
+	// add all the entities directly visible to the eye, which
+	// may include portal entities that merge other viewpoints
+#ifndef DEDICATED
+	SV_AddEntitiesVisibleFromPoint( org, frame, entityNumbers, qfalse );
+#else
+	SV_AddEntitiesVisibleFromPoint( org, frame, entityNumbers, qfalse, client->disableDuelCull );
+#endif
+
+	// if there were portals visible, there may be out of order entities
+	// in the list which will need to be resorted for the delta compression
+	// to work correctly.  This also catches the error condition
+	// of an entity being included twice.
+	for ( i = 1 ; i < entityNumbers->numSnapshotEntities ; i++ ) {
+		if ( entityNumbers->snapshotEntities[i - 1] >= entityNumbers->snapshotEntities[i] ) {
+			qsort( entityNumbers->snapshotEntities, entityNumbers->numSnapshotEntities,
+				sizeof( entityNumbers->snapshotEntities[0] ), SV_QsortEntityNumbers );
+			break;
+		}
+	}
+
+	// now that all viewpoint's areabits have been OR'd together, invert
+	// all of them to make it a mask vector, which is what the renderer wants
+	for ( i = 0 ; i < MAX_MAP_AREA_BYTES/4 ; i++ ) {
+		((int *)frame->areabits)[i] = ((int *)frame->areabits)[i] ^ -1;
+	}
+}
+
+/*
+=============================================================================
+
+Snapshots of the clients that are due get their entities found on the
+sv_jobThreads workers before any of them are sent, see SV_BuildSnapshotJobs.
+Sending stays on the main thread in client order: SV_BuildClientSnapshot
+picks up the job, copies the entity states to svs.snapshotEntities and the
+message is encoded as before, so it comes out exactly as if the snapshot had
+been built right before it was sent.
+
+=============================================================================
+*/
+
+typedef struct snapshotJob_s {
+	qboolean				built;
+	clientSnapshot_t		frame;		// only the playerState and the areabits
+	snapshotEntityNumbers_t	entityNumbers;
+} snapshotJob_t;
+
+static snapshotJob_t	snapshotJobs[MAX_CLIENTS];
+
+static void SV_SnapshotJob( int job, void *data ) {
+	const int		clientNum = ((const int *)data)[job];
+	client_t		*client = &svs.clients[clientNum];
+	snapshotJob_t	*sj = &snapshotJobs[clientNum];
+
+	sj->frame.ps = *SV_GameClientNum( clientNum );
+
+	// SV_BuildClientSnapshot drops the server for this one
+	if ( sj->frame.ps.clientNum < 0 || sj->frame.ps.clientNum >= MAX_GENTITIES ) {
+		return;
+	}
+
+	SV_FindSnapshotEntities( client, &sj->frame, &sj->entityNumbers );
+	sj->built = qtrue;
+}
+
+/*
+=============
+SV_BuildSnapshotJobs
+
+Finds the entities of every client that is going to get a snapshot this
+frame on the job threads. Nothing may change the game in between, see
+SV_ClearSnapshotJobs. Needs SV_BuildSnapshotVis first, which leaves nothing
+for the workers to fix up.
+=============
+*/
+static void SV_BuildSnapshotJobs( void ) {
+	int			jobClients[MAX_CLIENTS];
+	int			numJobs = 0;
+	int			i;
+	client_t	*c;
+
+	if ( !snapshotVis.valid || !com_dedicated->integer || !SV_Jobs_Threads() ) {
+		return;
+	}
+
+	// same as SV_SendClientMessages
+	for ( i = 0, c = svs.clients ; i < sv_maxclients->integer ; i++, c++ ) {
+		if ( !c->state || c->state == CS_ZOMBIE || !c->gentity ) {
+			continue;
+		}
+		if ( svs.time < c->nextSnapshotTime || c->netchan.unsentFragments ) {
+			continue;
+		}
+		jobClients[numJobs++] = i;
+	}
+
+	if ( numJobs < 2 ) {
+		return;
+	}
+
+	SV_Jobs_Run( SV_SnapshotJob, jobClients, numJobs );
+}
+
+/*
+=============
+SV_ClearSnapshotJobs
+
+Throws away the entities found ahead of time once the game could have
+changed, the snapshots are built on the spot again.
+=============
+*/
+static void SV_ClearSnapshotJobs( void ) {
+	int i;
+
+	for ( i = 0 ; i < MAX_CLIENTS ; i++ ) {
+		snapshotJobs[i].built = qfalse;
+	}
+}
+
+/*
+=============
+SV_VerifySnapshot
+
+sv_snapshotVerify, finds the entities again on the main thread walking all
+of them and complains if the job or the pre-pass got anything else.
+=============
+*/
+static void SV_VerifySnapshot( client_t *client, const clientSnapshot_t *found, const snapshotEntityNumbers_t *foundNumbers ) {
+	static clientSnapshot_t			frame;
+	static snapshotEntityNumbers_t	entityNumbers;
+	const qboolean					visValid = snapshotVis.valid;
+
+	frame.ps = found->ps;
+	snapshotVis.valid = qfalse;
+	SV_FindSnapshotEntities( client, &frame, &entityNumbers );
+	snapshotVis.valid = visValid;
+
+	if ( frame.areabytes != found->areabytes
+		|| memcmp( frame.areabits, found->areabits, sizeof( frame.areabits ) )
+		|| entityNumbers.numSnapshotEntities != foundNumbers->numSnapshotEntities
+		|| memcmp( entityNumbers.snapshotEntities, foundNumbers->snapshotEntities, entityNumbers.numSnapshotEntities * sizeof( entityNumbers.snapshotEntities[0] ) ) )
+	{
+		Com_Printf( S_COLOR_YELLOW "WARNING: snapshot of %s" S_COLOR_YELLOW " differs from a full walk, %i entities instead of %i\n",
+			client->name, foundNumbers->numSnapshotEntities, entityNumbers.numSnapshotEntities );
+	}
+}
+
 /*
 =============
 SV_BuildClientSnapshot
@@ -588,24 +1082,27 @@ For viewing through other player's eyes, client can be something other than clie
 =============
 */
 static void SV_BuildClientSnapshot( client_t *client ) {
-	vec3_t						org;
 	clientSnapshot_t			*frame;
-	snapshotEntityNumbers_t		entityNumbers;
+	snapshotEntityNumbers_t		localNumbers;
+	snapshotEntityNumbers_t		*entityNumbers;
+	snapshotJob_t				*sj;
+	qboolean					built;
 	int							i;
 	sharedEntity_t				*ent;
 	entityState_t				*state;
-	svEntity_t					*svEnt;
 	sharedEntity_t				*clent;
 	playerState_t				*ps;
+	PROFILE_SCOPE( PROF_SNAPSHOT );
 
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
+	// entities found ahead of time by SV_BuildSnapshotJobs
+	sj = &snapshotJobs[client - svs.clients];
+	built = sj->built;
+	sj->built = qfalse;
 
 	// this is the frame we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
 	Com_Memset( frame->areabits, 0, sizeof( frame->areabits ) );
 
 	frame->num_entities = 0;
@@ -639,47 +1136,28 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 		}
 	}
 
-	int							clientNum;
-	// never send client's own entity, because it can
-	// be regenerated from the playerstate
-	clientNum = frame->ps.clientNum;
-	if ( clientNum < 0 || clientNum >= MAX_GENTITIES ) {
+	if ( frame->ps.clientNum < 0 || frame->ps.clientNum >= MAX_GENTITIES ) {
 		Com_Error( ERR_DROP, "SV_SvEntityForGentity: bad gEnt" );
 	}
-	svEnt = &sv.svEntities[ clientNum ];
-	svEnt->snapshotCounter = sv.snapshotCounter;
-
-
-	// find the client's viewpoint
-	VectorCopy( ps->origin, org );
-	org[2] += ps->viewheight;
 
-	// add all the entities directly visible to the eye, which
-	// may include portal entities that merge other viewpoints
-#ifndef DEDICATED
-	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers, qfalse );
-#else
-	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers, qfalse, client->disableDuelCull );
-#endif
-
-	// if there were portals visible, there may be out of order entities
-	// in the list which will need to be resorted for the delta compression
-	// to work correctly.  This also catches the error condition
-	// of an entity being included twice.
-	qsort( entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities,
-		sizeof( entityNumbers.snapshotEntities[0] ), SV_QsortEntityNumbers );
+	if ( built ) {
+		entityNumbers = &sj->entityNumbers;
+		frame->areabytes = sj->frame.areabytes;
+		Com_Memcpy( frame->areabits, sj->frame.areabits, sizeof( frame->areabits ) );
+	} else {
+		entityNumbers = &localNumbers;
+		SV_FindSnapshotEntities( client, frame, entityNumbers );
+	}
 
-	// now that all viewpoint's areabits have been OR'd together, invert
-	// all of them to make it a mask vector, which is what the renderer wants
-	for ( i = 0 ; i < MAX_MAP_AREA_BYTES/4 ; i++ ) {
-		((int *)frame->areabits)[i] = ((int *)frame->areabits)[i] ^ -1;
+	if ( sv_snapshotVerify->integer && (built || snapshotVis.valid) ) {
+		SV_VerifySnapshot( client, frame, entityNumbers );
 	}
 
 	// copy the entity states out
 	frame->num_entities = 0;
 	frame->first_entity = svs.nextSnapshotEntities;
-	for ( i = 0 ; i < entityNumbers.numSnapshotEntities ; i++ ) {
-		ent = SV_GentityNum(entityNumbers.snapshotEntities[i]);
+	for ( i = 0 ; i < entityNumbers->numSnapshotEntities ; i++ ) {
+		ent = SV_GentityNum(entityNumbers->snapshotEntities[i]);
 		state = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
 		*state = ent->s;
 #ifdef DEDICATED
@@ -928,6 +1406,20 @@ SV_SendClientMessages
 void SV_SendClientMessages( void ) {
 	int			i;
 	client_t	*c;
+	int			state;
+	int			numClients;
+
+	for ( i=0, c = svs.clients, numClients = 0 ; i < sv_maxclients->integer ; i++, c++ ) {
+		if ( c->state == CS_ACTIVE && svs.time >= c->nextSnapshotTime ) {
+			numClients++;
+		}
+	}
+	SV_ClearDeltaCache( numClients );
+
+	if ( sv.state ) {
+		SV_BuildSnapshotVis();
+		SV_BuildSnapshotJobs();
+	}
 
 	// send a message to each connected client
 	for (i=0, c = svs.clients ; i < sv_maxclients->integer ; i++, c++) {
@@ -949,7 +1441,19 @@ void SV_SendClientMessages( void ) {
 		}
 
 		// generate and send a new message
+		state = c->state;
 		SV_SendClientSnapshot( c );
+
+		// dropped, the game saw it disconnect and may have ended a duel
+		// or freed entities
+		if ( c->state == CS_ZOMBIE && state != CS_ZOMBIE ) {
+			SV_ClearSnapshotJobs();
+			SV_ClearSnapshotVis();
+			SV_BuildDuelTable();
+		}
 	}
+
+	SV_ClearSnapshotJobs();
+	SV_ClearSnapshotVis();
 }
 
@@ -62,21 +62,43 @@ the world is carved up with an evenly spaced, axially aligned bsp tree.  Entitie
 are kept in chains either at the final leafs, or at the first node that splits
 them, which prevents having to deal with multiple fragments of a single entity.
 
+The tree starts out as deep as it takes to get the leafs down to sv_sectorSize,
+so big maps get more sectors than small ones, and leafs that collect more than
+AREA_SPLIT_ENTITIES entities are split again while the map runs. The children
+of a node overlap by an eighth of the node on either side of the split, so an
+entity only stays at a node if it is wide compared to it, instead of whenever
+it touches the split. sv_sectorSize 0 is the old fixed tree of 16 leafs.
+
 ===============================================================================
 */
 
 typedef struct worldSector_s {
 	int		axis;		// -1 = leaf node
 	float	dist;
+	float	loose;		// children reach this far past dist
+	int		depth;
+	vec3_t	mins, maxs;
 	struct worldSector_s	*children[2];
 	svEntity_t	*entities;
+	int		numEntities;
 } worldSector_t;
 
-#define	AREA_DEPTH	4
-#define	AREA_NODES	64
+#define	AREA_DEPTH			4		// sv_sectorSize 0
+#define	AREA_START_DEPTH	8		// deepest the tree starts out
+#define	AREA_MAX_DEPTH		16
+#define	AREA_NODES			4096
+#define	AREA_LOOSE_FRACTION	0.125f
+#define	AREA_SPLIT_ENTITIES	16
+#define	AREA_MIN_SIZE		128.0f	// leafs aren't split below this
 
 worldSector_t	sv_worldSectors[AREA_NODES];
 int			sv_numworldSectors;
+static qboolean	sv_worldSectorsAdaptive;
+
+// SV_AreaEntities statistics since the map was loaded, see sectorlist
+static int		sv_areaQueries;
+static int64_t	sv_areaCandidates;		// entities looked at
+static int64_t	sv_areaMatches;		// entities returned
 
 
 /*
@@ -85,61 +107,106 @@ SV_SectorList_f
 ===============
 */
 void SV_SectorList_f( void ) {
-	int				i, c;
+	int				i, linked = 0, leafs = 0, maxDepth = 0, maxEntities = 0, inNodes = 0;
 	worldSector_t	*sec;
-	svEntity_t		*ent;
 
-	for ( i = 0 ; i < AREA_NODES ; i++ ) {
+	if ( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		sv_areaQueries = 0;
+		sv_areaCandidates = sv_areaMatches = 0;
+		Com_Printf( "Sector statistics reset\n" );
+		return;
+	}
+
+	for ( i = 0 ; i < sv_numworldSectors ; i++ ) {
 		sec = &sv_worldSectors[i];
 
-		c = 0;
-		for ( ent = sec->entities ; ent ; ent = ent->nextEntityInWorldSector ) {
-			c++;
+		if ( sec->axis == -1 ) {
+			leafs++;
+		} else {
+			inNodes += sec->numEntities;
+		}
+		maxDepth = Q_max( maxDepth, sec->depth );
+		maxEntities = Q_max( maxEntities, sec->numEntities );
+		linked += sec->numEntities;
+
+		if ( sec->numEntities ) {
+			Com_Printf( "sector %i: %i entities%s\n", i, sec->numEntities, sec->axis == -1 ? "" : " (node)" );
 		}
-		Com_Printf( "sector %i: %i entities\n", i, c );
+	}
+
+	Com_Printf( "%i sectors, %i leafs, depth %i\n", sv_numworldSectors, leafs, maxDepth );
+	Com_Printf( "%i linked entities, %i above the leafs, at most %i in a sector\n", linked, inNodes, maxEntities );
+	if ( sv_areaQueries ) {
+		Com_Printf( "%i area queries, %.1f candidates and %.1f matches per query\n", sv_areaQueries,
+			(double)sv_areaCandidates / sv_areaQueries, (double)sv_areaMatches / sv_areaQueries );
 	}
 }
 
+static worldSector_t *SV_AllocworldSector( int depth, const vec3_t mins, const vec3_t maxs ) {
+	worldSector_t	*anode;
+
+	anode = &sv_worldSectors[sv_numworldSectors];
+	sv_numworldSectors++;
+
+	anode->axis = -1;
+	anode->depth = depth;
+	VectorCopy( mins, anode->mins );
+	VectorCopy( maxs, anode->maxs );
+	anode->children[0] = anode->children[1] = NULL;
+
+	return anode;
+}
+
 /*
 ===============
-SV_CreateworldSector
+SV_DivideworldSector
 
-Builds a uniformly subdivided tree for the given world size
+Turns a leaf into a node with two new leafs
 ===============
 */
-worldSector_t *SV_CreateworldSector( int depth, vec3_t mins, vec3_t maxs ) {
-	worldSector_t	*anode;
+static void SV_DivideworldSector( worldSector_t *anode ) {
 	vec3_t		size;
 	vec3_t		mins1, maxs1, mins2, maxs2;
 
-	anode = &sv_worldSectors[sv_numworldSectors];
-	sv_numworldSectors++;
-
-	if (depth == AREA_DEPTH) {
-		anode->axis = -1;
-		anode->children[0] = anode->children[1] = NULL;
-		return anode;
-	}
-
-	VectorSubtract (maxs, mins, size);
+	VectorSubtract (anode->maxs, anode->mins, size);
 	if (size[0] > size[1]) {
 		anode->axis = 0;
 	} else {
 		anode->axis = 1;
 	}
 
-	anode->dist = 0.5 * (maxs[anode->axis] + mins[anode->axis]);
-	VectorCopy (mins, mins1);
-	VectorCopy (mins, mins2);
-	VectorCopy (maxs, maxs1);
-	VectorCopy (maxs, maxs2);
+	anode->dist = 0.5 * (anode->maxs[anode->axis] + anode->mins[anode->axis]);
+	anode->loose = sv_worldSectorsAdaptive ? AREA_LOOSE_FRACTION * size[anode->axis] : 0.0f;
+	VectorCopy (anode->mins, mins1);
+	VectorCopy (anode->mins, mins2);
+	VectorCopy (anode->maxs, maxs1);
+	VectorCopy (anode->maxs, maxs2);
 
 	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
 
-	anode->children[0] = SV_CreateworldSector (depth+1, mins2, maxs2);
-	anode->children[1] = SV_CreateworldSector (depth+1, mins1, maxs1);
+	anode->children[0] = SV_AllocworldSector (anode->depth+1, mins2, maxs2);
+	anode->children[1] = SV_AllocworldSector (anode->depth+1, mins1, maxs1);
+}
 
-	return anode;
+/*
+===============
+SV_CreateworldSector
+
+Builds a uniformly subdivided tree for the given world size
+===============
+*/
+static void SV_CreateworldSector( worldSector_t *anode, float leafSize ) {
+	if ( leafSize > 0 ) {
+		if ( anode->depth == AREA_START_DEPTH || Q_max( anode->maxs[0] - anode->mins[0], anode->maxs[1] - anode->mins[1] ) <= leafSize ) {
+			return;
+		}
+	} else if ( anode->depth == AREA_DEPTH ) {
+		return;
+	}
+
+	SV_DivideworldSector( anode );
+	SV_CreateworldSector( anode->children[0], leafSize );
+	SV_CreateworldSector( anode->children[1], leafSize );
 }
 
 /*
@@ -154,48 +221,118 @@ void SV_ClearWorld( void ) {
 
 	Com_Memset( sv_worldSectors, 0, sizeof(sv_worldSectors) );
 	sv_numworldSectors = 0;
+	sv_worldSectorsAdaptive = sv_sectorSize->value > 0 ? qtrue : qfalse;
+	sv_areaQueries = 0;
+	sv_areaCandidates = sv_areaMatches = 0;
 
 	// get world map bounds
 	h = CM_InlineModel( 0 );
 	CM_ModelBounds( h, mins, maxs );
-	SV_CreateworldSector( 0, mins, maxs );
+	SV_CreateworldSector( SV_AllocworldSector( 0, mins, maxs ), sv_sectorSize->value );
 }
 
-
 /*
 ===============
-SV_UnlinkEntity
+SV_SectorForBounds
 
+The first world sector node that the box crosses
 ===============
 */
-void SV_UnlinkEntity( sharedEntity_t *gEnt ) {
-	svEntity_t		*ent;
-	svEntity_t		*scan;
-	worldSector_t	*ws;
+static worldSector_t *SV_SectorForBounds( worldSector_t *node, const vec3_t absmin, const vec3_t absmax ) {
+	while (1)
+	{
+		if (node->axis == -1)
+			break;
+		if ( absmin[node->axis] > node->dist - node->loose)
+			node = node->children[0];
+		else if ( absmax[node->axis] < node->dist + node->loose)
+			node = node->children[1];
+		else
+			break;		// crosses the node
+	}
 
-	ent = SV_SvEntityForGentity( gEnt );
+	return node;
+}
 
-	gEnt->r.linked = qfalse;
 
-	ws = ent->worldSector;
-	if ( !ws ) {
-		return;		// not linked in anywhere
+static void SV_UnlinkFromSector( svEntity_t *ent ) {
+	worldSector_t	*ws = ent->worldSector;
+
+	if ( ent->prevEntityInWorldSector ) {
+		ent->prevEntityInWorldSector->nextEntityInWorldSector = ent->nextEntityInWorldSector;
+	} else {
+		ws->entities = ent->nextEntityInWorldSector;
+	}
+	if ( ent->nextEntityInWorldSector ) {
+		ent->nextEntityInWorldSector->prevEntityInWorldSector = ent->prevEntityInWorldSector;
 	}
+	ws->numEntities--;
+
 	ent->worldSector = NULL;
+	ent->nextEntityInWorldSector = ent->prevEntityInWorldSector = NULL;
+}
 
-	if ( ws->entities == ent ) {
-		ws->entities = ent->nextEntityInWorldSector;
+static void SV_LinkToSector( svEntity_t *ent, worldSector_t *ws ) {
+	ent->worldSector = ws;
+	ent->prevEntityInWorldSector = NULL;
+	ent->nextEntityInWorldSector = ws->entities;
+	if ( ws->entities ) {
+		ws->entities->prevEntityInWorldSector = ent;
+	}
+	ws->entities = ent;
+	ws->numEntities++;
+}
+
+/*
+===============
+SV_SplitworldSector
+
+Divides a crowded leaf and moves its entities down where they fit
+===============
+*/
+static void SV_SplitworldSector( worldSector_t *ws ) {
+	svEntity_t		*ent, *next;
+
+	if ( !sv_worldSectorsAdaptive || ws->numEntities <= AREA_SPLIT_ENTITIES || ws->depth == AREA_MAX_DEPTH
+		|| sv_numworldSectors + 2 > AREA_NODES || Q_max( ws->maxs[0] - ws->mins[0], ws->maxs[1] - ws->mins[1] ) <= AREA_MIN_SIZE ) {
 		return;
 	}
 
-	for ( scan = ws->entities ; scan ; scan = scan->nextEntityInWorldSector ) {
-		if ( scan->nextEntityInWorldSector == ent ) {
-			scan->nextEntityInWorldSector = ent->nextEntityInWorldSector;
-			return;
+	SV_DivideworldSector( ws );
+
+	for ( ent = ws->entities ; ent ; ent = next ) {
+		const sharedEntity_t *gEnt = SV_GEntityForSvEntity( ent );
+		worldSector_t *node = SV_SectorForBounds( ws, gEnt->r.absmin, gEnt->r.absmax );
+
+		next = ent->nextEntityInWorldSector;
+		if ( node != ws ) {
+			SV_UnlinkFromSector( ent );
+			SV_LinkToSector( ent, node );
 		}
 	}
 
-	Com_Printf( "WARNING: SV_UnlinkEntity: not found in worldSector\n" );
+	SV_SplitworldSector( ws->children[0] );
+	SV_SplitworldSector( ws->children[1] );
+}
+
+/*
+===============
+SV_UnlinkEntity
+
+===============
+*/
+void SV_UnlinkEntity( sharedEntity_t *gEnt ) {
+	svEntity_t		*ent;
+
+	ent = SV_SvEntityForGentity( gEnt );
+
+	gEnt->r.linked = qfalse;
+
+	if ( !ent->worldSector ) {
+		return;		// not linked in anywhere
+	}
+
+	SV_UnlinkFromSector( ent );
 }
 
 
@@ -219,10 +356,6 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 
 	ent = SV_SvEntityForGentity( gEnt );
 
-	if ( ent->worldSector ) {
-		SV_UnlinkEntity( gEnt );	// unlink from old position
-	}
-
 	// encode the size into the entityState_t for client prediction
 	if ( gEnt->r.bmodel ) {
 		gEnt->s.solid = SOLID_BMODEL;		// a solid_box will never create this value
@@ -302,6 +435,7 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 	// if none of the leafs were inside the map, the
 	// entity is outside the world and can be considered unlinked
 	if ( !num_leafs ) {
+		SV_UnlinkEntity( gEnt );
 		return;
 	}
 
@@ -344,23 +478,19 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 	gEnt->r.linkcount++;
 
 	// find the first world sector node that the ent's box crosses
-	node = sv_worldSectors;
-	while (1)
-	{
-		if (node->axis == -1)
-			break;
-		if ( gEnt->r.absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if ( gEnt->r.absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
-			break;		// crosses the node
-	}
+	node = SV_SectorForBounds( sv_worldSectors, gEnt->r.absmin, gEnt->r.absmax );
 
-	// link it in
-	ent->worldSector = node;
-	ent->nextEntityInWorldSector = node->entities;
-	node->entities = ent;
+	// link it in, most moves stay in the same sector
+	if ( ent->worldSector != node ) {
+		if ( ent->worldSector ) {
+			SV_UnlinkFromSector( ent );
+		}
+		SV_LinkToSector( ent, node );
+
+		if ( node->axis == -1 ) {
+			SV_SplitworldSector( node );
+		}
+	}
 
 	gEnt->r.linked = qtrue;
 }
@@ -393,6 +523,8 @@ void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 	svEntity_t	*check, *next;
 	sharedEntity_t *gcheck;
 
+	sv_areaCandidates += node->numEntities;
+
 	for ( check = node->entities  ; check ; check = next ) {
 		next = check->nextEntityInWorldSector;
 
@@ -421,10 +553,10 @@ void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 	}
 
 	// recurse down both sides
-	if ( ap->maxs[node->axis] > node->dist ) {
+	if ( ap->maxs[node->axis] > node->dist - node->loose ) {
 		SV_AreaEntities_r ( node->children[0], ap );
 	}
-	if ( ap->mins[node->axis] < node->dist ) {
+	if ( ap->mins[node->axis] < node->dist + node->loose ) {
 		SV_AreaEntities_r ( node->children[1], ap );
 	}
 }
@@ -445,6 +577,9 @@ int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int
 
 	SV_AreaEntities_r( sv_worldSectors, &ap );
 
+	sv_areaQueries++;
+	sv_areaMatches += ap.count;
+
 	return ap.count;
 }
 
@@ -755,17 +890,27 @@ Ghoul2 Insert Start
 			}
 #endif
 
-			if (com_optvehtrace &&
-				com_optvehtrace->integer &&
-				touch->s.eType == ET_NPC &&
-				touch->s.NPC_class == CLASS_VEHICLE &&
-				touch->m_pVehicle)
-			{ //for vehicles cache the transform data.
-				re->G2API_CollisionDetectCache(G2Trace, *((CGhoul2Info_v *)touch->ghoul2), angles, touch->r.currentOrigin, sv.time, touch->s.number, clip->start, clip->end, touch->modelScale, G2VertSpaceServer, 0, clip->useLod, fRadius);
-			}
-			else
 			{
-				re->G2API_CollisionDetect(G2Trace, *((CGhoul2Info_v *)touch->ghoul2), angles, touch->r.currentOrigin, sv.time, touch->s.number, clip->start, clip->end, touch->modelScale, G2VertSpaceServer, 0, clip->useLod, fRadius);
+				PROFILE_SCOPE( PROF_G2COLLISION );
+#ifdef DEDICATED
+				if (sv_g2TraceCache->integer && re->ext.G2API_CollisionDetectTraceCache)
+				{ //reuse the transform data of earlier traces against this entity in the same frame
+					re->ext.G2API_CollisionDetectTraceCache(G2Trace, *((CGhoul2Info_v *)touch->ghoul2), angles, touch->r.currentOrigin, sv.time, touch->s.number, clip->start, clip->end, touch->modelScale, G2VertSpaceServer, 0, clip->useLod, fRadius);
+				}
+				else
+#endif
+				if (com_optvehtrace &&
+					com_optvehtrace->integer &&
+					touch->s.eType == ET_NPC &&
+					touch->s.NPC_class == CLASS_VEHICLE &&
+					touch->m_pVehicle)
+				{ //for vehicles cache the transform data.
+					re->G2API_CollisionDetectCache(G2Trace, *((CGhoul2Info_v *)touch->ghoul2), angles, touch->r.currentOrigin, sv.time, touch->s.number, clip->start, clip->end, touch->modelScale, G2VertSpaceServer, 0, clip->useLod, fRadius);
+				}
+				else
+				{
+					re->G2API_CollisionDetect(G2Trace, *((CGhoul2Info_v *)touch->ghoul2), angles, touch->r.currentOrigin, sv.time, touch->s.number, clip->start, clip->end, touch->modelScale, G2VertSpaceServer, 0, clip->useLod, fRadius);
+				}
 			}
 
 			tN = 0;
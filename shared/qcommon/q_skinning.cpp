@@ -0,0 +1,357 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#include "q_skinning.h"
+
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define SKIN_X86
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define SKIN_TARGET(x)
+		#define SKIN_INLINE static __forceinline
+	#else
+		// the rest of the build doesn't get to assume any of this
+		#define SKIN_TARGET(x) __attribute__((target(x)))
+		#define SKIN_INLINE static inline __attribute__((always_inline))
+	#endif
+	// sse2 is always there on x86_64, and leaving the target alone there lets
+	// the avx2 kernels inline the helpers instead of calling non-vex code
+	#if defined(__x86_64__) || defined(_M_X64)
+		#define SKIN_TARGET_SSE2
+	#else
+		#define SKIN_TARGET_SSE2 SKIN_TARGET("sse2")
+	#endif
+#endif
+
+/*
+==============================================================================
+
+SCALAR
+
+The reference the others are tested against, done in the same order as the
+loops they replaced.
+
+==============================================================================
+*/
+
+static void Skin_MultiplyMatrixScalar( float *out, const float *a, const float *b ) {
+	float res[12];
+	int i;
+
+	for ( i = 0; i < 3; i++ ) {
+		const float *row = a + i * 4;
+
+		res[i*4+0] = (row[0] * b[0]) + (row[1] * b[4]) + (row[2] * b[8]);
+		res[i*4+1] = (row[0] * b[1]) + (row[1] * b[5]) + (row[2] * b[9]);
+		res[i*4+2] = (row[0] * b[2]) + (row[1] * b[6]) + (row[2] * b[10]);
+		res[i*4+3] = (row[0] * b[3]) + (row[1] * b[7]) + (row[2] * b[11]) + row[3];
+	}
+
+	for ( i = 0; i < 12; i++ ) {
+		out[i] = res[i];
+	}
+}
+
+static void Skin_BlendMatrixScalar( float *out, const float *a, const float *b, float frac ) {
+	int i;
+
+	for ( i = 0; i < 12; i++ ) {
+		out[i] = frac * (a[i] - b[i]) + b[i];
+	}
+}
+
+static void Skin_SkinVertsScalar( float *out, int outStride, const skinVertex_t *verts, int numVerts,
+	const float * const *bones, const float *scale )
+{
+	int i, k;
+
+	for ( i = 0; i < numVerts; i++, verts++, out += outStride ) {
+		const float *p = verts->xyz;
+		float x = 0.0f, y = 0.0f, z = 0.0f;
+
+		for ( k = 0; k < verts->numWeights; k++ ) {
+			const float *m = bones[verts->bone[k]];
+			const float w = verts->weight[k];
+
+			x += w * ( m[0] * p[0] + m[1] * p[1] + m[2] * p[2] + m[3] );
+			y += w * ( m[4] * p[0] + m[5] * p[1] + m[6] * p[2] + m[7] );
+			z += w * ( m[8] * p[0] + m[9] * p[1] + m[10] * p[2] + m[11] );
+		}
+
+		out[0] = x * scale[0];
+		out[1] = y * scale[1];
+		out[2] = z * scale[2];
+	}
+}
+
+#ifdef SKIN_X86
+
+/*
+==============================================================================
+
+SSE2
+
+One row of a matrix per register. Skinning blends the bone matrices by
+weight first and transforms the vertex once, instead of transforming it by
+every bone.
+
+==============================================================================
+*/
+
+#define SKIN_SPLAT(v, i) _mm_shuffle_ps( (v), (v), _MM_SHUFFLE( i, i, i, i ) )
+
+SKIN_TARGET_SSE2
+static inline __m128 Skin_TranslationMask( void ) {
+	return _mm_castsi128_ps( _mm_set_epi32( -1, 0, 0, 0 ) );
+}
+
+SKIN_TARGET_SSE2
+static inline __m128 Skin_MultiplyRow( __m128 row, __m128 b0, __m128 b1, __m128 b2, __m128 mask ) {
+	__m128 r = _mm_mul_ps( SKIN_SPLAT( row, 0 ), b0 );
+	r = _mm_add_ps( r, _mm_mul_ps( SKIN_SPLAT( row, 1 ), b1 ) );
+	r = _mm_add_ps( r, _mm_mul_ps( SKIN_SPLAT( row, 2 ), b2 ) );
+	return _mm_add_ps( r, _mm_and_ps( SKIN_SPLAT( row, 3 ), mask ) );
+}
+
+// x, y and z of three rows times a point, the 4th lane is zero
+SKIN_TARGET_SSE2
+SKIN_INLINE __m128 Skin_DotRows( __m128 t0, __m128 t1, __m128 t2 ) {
+	__m128 t3 = _mm_setzero_ps();
+
+	_MM_TRANSPOSE4_PS( t0, t1, t2, t3 );
+	return _mm_add_ps( _mm_add_ps( t0, t1 ), _mm_add_ps( t2, t3 ) );
+}
+
+SKIN_TARGET_SSE2
+SKIN_INLINE void Skin_StoreVec3( float *out, __m128 v ) {
+	_mm_storel_pi( (__m64 *)out, v );
+	_mm_store_ss( out + 2, _mm_movehl_ps( v, v ) );
+}
+
+SKIN_TARGET_SSE2
+static void Skin_MultiplyMatrixSSE2( float *out, const float *a, const float *b ) {
+	const __m128 mask = Skin_TranslationMask();
+	const __m128 b0 = _mm_loadu_ps( b );
+	const __m128 b1 = _mm_loadu_ps( b + 4 );
+	const __m128 b2 = _mm_loadu_ps( b + 8 );
+	const __m128 r0 = Skin_MultiplyRow( _mm_loadu_ps( a ), b0, b1, b2, mask );
+	const __m128 r1 = Skin_MultiplyRow( _mm_loadu_ps( a + 4 ), b0, b1, b2, mask );
+	const __m128 r2 = Skin_MultiplyRow( _mm_loadu_ps( a + 8 ), b0, b1, b2, mask );
+
+	_mm_storeu_ps( out, r0 );
+	_mm_storeu_ps( out + 4, r1 );
+	_mm_storeu_ps( out + 8, r2 );
+}
+
+SKIN_TARGET_SSE2
+static void Skin_BlendMatrixSSE2( float *out, const float *a, const float *b, float frac ) {
+	const __m128 f = _mm_set1_ps( frac );
+	int i;
+
+	for ( i = 0; i < 12; i += 4 ) {
+		const __m128 vb = _mm_loadu_ps( b + i );
+		_mm_storeu_ps( out + i, _mm_add_ps( _mm_mul_ps( f, _mm_sub_ps( _mm_loadu_ps( a + i ), vb ) ), vb ) );
+	}
+}
+
+SKIN_TARGET_SSE2
+static void Skin_SkinVertsSSE2( float *out, int outStride, const skinVertex_t *verts, int numVerts,
+	const float * const *bones, const float *scale )
+{
+	const __m128 sc = _mm_set_ps( 0.0f, scale[2], scale[1], scale[0] );
+	int i, k;
+
+	for ( i = 0; i < numVerts; i++, verts++, out += outStride ) {
+		const __m128 p = _mm_set_ps( 1.0f, verts->xyz[2], verts->xyz[1], verts->xyz[0] );
+		__m128 r0 = _mm_setzero_ps();
+		__m128 r1 = _mm_setzero_ps();
+		__m128 r2 = _mm_setzero_ps();
+
+		for ( k = 0; k < verts->numWeights; k++ ) {
+			const float *m = bones[verts->bone[k]];
+			const __m128 w = _mm_set1_ps( verts->weight[k] );
+
+			r0 = _mm_add_ps( r0, _mm_mul_ps( w, _mm_loadu_ps( m ) ) );
+			r1 = _mm_add_ps( r1, _mm_mul_ps( w, _mm_loadu_ps( m + 4 ) ) );
+			r2 = _mm_add_ps( r2, _mm_mul_ps( w, _mm_loadu_ps( m + 8 ) ) );
+		}
+
+		Skin_StoreVec3( out, _mm_mul_ps( Skin_DotRows( _mm_mul_ps( r0, p ), _mm_mul_ps( r1, p ), _mm_mul_ps( r2, p ) ), sc ) );
+	}
+}
+
+/*
+==============================================================================
+
+AVX2
+
+The first two rows of a matrix share a register, the third is done as in
+the SSE2 version.
+
+==============================================================================
+*/
+
+SKIN_TARGET("avx2")
+static inline __m256 Skin_Load2x( const float *v ) {
+	const __m128 x = _mm_loadu_ps( v );
+	return _mm256_insertf128_ps( _mm256_castps128_ps256( x ), x, 1 );
+}
+
+SKIN_TARGET("avx2")
+static void Skin_MultiplyMatrixAVX2( float *out, const float *a, const float *b ) {
+	const __m256 mask = _mm256_castsi256_ps( _mm256_set_epi32( -1, 0, 0, 0, -1, 0, 0, 0 ) );
+	const __m256 b0 = Skin_Load2x( b );
+	const __m256 b1 = Skin_Load2x( b + 4 );
+	const __m256 b2 = Skin_Load2x( b + 8 );
+	const __m256 a01 = _mm256_loadu_ps( a );
+	const __m128 a2 = _mm_loadu_ps( a + 8 );
+	__m256 r01;
+	__m128 r2;
+
+	r01 = _mm256_mul_ps( _mm256_permute_ps( a01, 0x00 ), b0 );
+	r01 = _mm256_add_ps( r01, _mm256_mul_ps( _mm256_permute_ps( a01, 0x55 ), b1 ) );
+	r01 = _mm256_add_ps( r01, _mm256_mul_ps( _mm256_permute_ps( a01, 0xaa ), b2 ) );
+	r01 = _mm256_add_ps( r01, _mm256_and_ps( _mm256_permute_ps( a01, 0xff ), mask ) );
+
+	r2 = _mm_mul_ps( _mm_permute_ps( a2, 0x00 ), _mm256_castps256_ps128( b0 ) );
+	r2 = _mm_add_ps( r2, _mm_mul_ps( _mm_permute_ps( a2, 0x55 ), _mm256_castps256_ps128( b1 ) ) );
+	r2 = _mm_add_ps( r2, _mm_mul_ps( _mm_permute_ps( a2, 0xaa ), _mm256_castps256_ps128( b2 ) ) );
+	r2 = _mm_add_ps( r2, _mm_and_ps( _mm_permute_ps( a2, 0xff ), _mm256_castps256_ps128( mask ) ) );
+
+	_mm256_storeu_ps( out, r01 );
+	_mm_storeu_ps( out + 8, r2 );
+}
+
+SKIN_TARGET("avx2")
+static void Skin_BlendMatrixAVX2( float *out, const float *a, const float *b, float frac ) {
+	const __m256 f = _mm256_set1_ps( frac );
+	const __m256 b01 = _mm256_loadu_ps( b );
+	const __m128 b2 = _mm_loadu_ps( b + 8 );
+	const __m256 r01 = _mm256_add_ps( _mm256_mul_ps( f, _mm256_sub_ps( _mm256_loadu_ps( a ), b01 ) ), b01 );
+	const __m128 r2 = _mm_add_ps( _mm_mul_ps( _mm256_castps256_ps128( f ), _mm_sub_ps( _mm_loadu_ps( a + 8 ), b2 ) ), b2 );
+
+	_mm256_storeu_ps( out, r01 );
+	_mm_storeu_ps( out + 8, r2 );
+}
+
+SKIN_TARGET("avx2")
+static void Skin_SkinVertsAVX2( float *out, int outStride, const skinVertex_t *verts, int numVerts,
+	const float * const *bones, const float *scale )
+{
+	const __m128 sc = _mm_set_ps( 0.0f, scale[2], scale[1], scale[0] );
+	int i, k;
+
+	for ( i = 0; i < numVerts; i++, verts++, out += outStride ) {
+		const __m128 p = _mm_set_ps( 1.0f, verts->xyz[2], verts->xyz[1], verts->xyz[0] );
+		const __m256 p2 = _mm256_insertf128_ps( _mm256_castps128_ps256( p ), p, 1 );
+		__m256 r01 = _mm256_setzero_ps();
+		__m128 r2 = _mm_setzero_ps();
+		__m256 t01;
+
+		for ( k = 0; k < verts->numWeights; k++ ) {
+			const float *m = bones[verts->bone[k]];
+			const __m256 w = _mm256_set1_ps( verts->weight[k] );
+
+			r01 = _mm256_add_ps( r01, _mm256_mul_ps( w, _mm256_loadu_ps( m ) ) );
+			r2 = _mm_add_ps( r2, _mm_mul_ps( _mm256_castps256_ps128( w ), _mm_loadu_ps( m + 8 ) ) );
+		}
+
+		t01 = _mm256_mul_ps( r01, p2 );
+		Skin_StoreVec3( out, _mm_mul_ps( Skin_DotRows( _mm256_castps256_ps128( t01 ), _mm256_extractf128_ps( t01, 1 ), _mm_mul_ps( r2, p ) ), sc ) );
+	}
+}
+
+/*
+==================
+Skin_CPUSupports
+==================
+*/
+static bool Skin_CPUSupports( skinKernelType_t type ) {
+#if defined(_MSC_VER)
+	int info[4];
+
+	__cpuid( info, 0 );
+	const int maxLeaf = info[0];
+
+	__cpuid( info, 1 );
+	if ( type == SKINKERNEL_SSE2 ) {
+		return (info[3] & (1 << 26)) != 0;
+	}
+
+	// avx needs the os to save the ymm registers as well
+	if ( !(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || (_xgetbv( 0 ) & 6) != 6 || maxLeaf < 7 ) {
+		return false;
+	}
+	__cpuidex( info, 7, 0 );
+	return (info[1] & (1 << 5)) != 0;
+#else
+	// may run before the constructor that sets this up
+	__builtin_cpu_init();
+
+	if ( type == SKINKERNEL_SSE2 ) {
+		return __builtin_cpu_supports( "sse2" ) != 0;
+	}
+	return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+}
+
+#endif // SKIN_X86
+
+static const skinKernels_t skinKernels[SKINKERNEL_MAX] = {
+	{ "scalar", Skin_MultiplyMatrixScalar, Skin_BlendMatrixScalar, Skin_SkinVertsScalar },
+#ifdef SKIN_X86
+	{ "sse2", Skin_MultiplyMatrixSSE2, Skin_BlendMatrixSSE2, Skin_SkinVertsSSE2 },
+	{ "avx2", Skin_MultiplyMatrixAVX2, Skin_BlendMatrixAVX2, Skin_SkinVertsAVX2 },
+#else
+	{ "sse2", NULL, NULL, NULL },
+	{ "avx2", NULL, NULL, NULL },
+#endif
+};
+
+const skinKernels_t *Skin_GetKernels( skinKernelType_t type ) {
+	if ( type < SKINKERNEL_SCALAR || type >= SKINKERNEL_MAX || !skinKernels[type].skinVerts ) {
+		return NULL;
+	}
+
+#ifdef SKIN_X86
+	if ( type != SKINKERNEL_SCALAR && !Skin_CPUSupports( type ) ) {
+		return NULL;
+	}
+#endif
+
+	return &skinKernels[type];
+}
+
+const skinKernels_t *Skin_SelectKernels( void ) {
+	int type;
+
+	for ( type = SKINKERNEL_MAX - 1; type > SKINKERNEL_SCALAR; type-- ) {
+		const skinKernels_t *kernels = Skin_GetKernels( (skinKernelType_t)type );
+
+		if ( kernels ) {
+			return kernels;
+		}
+	}
+
+	return &skinKernels[SKINKERNEL_SCALAR];
+}
@@ -0,0 +1,69 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+#pragma once
+
+// q_skinning.h -- 3x4 bone matrix and vertex skinning kernels
+//
+// The Ghoul2 code on the server spends most of a trace building bone
+// matrices and skinning vertices. These are the inner loops of that, with
+// scalar, SSE2 and AVX2 versions that are picked once at startup from what
+// the cpu supports. They only depend on plain floats so they can be tested
+// on their own.
+//
+// Matrices are 3 rows of 4 floats, the 4th column is the translation and
+// the implicit 4th row is 0 0 0 1, the same layout as mdxaBone_t. Nothing
+// has to be aligned.
+
+#define SKIN_MAX_WEIGHTS	4
+
+typedef struct skinVertex_s {
+	float	xyz[3];
+	int		numWeights;					// 1 - SKIN_MAX_WEIGHTS
+	int		bone[SKIN_MAX_WEIGHTS];		// into the bone table
+	float	weight[SKIN_MAX_WEIGHTS];
+} skinVertex_t;
+
+typedef enum {
+	SKINKERNEL_SCALAR,
+	SKINKERNEL_SSE2,
+	SKINKERNEL_AVX2,
+	SKINKERNEL_MAX
+} skinKernelType_t;
+
+typedef struct skinKernels_s {
+	const char	*name;
+
+	// out = a * b, out may be the same as a or b
+	void		(*multiplyMatrix)( float *out, const float *a, const float *b );
+
+	// out = b + frac * (a - b), out may be the same as a or b
+	void		(*blendMatrix)( float *out, const float *a, const float *b, float frac );
+
+	// writes scale * sum( weight * bone * xyz ) to the first three floats of
+	// every outStride floats of out, bones are pointers to 12 floats each
+	void		(*skinVerts)( float *out, int outStride, const skinVertex_t *verts, int numVerts,
+					const float * const *bones, const float *scale );
+} skinKernels_t;
+
+// NULL if the kernel was not built or the cpu can't run it
+const skinKernels_t *Skin_GetKernels( skinKernelType_t type );
+
+// the fastest kernels this cpu can run
+const skinKernels_t *Skin_SelectKernels( void );
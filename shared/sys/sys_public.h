@@ -115,6 +115,8 @@ void	Sys_Print( const char *msg );
 // any game related timing information should come from event timestamps
 int		Sys_Milliseconds (bool baseTime = false);
 int		Sys_Milliseconds2(void);
+// monotonic, only differences between two calls mean anything
+int64_t	Sys_Nanoseconds( void );
 void	Sys_Sleep( int msec );
 
 extern "C" void	Sys_SnapVector( float *v );
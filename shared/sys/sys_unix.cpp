@@ -105,6 +105,19 @@ int Sys_Milliseconds2( void )
     return Sys_Milliseconds(false);
 }
 
+/*
+================
+Sys_Nanoseconds
+================
+*/
+int64_t Sys_Nanoseconds( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 /*
 ==================
 Sys_RandomBytes
@@ -108,6 +108,26 @@ int Sys_Milliseconds2( void )
 	return Sys_Milliseconds(false);
 }
 
+/*
+================
+Sys_Nanoseconds
+================
+*/
+int64_t Sys_Nanoseconds( void )
+{
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if ( !frequency.QuadPart ) {
+		QueryPerformanceFrequency( &frequency );
+	}
+	QueryPerformanceCounter( &counter );
+
+	// split up so the multiply can't overflow
+	return ( counter.QuadPart / frequency.QuadPart ) * 1000000000 +
+		( counter.QuadPart % frequency.QuadPart ) * 1000000000 / frequency.QuadPart;
+}
+
 /*
 ================
 Sys_RandomBytes
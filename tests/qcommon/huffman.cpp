@@ -0,0 +1,239 @@
+#include "qcommon/qcommon.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+	enum { bufferSize = MAX_MSGLEN };
+
+	// huffman_t is big, keep it off the stack
+	struct HuffTree
+	{
+		std::unique_ptr<huffman_t> huff;
+		std::unique_ptr<huffTables_t> tables;
+		qboolean valid;
+
+		// adds the references like MSG_initHuffman does
+		explicit HuffTree( const std::vector<int>& counts )
+			: huff( new huffman_t )
+			, tables( new huffTables_t )
+		{
+			Huff_Init( huff.get() );
+			for( int i = 0; i < static_cast<int>( counts.size() ); i++ )
+			{
+				for( int j = 0; j < counts[i]; j++ )
+				{
+					Huff_addRef( &huff->compressor, static_cast<byte>( i ) );
+					Huff_addRef( &huff->decompressor, static_cast<byte>( i ) );
+				}
+			}
+			valid = Huff_BuildTables( tables.get(), huff->decompressor.tree );
+		}
+
+		int maxLength() const
+		{
+			int longest = 0;
+			for( int i = 0; i < HMAX; i++ )
+			{
+				longest = std::max<int>( longest, tables->length[i] );
+			}
+			return longest;
+		}
+	};
+
+	// skewed like network data, a few bytes are most of it
+	std::vector<int> zipfCounts()
+	{
+		std::vector<int> counts( 256 );
+		for( int i = 0; i < 256; i++ )
+		{
+			counts[i] = 20000 / ( i + 1 ) + 1;
+		}
+		return counts;
+	}
+
+	// fibonacci weights make every code one bit longer than the last
+	std::vector<int> fibonacciCounts( int symbols )
+	{
+		std::vector<int> counts( symbols, 1 );
+		for( int i = 2; i < symbols; i++ )
+		{
+			counts[i] = counts[i - 1] + counts[i - 2];
+		}
+		return counts;
+	}
+
+	std::vector<int> randomSymbols( std::mt19937& rng, const std::vector<int>& counts, int num )
+	{
+		std::discrete_distribution<int> pick( counts.begin(), counts.end() );
+		std::vector<int> symbols( num );
+		for( int& s : symbols )
+		{
+			s = pick( rng );
+		}
+		return symbols;
+	}
+
+	// both writers start on the same garbage so the byte handling is compared too
+	void checkTransmit( const HuffTree& tree, const std::vector<int>& symbols, int start, int maxoffset, std::mt19937& rng )
+	{
+		std::vector<byte> expected( bufferSize ), actual( bufferSize );
+		for( byte& b : expected )
+		{
+			b = static_cast<byte>( rng() );
+		}
+		actual = expected;
+
+		int expectedOffset = start, actualOffset = start;
+		for( int s : symbols )
+		{
+			Huff_offsetTransmit( &tree.huff->compressor, s, expected.data(), &expectedOffset, maxoffset );
+			Huff_tableTransmit( tree.tables.get(), s, actual.data(), &actualOffset, maxoffset );
+			BOOST_REQUIRE_EQUAL( actualOffset, expectedOffset );
+			if( expectedOffset > maxoffset )
+			{
+				break;
+			}
+		}
+		BOOST_REQUIRE( expected == actual );
+	}
+
+	void checkReceive( const HuffTree& tree, const std::vector<byte>& data, int start, int maxoffset )
+	{
+		std::vector<byte> buffer( data );
+		int expectedOffset = start, actualOffset = start;
+
+		while( expectedOffset <= maxoffset )
+		{
+			int expected = -1, actual = -1;
+			Huff_offsetReceive( tree.huff->decompressor.tree, &expected, buffer.data(), &expectedOffset, maxoffset );
+			Huff_tableReceive( tree.tables.get(), &actual, buffer.data(), &actualOffset, maxoffset );
+			BOOST_REQUIRE_EQUAL( actual, expected );
+			BOOST_REQUIRE_EQUAL( actualOffset, expectedOffset );
+			if( expectedOffset == maxoffset )
+			{
+				break;
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( huffman )
+
+BOOST_AUTO_TEST_CASE( tables )
+{
+	HuffTree zipf( zipfCounts() );
+	BOOST_REQUIRE( zipf.valid );
+	BOOST_TEST_MESSAGE( "longest code " << zipf.maxLength() );
+
+	// some codes have to go past the lookup
+	HuffTree deep( fibonacciCounts( 28 ) );
+	BOOST_REQUIRE( deep.valid );
+	BOOST_CHECK_GT( deep.maxLength(), HUFF_LOOKUP_BITS );
+
+	for( int i = 0; i < 28; i++ )
+	{
+		BOOST_CHECK_GT( deep.tables->length[i], 0 );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( transmit )
+{
+	std::mt19937 rng( 1234 );
+
+	for( const auto& counts : { zipfCounts(), fibonacciCounts( 28 ) } )
+	{
+		HuffTree tree( counts );
+		BOOST_REQUIRE( tree.valid );
+
+		for( int run = 0; run < 64; run++ )
+		{
+			const std::vector<int> symbols = randomSymbols( rng, counts, 1400 );
+			const int start = rng() % 64;
+
+			// plenty of room, then running out at every bit of a byte
+			checkTransmit( tree, symbols, start, bufferSize << 3, rng );
+			checkTransmit( tree, symbols, start, 2048 + run, rng );
+			checkTransmit( tree, symbols, start, start + run, rng );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( receive )
+{
+	std::mt19937 rng( 5678 );
+
+	for( const auto& counts : { zipfCounts(), fibonacciCounts( 28 ) } )
+	{
+		HuffTree tree( counts );
+		BOOST_REQUIRE( tree.valid );
+
+		for( int run = 0; run < 64; run++ )
+		{
+			std::vector<byte> data( bufferSize );
+			int offset = 0;
+
+			// a real stream and plain noise, which has codes cut off at the end
+			for( int s : randomSymbols( rng, counts, 1400 ) )
+			{
+				Huff_tableTransmit( tree.tables.get(), s, data.data(), &offset, bufferSize << 3 );
+			}
+			checkReceive( tree, data, 0, offset );
+			checkReceive( tree, data, rng() % 64, offset - run );
+
+			for( byte& b : data )
+			{
+				b = static_cast<byte>( rng() );
+			}
+			checkReceive( tree, data, rng() % 64, 1024 + run );
+		}
+	}
+}
+
+// not run by default, --run_test=huffman/benchmark --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark, *boost::unit_test::disabled() )
+{
+	std::mt19937 rng( 1234 );
+	HuffTree tree( zipfCounts() );
+	// about a full snapshot
+	const std::vector<int> symbols = randomSymbols( rng, zipfCounts(), 1400 );
+	std::vector<byte> data( bufferSize );
+	const int runs = 2000;
+	int offset = 0, get = 0;
+
+	auto time = [&]( const char *name, bool encode, bool useTables )
+	{
+		auto start = std::chrono::steady_clock::now();
+		for( int run = 0; run < runs; run++ )
+		{
+			offset = 0;
+			for( size_t i = 0; i < symbols.size(); i++ )
+			{
+				if( encode && useTables )
+					Huff_tableTransmit( tree.tables.get(), symbols[i], data.data(), &offset, bufferSize << 3 );
+				else if( encode )
+					Huff_offsetTransmit( &tree.huff->compressor, symbols[i], data.data(), &offset, bufferSize << 3 );
+				else if( useTables )
+					Huff_tableReceive( tree.tables.get(), &get, data.data(), &offset, bufferSize << 3 );
+				else
+					Huff_offsetReceive( tree.huff->decompressor.tree, &get, data.data(), &offset, bufferSize << 3 );
+			}
+		}
+		auto nsec = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+
+		BOOST_TEST_MESSAGE( name << ": " << nsec / runs << " nsec for " << symbols.size() << " bytes" );
+	};
+
+	time( "tree encode", true, false );
+	time( "table encode", true, true );
+	time( "tree decode", false, false );
+	time( "table decode", false, true );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
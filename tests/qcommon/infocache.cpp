@@ -0,0 +1,196 @@
+#include "qcommon/qcommon.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// q_shared wants these from the engine
+namespace
+{
+	int printCount = 0;
+}
+
+void QDECL Com_Printf( const char *msg, ... )
+{
+	printCount++;
+}
+
+void NORETURN QDECL Com_Error( int level, const char *error, ... )
+{
+	throw std::runtime_error( error );
+}
+
+namespace
+{
+	struct Pairs
+	{
+		std::vector<std::string> keys;
+		std::vector<std::string> values;
+
+		// Cvar_InfoString and Cvar_InfoString_Big as they were
+		std::string reference( bool big ) const
+		{
+			std::vector<char> info( big ? BIG_INFO_STRING : MAX_INFO_STRING, 0 );
+			for( size_t i = 0; i < keys.size(); i++ )
+			{
+				if( big )
+				{
+					Info_SetValueForKey_Big( info.data(), keys[i].c_str(), values[i].c_str() );
+				}
+				else
+				{
+					Info_SetValueForKey( info.data(), keys[i].c_str(), values[i].c_str() );
+				}
+			}
+			return info.data();
+		}
+
+		bool build( infoCache_t& cache ) const
+		{
+			std::vector<const char *> k, v;
+			std::vector<const void *> owners;
+			for( size_t i = 0; i < keys.size(); i++ )
+			{
+				k.push_back( keys[i].c_str() );
+				v.push_back( values[i].c_str() );
+				owners.push_back( &keys[i] );
+			}
+			return InfoCache_Build( &cache, static_cast<int>( keys.size() ), k.data(), v.data(), owners.data() ) != qfalse;
+		}
+	};
+
+	std::string randomString( std::mt19937& rng, int maxLength, bool allowBad )
+	{
+		static const char plain[] = "abcdefghijklmnopqrstuvwxyz0123456789_ .-^";
+		static const char bad[] = "\\;\"";
+		std::string s( std::uniform_int_distribution<int>( 0, maxLength )( rng ), 'x' );
+		for( char& c : s )
+		{
+			c = plain[rng() % ( sizeof( plain ) - 1 )];
+			if( allowBad && rng() % 200 == 0 )
+			{
+				c = bad[rng() % ( sizeof( bad ) - 1 )];
+			}
+		}
+		return s;
+	}
+
+	Pairs randomPairs( std::mt19937& rng, int count, int maxValue, bool allowBad )
+	{
+		Pairs pairs;
+		for( int i = 0; i < count; i++ )
+		{
+			// unique like cvar names
+			pairs.keys.push_back( "k" + std::to_string( i ) + "+" + randomString( rng, 8, false ) );
+			pairs.values.push_back( randomString( rng, maxValue, allowBad ) );
+		}
+		return pairs;
+	}
+
+	// the cache either gives the old string or says the old code has to run,
+	// which is exactly when that would have complained
+	void checkBuild( const Pairs& pairs, infoCache_t& cache )
+	{
+		int before = printCount;
+		const std::string expected = pairs.reference( cache.big != qfalse );
+		bool quiet = printCount == before;
+
+		BOOST_REQUIRE_EQUAL( pairs.build( cache ), quiet );
+		if( quiet )
+		{
+			BOOST_REQUIRE_EQUAL( std::string( cache.info ), expected );
+			BOOST_REQUIRE_EQUAL( cache.length, static_cast<int>( expected.size() ) );
+		}
+	}
+
+	void checkRandom( bool big, int count, int maxValue, bool allowBad, int rounds )
+	{
+		std::mt19937 rng( 1234 + count + maxValue );
+		std::unique_ptr<infoCache_t> cache( new infoCache_t() );
+		cache->big = big ? qtrue : qfalse;
+
+		for( int round = 0; round < rounds; round++ )
+		{
+			Pairs pairs = randomPairs( rng, count, maxValue, allowBad );
+			checkBuild( pairs, *cache );
+
+			for( int change = 0; change < 50; change++ )
+			{
+				size_t i = rng() % pairs.keys.size();
+				pairs.values[i] = randomString( rng, maxValue, allowBad );
+				if( InfoCache_SetValue( cache.get(), &pairs.keys[i], pairs.values[i].c_str() ) )
+				{
+					BOOST_REQUIRE_EQUAL( std::string( cache->info ), pairs.reference( big ) );
+				}
+				else
+				{
+					BOOST_REQUIRE( !cache->valid );
+					checkBuild( pairs, *cache );
+				}
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( infocache )
+
+BOOST_AUTO_TEST_CASE( empty )
+{
+	std::unique_ptr<infoCache_t> cache( new infoCache_t() );
+	Pairs pairs;
+	checkBuild( pairs, *cache );
+	BOOST_CHECK( cache->valid );
+	BOOST_CHECK_EQUAL( cache->info, "" );
+}
+
+BOOST_AUTO_TEST_CASE( small )
+{
+	checkRandom( false, 20, 12, false, 50 );
+	checkRandom( false, 20, 12, true, 50 );
+}
+
+BOOST_AUTO_TEST_CASE( big )
+{
+	checkRandom( true, 200, 12, false, 20 );
+	checkRandom( true, 200, 12, true, 20 );
+}
+
+// lengths around the limit, where pairs start getting refused
+BOOST_AUTO_TEST_CASE( overflow )
+{
+	checkRandom( false, 30, 60, false, 50 );
+	checkRandom( true, 200, 70, false, 20 );
+	checkRandom( false, 2, 1100, false, 50 );
+}
+
+BOOST_AUTO_TEST_CASE( emptyValues )
+{
+	std::unique_ptr<infoCache_t> cache( new infoCache_t() );
+	Pairs pairs;
+	pairs.keys = { "a", "b", "c" };
+	pairs.values = { "1", "", "3" };
+
+	checkBuild( pairs, *cache );
+	BOOST_CHECK_EQUAL( cache->info, "\\c\\3\\a\\1" );
+
+	// a small string drops empty values, so that is no patch
+	BOOST_CHECK( !InfoCache_SetValue( cache.get(), &pairs.keys[1], "2" ) );
+	pairs.values[1] = "2";
+	checkBuild( pairs, *cache );
+	BOOST_CHECK( !InfoCache_SetValue( cache.get(), &pairs.keys[0], "" ) );
+
+	cache->big = qtrue;
+	pairs.values = { "1", "", "3" };
+	checkBuild( pairs, *cache );
+	BOOST_CHECK_EQUAL( cache->info, "\\a\\1\\b\\\\c\\3" );
+	BOOST_CHECK( InfoCache_SetValue( cache.get(), &pairs.keys[1], "22" ) );
+	BOOST_CHECK_EQUAL( cache->info, "\\a\\1\\b\\22\\c\\3" );
+	BOOST_CHECK( InfoCache_SetValue( cache.get(), &pairs.keys[0], "" ) );
+	BOOST_CHECK_EQUAL( cache->info, "\\a\\\\b\\22\\c\\3" );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
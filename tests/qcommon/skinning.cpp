@@ -0,0 +1,211 @@
+#include "qcommon/q_skinning.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct SkinFixture
+	{
+		enum { numBones = 64, numVerts = 4096 };
+
+		std::mt19937 rng;
+		std::vector<float> boneData;
+		std::vector<const float *> bones;
+		std::vector<skinVertex_t> verts;
+
+		SkinFixture()
+			: rng( 1234 )
+			, boneData( numBones * 12 )
+			, bones( numBones )
+			, verts( numVerts )
+		{
+			std::uniform_real_distribution<float> rot( -1.0f, 1.0f );
+			std::uniform_real_distribution<float> pos( -64.0f, 64.0f );
+			std::uniform_int_distribution<int> bone( 0, numBones - 1 );
+			std::uniform_int_distribution<int> weights( 1, SKIN_MAX_WEIGHTS );
+
+			for( int i = 0; i < numBones; i++ )
+			{
+				float *m = &boneData[i * 12];
+				for( int j = 0; j < 12; j++ )
+				{
+					m[j] = ( j & 3 ) == 3 ? pos( rng ) : rot( rng );
+				}
+				bones[i] = m;
+			}
+
+			for( auto& v : verts )
+			{
+				float total = 0.0f;
+
+				v.xyz[0] = pos( rng );
+				v.xyz[1] = pos( rng );
+				v.xyz[2] = pos( rng );
+				v.numWeights = weights( rng );
+				for( int k = 0; k < v.numWeights; k++ )
+				{
+					v.bone[k] = bone( rng );
+					v.weight[k] = k == v.numWeights - 1 ? 1.0f - total : std::ldexp( std::fabs( rot( rng ) ), -v.numWeights );
+					total += v.weight[k];
+				}
+			}
+		}
+
+		const float *matrix( int i ) const
+		{
+			return &boneData[( i % numBones ) * 12];
+		}
+	};
+
+	// the kernels add up in a different order, allow for that
+	void checkClose( const float *a, const float *b, int count, float magnitude )
+	{
+		for( int i = 0; i < count; i++ )
+		{
+			BOOST_CHECK_SMALL( a[i] - b[i], magnitude * 1e-5f );
+		}
+	}
+
+	std::vector<const skinKernels_t *> simdKernels()
+	{
+		std::vector<const skinKernels_t *> kernels;
+		for( int type = SKINKERNEL_SCALAR + 1; type < SKINKERNEL_MAX; type++ )
+		{
+			const skinKernels_t *k = Skin_GetKernels( static_cast<skinKernelType_t>( type ) );
+			if( k )
+			{
+				kernels.push_back( k );
+			}
+		}
+		return kernels;
+	}
+}
+
+BOOST_FIXTURE_TEST_SUITE( skinning, SkinFixture )
+
+BOOST_AUTO_TEST_CASE( select )
+{
+	BOOST_REQUIRE( Skin_GetKernels( SKINKERNEL_SCALAR ) );
+	BOOST_REQUIRE( Skin_SelectKernels() );
+	BOOST_CHECK( !Skin_GetKernels( SKINKERNEL_MAX ) );
+	BOOST_TEST_MESSAGE( "selected " << Skin_SelectKernels()->name );
+}
+
+BOOST_AUTO_TEST_CASE( multiply )
+{
+	const skinKernels_t *scalar = Skin_GetKernels( SKINKERNEL_SCALAR );
+	static const float identity[12] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0 };
+	float out[12];
+
+	// a times identity is a
+	scalar->multiplyMatrix( out, matrix( 0 ), identity );
+	checkClose( out, matrix( 0 ), 12, 1.0f );
+
+	for( const skinKernels_t *k : simdKernels() )
+	{
+		BOOST_TEST_CONTEXT( k->name )
+		{
+			for( int i = 0; i < numBones; i++ )
+			{
+				float expected[12], actual[12];
+
+				scalar->multiplyMatrix( expected, matrix( i ), matrix( i + 1 ) );
+				k->multiplyMatrix( actual, matrix( i ), matrix( i + 1 ) );
+				checkClose( actual, expected, 12, 256.0f );
+
+				// in place, as G2 does with temporaries
+				std::copy( matrix( i ), matrix( i ) + 12, actual );
+				k->multiplyMatrix( actual, actual, matrix( i + 1 ) );
+				checkClose( actual, expected, 12, 256.0f );
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( blend )
+{
+	const skinKernels_t *scalar = Skin_GetKernels( SKINKERNEL_SCALAR );
+
+	for( const skinKernels_t *k : simdKernels() )
+	{
+		BOOST_TEST_CONTEXT( k->name )
+		{
+			for( int i = 0; i < numBones; i++ )
+			{
+				const float frac = i / float( numBones - 1 );
+				float expected[12], actual[12];
+
+				scalar->blendMatrix( expected, matrix( i ), matrix( i + 1 ), frac );
+				k->blendMatrix( actual, matrix( i ), matrix( i + 1 ), frac );
+				checkClose( actual, expected, 12, 64.0f );
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( skin )
+{
+	const skinKernels_t *scalar = Skin_GetKernels( SKINKERNEL_SCALAR );
+	const float scale[3] = { 1.0f, 0.5f, 2.0f };
+	// strided like the G2 transformed verts, s and t have to survive
+	std::vector<float> expected( numVerts * 5, -1.0f );
+
+	scalar->skinVerts( expected.data(), 5, verts.data(), numVerts, bones.data(), scale );
+
+	for( const skinKernels_t *k : simdKernels() )
+	{
+		BOOST_TEST_CONTEXT( k->name )
+		{
+			std::vector<float> actual( numVerts * 5, -1.0f );
+
+			k->skinVerts( actual.data(), 5, verts.data(), numVerts, bones.data(), scale );
+			for( int i = 0; i < numVerts; i++ )
+			{
+				checkClose( &actual[i * 5], &expected[i * 5], 3, 512.0f );
+				BOOST_CHECK_EQUAL( actual[i * 5 + 3], -1.0f );
+				BOOST_CHECK_EQUAL( actual[i * 5 + 4], -1.0f );
+			}
+		}
+	}
+}
+
+// not run by default, --run_test=skinning/benchmark --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark, *boost::unit_test::disabled() )
+{
+	const float scale[3] = { 1.0f, 1.0f, 1.0f };
+	std::vector<float> out( numVerts * 5 );
+	std::vector<float> chain( matrix( 0 ), matrix( 0 ) + numBones * 12 );
+
+	for( int type = SKINKERNEL_SCALAR; type < SKINKERNEL_MAX; type++ )
+	{
+		const skinKernels_t *k = Skin_GetKernels( static_cast<skinKernelType_t>( type ) );
+		if( !k )
+		{
+			continue;
+		}
+
+		const int runs = 200;
+		auto start = std::chrono::steady_clock::now();
+		for( int run = 0; run < runs; run++ )
+		{
+			// blend and multiply every bone, then the verts, like a G2 transform
+			for( int i = 1; i < numBones; i++ )
+			{
+				k->blendMatrix( &chain[i * 12], matrix( i ), matrix( i - 1 ), 0.25f );
+				k->multiplyMatrix( &chain[i * 12], matrix( i - 1 ), &chain[i * 12] );
+			}
+			k->skinVerts( out.data(), 5, verts.data(), numVerts, bones.data(), scale );
+		}
+		auto usec = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start ).count();
+
+		BOOST_TEST_MESSAGE( k->name << ": " << usec / runs << " usec for " << numBones << " bones and " << numVerts << " verts" );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()